@@ -19,11 +19,13 @@ extern "C" {
 #include <cassert>
 #endif  // UNIT_TEST
 #include "IRremoteESP8266.h"
+#include "IRtimer.h"
 #include "IRutils.h"
 
 #ifdef UNIT_TEST
 #undef ICACHE_RAM_ATTR
 #define ICACHE_RAM_ATTR
+#define USE_IRAM_ATTR
 #endif
 
 #ifndef USE_IRAM_ATTR
@@ -52,7 +54,7 @@ extern "C" {
 #ifndef UNIT_TEST
 #if defined(ESP8266)
 namespace _IRrecv {
-static ETSTimer timer;
+static ETSTimer timers[kMaxReceivers];  // The timeout timer of each slot.
 }  // namespace _IRrecv
 #endif  // ESP8266
 #if defined(ESP32)
@@ -134,44 +136,226 @@ typedef struct hw_timer_s {
 #endif  // _ESP32_IRRECV_TIMER_HACK / End of Horrible Hack.
 
 namespace _IRrecv {
-static hw_timer_t * timer = NULL;
+// The timeout timer of each slot.
+static hw_timer_t * timers[kMaxReceivers] = {NULL};
 }  // namespace _IRrecv
 #endif  // ESP32
-using _IRrecv::timer;
+using _IRrecv::timers;
 #endif  // UNIT_TEST
 
 namespace _IRrecv {  // Namespace extension
 #if defined(ESP32)
 portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
 #endif  // ESP32
-volatile irparams_t params;
-irparams_t *params_save;  // A copy of the interrupt state while decoding.
+// The receiver using each interrupt slot. NULL if the slot is free.
+IRrecv *receivers[kMaxReceivers] = {NULL};
 }  // namespace _IRrecv
 
 #if defined(ESP32)
 using _IRrecv::mux;
 #endif  // ESP32
-using _IRrecv::params;
-using _IRrecv::params_save;
 
-#ifndef UNIT_TEST
+/// Move a completed capture from the interrupt's buffer into the queue.
+/// If there is a free slot, the buffers are swapped (not copied) and capturing
+/// resumes immediately. Otherwise, the capture stays in kStopState until the
+/// consumer frees up a slot, as it would without a queue.
+/// The producer is whoever holds `params` in kStopState (normally the timeout
+/// interrupt), the consumer is decode()/resume(). Each slot's `rawlen` is the
+/// only thing both sides write: the producer sets it last, the consumer clears
+/// it when it is finished with the slot.
+/// @note Only call this when `params` is in kStopState.
+/// @return true, if the capture was queued, false if not.
+bool USE_IRAM_ATTR IRrecv::_queueCapture(void) {
+  if (!_queue_size) return false;
+  volatile capture_slot_t *slot = &_queue[_queue_head];
+  if (slot->rawlen) return false;  // Full. The oldest is still unread.
+  uint16_t *spare = slot->rawbuf;
+  slot->rawbuf = params.rawbuf;
+  slot->overflow = params.overflow;
+  slot->timestamp = params.timestamp;
+  slot->rawlen = params.rawlen;  // Publish it.
+  if (++_queue_head >= _queue_size) _queue_head = 0;
+  params.rawbuf = spare;
+  params.rawlen = 0;
+  params.overflow = false;
+  params.rcvstate = kIdleState;
+  return true;
+}
+
+/// Hand the capture lent out by the last decode() back to the queue.
+/// If that makes room for a capture the interrupt is holding, queue it too.
+void IRrecv::_releaseCapture(void) {
+  if (!_queue_held) return;
+  if (_next_rawbuf == _queue[_queue_tail].rawbuf) _next_rawbuf = NULL;
+  _queue[_queue_tail].rawlen = 0;  // Free the slot.
+  if (++_queue_tail >= _queue_size) _queue_tail = 0;
+  _queue_held = false;
+  // In kStopState the interrupts leave `params` alone, so we are the producer.
+  // Bar the timer's, which may be trying to queue it too. See readTimeout().
 #if defined(ESP8266)
-/// Interrupt handler for when the timer runs out.
-/// It signals to the library that capturing of IR data has stopped.
-/// @param[in] arg Unused. (ESP8266 Only)
-static void USE_IRAM_ATTR read_timeout(void *arg __attribute__((unused))) {
   os_intr_lock();
 #endif  // ESP8266
-/// @cond IGNORE
 #if defined(ESP32)
-/// Interrupt handler for when the timer runs out.
+  portENTER_CRITICAL(&mux);
+#endif  // ESP32
+  if (params.rcvstate == kStopState && params.rawlen) _queueCapture();
+#if defined(ESP8266)
+  os_intr_unlock();
+#endif  // ESP8266
+#if defined(ESP32)
+  portEXIT_CRITICAL(&mux);
+#endif  // ESP32
+}
+
+/// Take the oldest capture from the queue & point the results at it.
+/// @param[out] results A ptr to where the capture should be pointed to.
+/// @param[in,out] save An optional irparams_t to copy the capture into.
+///   If given, the slot is handed straight back to the queue.
+/// @param[in] swap Trade buffers with `save` rather than copying into it.
+///   Only if we own `save`'s buffer.
+/// @return true, if there was a capture waiting, otherwise false.
+bool IRrecv::_dequeueCapture(decode_results *results, irparams_t *save,
+                             const bool swap) {
+  _releaseCapture();
+  volatile capture_slot_t *slot = &_queue[_queue_tail];
+  uint16_t rawlen = slot->rawlen;
+  if (!rawlen) return false;  // Nothing has been captured yet.
+  uint16_t *rawbuf = slot->rawbuf;
+  const bool overflow = slot->overflow;
+  // Clear the junk entry after the capture, if it has one. See decode().
+  const bool full = rawlen >= params.bufsize;
+  if (!full && !_compact) rawbuf[rawlen] = 0;
+  _timestamp = slot->timestamp;
+  _queue_held = true;
+  if (save != NULL) {
+    if (_compact) {  // Expand it. It can't be decoded as it is.
+      _expandCapture(rawbuf, rawlen, save);
+    } else if (swap) {
+      slot->rawbuf = save->rawbuf;
+      save->rawbuf = rawbuf;
+      save->rawlen = rawlen;
+    } else {
+      for (uint16_t i = 0; i < rawlen; i++) save->rawbuf[i] = rawbuf[i];
+      if (!full) save->rawbuf[rawlen] = 0;
+      save->rawlen = rawlen;
+    }
+    save->overflow = overflow;
+    save->timestamp = _timestamp;
+    _releaseCapture();
+    rawbuf = save->rawbuf;
+    rawlen = save->rawlen;
+  }
+  results->rawbuf = rawbuf;
+  results->rawlen = rawlen;
+  results->overflow = overflow;
+  return true;
+}
+
+/// Free all the memory used by the capture queue, and disable it.
+void IRrecv::_freeCaptureQueue(void) {
+  if (_queue != NULL) {
+    for (uint8_t i = 0; i < _queue_size; i++) delete[] _queue[i].rawbuf;
+    delete[] _queue;
+  }
+  _next_rawbuf = NULL;  // It may have been in one of them.
+  _queue = NULL;
+  _queue_size = 0;
+  _queue_head = 0;
+  _queue_tail = 0;
+  _queue_held = false;
+}
+
+namespace _IRrecv {  // Namespace extension
+/// Nr. of ticks (kRawTick uSecs) in a compact tick.
+const uint16_t kCompactRatio = kCompactTick / kRawTick;
+
+/// Store an entry in a compact capture.
+/// Most entries fit in a byte, as a multiple of kCompactTick. Longer ones take
+/// three. kCompactEscape, then the entry in ticks. (LSB first)
+/// @param[out] compact The compact capture.
+/// @param[in] size Nr. of bytes `compact` can hold.
+/// @param[in] pos Where in `compact` to store it.
+/// @param[in] ticks The entry, in ticks. (kRawTick uSecs)
+/// @return The nr. of bytes used. 0 if there wasn't room for it.
+uint8_t USE_IRAM_ATTR storeCompact(uint8_t *compact, const uint16_t size,
+                                   const uint16_t pos, const uint32_t ticks) {
+  const uint32_t coarse = (ticks + kCompactRatio / 2) / kCompactRatio;
+  if (coarse < kCompactEscape) {
+    if (pos >= size) return 0;
+    compact[pos] = coarse;
+    return 1;
+  }
+  if (pos + 3 > size) return 0;
+  const uint16_t whole = std::min(ticks, (uint32_t)UINT16_MAX);
+  compact[pos] = kCompactEscape;
+  compact[pos + 1] = whole;
+  compact[pos + 2] = whole >> 8;
+  return 3;
+}
+
+/// Expand a compact capture into normal entries. i.e. Ticks.
+/// @param[in] compact The compact capture.
+/// @param[in] size Nr. of bytes in `compact`.
+/// @param[out] rawbuf Where to put the entries.
+/// @param[in] max Nr. of entries `rawbuf` can hold.
+/// @param[out] used Nr. of bytes of `compact` expanded. NULL if not wanted.
+///   Less than `size` means they didn't all fit.
+/// @return The nr. of entries in `rawbuf`.
+uint16_t expandCompact(const uint8_t *compact, const uint16_t size,
+                       uint16_t *rawbuf, const uint16_t max, uint16_t *used) {
+  uint16_t pos = 0;
+  uint16_t rawlen = 0;
+  while (pos < size && rawlen < max) {
+    if (compact[pos] != kCompactEscape) {
+      rawbuf[rawlen++] = compact[pos++] * kCompactRatio;
+    } else {
+      if (pos + 3 > size) break;  // It's been cut short.
+      rawbuf[rawlen++] = compact[pos + 1] | (compact[pos + 2] << 8);
+      pos += 3;
+    }
+  }
+  if (used != NULL) *used = pos;
+  return rawlen;
+}
+}  // namespace _IRrecv
+
+/// Allocate a capture buffer, for the interrupts or the capture queue.
+/// In the compact format, it has getBufSize() bytes rather than entries.
+/// @return A PTR to the buffer, or NULL if we ran out of memory.
+uint16_t *IRrecv::_newCaptureBuffer(void) {
+  return new uint16_t[_compact ? (params.bufsize + 1) / 2 : params.bufsize];
+}
+
+/// Expand a compact capture into a buffer we can decode.
+/// @param[in] rawbuf The compact capture.
+/// @param[in] rawlen Nr. of bytes in it.
+/// @param[out] dst Where to expand it to. Only `rawbuf` & `rawlen` are set.
+///   `rawbuf` must have room for getBufSize() entries.
+void IRrecv::_expandCapture(const uint16_t *rawbuf, const uint16_t rawlen,
+                            irparams_t *dst) {
+  const uint16_t bufsize = params.bufsize;
+  dst->rawlen = _IRrecv::expandCompact(
+      reinterpret_cast<const uint8_t *>(rawbuf), rawlen, dst->rawbuf, bufsize);
+  // Clear the junk entry after the capture, if it has one. See decode().
+  if (dst->rawlen < bufsize) dst->rawbuf[dst->rawlen] = 0;
+}
+
+#ifndef UNIT_TEST
+namespace _IRrecv {  // Namespace extension
+/// Interrupt handler for when a receiver's timer runs out.
 /// It signals to the library that capturing of IR data has stopped.
-/// @note ESP32 version
-static void USE_IRAM_ATTR read_timeout(void) {
-/// @endcond
+/// @param[in] irrecv The receiver whose timer it is.
+void USE_IRAM_ATTR readTimeout(IRrecv *irrecv) {
+#if defined(ESP8266)
+  os_intr_lock();
+#endif  // ESP8266
+#if defined(ESP32)
   portENTER_CRITICAL(&mux);
 #endif  // ESP32
-  if (params.rawlen) params.rcvstate = kStopState;
+  if (irrecv->params.rawlen) {
+    irrecv->params.rcvstate = kStopState;
+    irrecv->_queueCapture();
+  }
 #if defined(ESP8266)
   os_intr_unlock();
 #endif  // ESP8266
@@ -180,16 +364,21 @@ static void USE_IRAM_ATTR read_timeout(void) {
 #endif  // ESP32
 }
 
-/// Interrupt handler for changes on the GPIO pin handling incoming IR messages.
-static void USE_IRAM_ATTR gpio_intr() {
+/// Interrupt handler for changes on a receiver's GPIO pin.
+/// @param[in] irrecv The receiver whose pin it is.
+void USE_IRAM_ATTR gpioIntr(IRrecv *irrecv) {
   uint32_t now = micros();
-  static uint32_t start = 0;
+  volatile irparams_t *params = &irrecv->params;
 
 #if defined(ESP8266)
+  ETSTimer *timer = &timers[irrecv->_slot];
   uint32_t gpio_status = GPIO_REG_READ(GPIO_STATUS_ADDRESS);
-  os_timer_disarm(&timer);
+  os_timer_disarm(timer);
   GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, gpio_status);
 #endif  // ESP8266
+#if defined(ESP32)
+  hw_timer_t *timer = timers[irrecv->_slot];
+#endif  // ESP32
 
   // Grab a local copy of rawlen to reduce instructions used in IRAM.
   // This is an ugly premature optimisation code-wise, but we do everything we
@@ -197,30 +386,53 @@ static void USE_IRAM_ATTR gpio_intr() {
   // It seems referencing the value via the structure uses more instructions.
   // Less instructions means faster and less IRAM used.
   // N.B. It saves about 13 bytes of IRAM.
-  uint16_t rawlen = params.rawlen;
+  uint16_t rawlen = params->rawlen;
 
-  if (rawlen >= params.bufsize) {
-    params.overflow = true;
-    params.rcvstate = kStopState;
+  if (rawlen >= params->bufsize) {
+    params->overflow = true;
+    params->rcvstate = kStopState;
   }
 
-  if (params.rcvstate == kStopState) return;
-
-  if (params.rcvstate == kIdleState) {
-    params.rcvstate = kMarkState;
-    params.rawbuf[rawlen] = 1;
+  if (params->rcvstate == kStopState) {
+    // Nowhere to put it. Count each lost message once, by its first edge.
+    if (now - irrecv->_last_edge >= MS_TO_USEC(params->timeout))
+      irrecv->_drops++;
+    irrecv->_last_edge = now;
+    // Without a queue, it stays stopped until resume(). With one, the timer
+    // must still fire once the message is over, as it's what queues it.
+    // e.g. After an overflow, or the timer we disarmed above never would.
+    if (!irrecv->_queue_size) return;
   } else {
-    if (now < start)
-      params.rawbuf[rawlen] = (UINT32_MAX - start + now) / kRawTick;
-    else
-      params.rawbuf[rawlen] = (now - start) / kRawTick;
-  }
-  params.rawlen++;
+    uint32_t ticks = 1;  // The first entry of a capture.
+    if (params->rcvstate == kIdleState) {
+      params->rcvstate = kMarkState;
+      params->timestamp = now;
+    } else {
+      const uint32_t start = irrecv->_last_edge;
+      if (now < start)
+        ticks = (UINT32_MAX - start + now) / kRawTick;
+      else
+        ticks = (now - start) / kRawTick;
+    }
+    if (irrecv->_compact) {
+      const uint8_t used = storeCompact(
+          reinterpret_cast<uint8_t *>(params->rawbuf), params->bufsize,
+          rawlen, ticks);
+      if (!used) {  // No room for a long entry. It's full.
+        params->overflow = true;
+        params->rcvstate = kStopState;
+      }
+      params->rawlen = rawlen + used;
+    } else {
+      params->rawbuf[rawlen] = ticks;
+      params->rawlen++;
+    }
 
-  start = now;
+    irrecv->_last_edge = now;
+  }
 
 #if defined(ESP8266)
-  os_timer_arm(&timer, params.timeout, ONCE);
+  os_timer_arm(timer, params->timeout, ONCE);
 #endif  // ESP8266
 #if defined(ESP32)
   // Reset the timeout.
@@ -247,6 +459,39 @@ static void USE_IRAM_ATTR gpio_intr() {
 #endif  // _ESP32_IRRECV_TIMER_HACK
 #endif  // ESP32
 }
+
+// The interrupt trampolines. attachInterrupt() & timerAttachInterrupt() can't
+// pass an argument to a handler, so each slot gets its own that knows which
+// receiver it is for.
+/// @cond IGNORE
+static void USE_IRAM_ATTR gpio_intr_0(void) { gpioIntr(receivers[0]); }
+static void USE_IRAM_ATTR gpio_intr_1(void) { gpioIntr(receivers[1]); }
+static void USE_IRAM_ATTR gpio_intr_2(void) { gpioIntr(receivers[2]); }
+static void USE_IRAM_ATTR gpio_intr_3(void) { gpioIntr(receivers[3]); }
+/// @endcond
+// The GPIO interrupt handler of each slot. One per kMaxReceivers.
+static void (* const kGpioIntrs[kMaxReceivers])(void) = {
+    gpio_intr_0, gpio_intr_1, gpio_intr_2, gpio_intr_3};
+
+#if defined(ESP8266)
+/// Timer callback for when a receiver's timer runs out.
+/// @param[in] arg The receiver whose timer it is. (ESP8266 Only)
+static void USE_IRAM_ATTR read_timeout(void *arg) {
+  readTimeout(static_cast<IRrecv *>(arg));
+}
+#endif  // ESP8266
+#if defined(ESP32)
+/// @cond IGNORE
+static void USE_IRAM_ATTR read_timeout_0(void) { readTimeout(receivers[0]); }
+static void USE_IRAM_ATTR read_timeout_1(void) { readTimeout(receivers[1]); }
+static void USE_IRAM_ATTR read_timeout_2(void) { readTimeout(receivers[2]); }
+static void USE_IRAM_ATTR read_timeout_3(void) { readTimeout(receivers[3]); }
+/// @endcond
+// The timer interrupt handler of each slot. One per kMaxReceivers.
+static void (* const kReadTimeouts[kMaxReceivers])(void) = {
+    read_timeout_0, read_timeout_1, read_timeout_2, read_timeout_3};
+#endif  // ESP32
+}  // namespace _IRrecv
 #endif  // UNIT_TEST
 
 // Start of IRrecv class -------------------
@@ -296,6 +541,10 @@ IRrecv::IRrecv(const uint16_t recvpin, const uint16_t bufsize,
   // Ensure we are going to be able to store all possible values in the
   // capture buffer.
   params.timeout = std::min(timeout, (uint8_t)kMaxTimeoutMs);
+  params.rcvstate = kIdleState;
+  params.rawlen = 0;
+  params.overflow = false;
+  params.timestamp = 0;
   params.rawbuf = new uint16_t[bufsize];
   if (params.rawbuf == NULL) {
     DPRINTLN(
@@ -321,10 +570,55 @@ IRrecv::IRrecv(const uint16_t recvpin, const uint16_t bufsize,
   } else {
     params_save = NULL;
   }
+  _queue = NULL;
+  _freeCaptureQueue();
+  _compact = false;
+  _drops = 0;
+  _timestamp = 0;
+  _last_edge = 0;
+#ifdef UNIT_TEST
+  _timer_armed = false;
+#endif  // UNIT_TEST
+  // Claim an interrupt slot, so we can capture alongside other receivers.
+  _slot = kMaxReceivers;
+  for (uint8_t i = 0; i < kMaxReceivers; i++)
+    if (_IRrecv::receivers[i] == NULL) {
+      _IRrecv::receivers[i] = this;
+      _slot = i;
+      break;
+    }
 #if DECODE_HASH
   _unknown_threshold = kUnknownThreshold;
 #endif  // DECODE_HASH
   _tolerance = kTolerance;
+  _incremental = false;
+  _stream_start = 0;
+  _stream_tried = 0;
+  _next_rawbuf = NULL;
+  _decode_as = UNUSED;
+  setAllProtocolsEnabled(true);
+  _order = NULL;
+  _hits = NULL;
+  setCandidates(NULL, 0);
+  _cache = NULL;
+  setDecodeCache(0);
+  setDecodeBudget(0, 0);
+  _pending = false;
+  _pending_resume = false;
+  _residual = 0;
+  _residual_count = 0;
+  _bit_run_slots = kBitRunCacheSize;
+  _bit_run_count = 0;
+  _bit_run_next = 0;
+  _bit_runs_active = false;
+  _segment_state = NULL;
+  _segment_candidates = 0;
+#if ENABLE_NOISE_FILTER_OPTION
+  _noise_filter = kNoiseFilterMerge;
+#endif  // ENABLE_NOISE_FILTER_OPTION
+#if ENABLE_DECODE_STATS
+  resetDecodeStats();
+#endif  // ENABLE_DECODE_STATS
 }
 
 /// Class destructor
@@ -332,10 +626,13 @@ IRrecv::IRrecv(const uint16_t recvpin, const uint16_t bufsize,
 /// e.g. Frees up all memory used by the various buffers, and disables any
 /// timers or interrupts used.
 IRrecv::~IRrecv(void) {
-  disableIRIn();
-#if defined(ESP32)
-  if (timer != NULL) timerEnd(timer);  // Cleanup the ESP32 timeout timer.
-#endif  // ESP32
+  disableIRIn();  // Also cleans up the ESP32 timeout timer.
+  // Free up our interrupt slot.
+  if (_slot < kMaxReceivers) _IRrecv::receivers[_slot] = NULL;
+  _freeCaptureQueue();
+  setAdaptiveOrder(false);
+  setSegmentedDecode(false);
+  setDecodeCache(0);
   delete[] params.rawbuf;
   if (params_save != NULL) {
     delete[] params_save->rawbuf;
@@ -346,7 +643,16 @@ IRrecv::~IRrecv(void) {
 /// Set up and (re)start the IR capture mechanism.
 /// @param[in] pullup A flag indicating should the GPIO use the internal pullup
 /// resistor. (Default: `false`. i.e. No.)
+/// @note Up to kMaxReceivers objects can capture at the same time, each from
+///   its own pin (and timer on the ESP32) into its own buffers. Any more than
+///   that won't capture anything.
 void IRrecv::enableIRIn(const bool pullup) {
+#ifndef UNIT_TEST
+  if (_slot >= kMaxReceivers) {
+    DPRINTLN("No free interrupt slot for another IR receiver.");
+    return;
+  }
+#endif  // UNIT_TEST
   // ESP32's seem to require explicitly setting the GPIO to INPUT etc.
   // This wasn't required on the ESP8266s, but it shouldn't hurt to make sure.
   if (pullup) {
@@ -359,7 +665,8 @@ void IRrecv::enableIRIn(const bool pullup) {
 #if defined(ESP32)
   // Initialise the ESP32 timer.
   // 80MHz / 80 = 1 uSec granularity.
-  timer = timerBegin(_timer_num, 80, true);
+  hw_timer_t *timer = timerBegin(_timer_num, 80, true);
+  timers[_slot] = timer;
 #ifdef DEBUG
   if (timer == NULL) {
     DPRINT("FATAL: Unable enable system timer: ");
@@ -372,21 +679,23 @@ void IRrecv::enableIRIn(const bool pullup) {
   // Note: Interrupt needs to be attached before it can be enabled or disabled.
   // Note: EDGE (true) is not supported, use LEVEL (false). Ref: #1713
   // See: https://github.com/espressif/arduino-esp32/blob/caef4006af491130136b219c1205bdcf8f08bf2b/cores/esp32/esp32-hal-timer.c#L224-L227
-  timerAttachInterrupt(timer, &read_timeout, false);
+  timerAttachInterrupt(timer, _IRrecv::kReadTimeouts[_slot], false);
 #endif  // ESP32
 
   // Initialise state machine variables
+  _drops = 0;
+  params.rcvstate = kStopState;  // So resume() always starts afresh.
   resume();
 
 #ifndef UNIT_TEST
 #if defined(ESP8266)
   // Initialise ESP8266 timer.
-  os_timer_disarm(&timer);
-  os_timer_setfn(&timer, reinterpret_cast<os_timer_func_t *>(read_timeout),
-                 NULL);
+  ETSTimer *timer = &timers[_slot];
+  os_timer_disarm(timer);
+  os_timer_setfn(timer, _IRrecv::read_timeout, this);
 #endif  // ESP8266
   // Attach Interrupt
-  attachInterrupt(params.recvpin, gpio_intr, CHANGE);
+  attachInterrupt(params.recvpin, _IRrecv::kGpioIntrs[_slot], CHANGE);
 #endif  // UNIT_TEST
 }
 
@@ -394,13 +703,17 @@ void IRrecv::enableIRIn(const bool pullup) {
 /// Disable any timers and interrupts.
 void IRrecv::disableIRIn(void) {
 #ifndef UNIT_TEST
+  if (_slot >= kMaxReceivers) return;  // We never had any interrupts.
 #if defined(ESP8266)
-  os_timer_disarm(&timer);
+  os_timer_disarm(&timers[_slot]);
 #endif  // ESP8266
 #if defined(ESP32)
-  timerAlarmDisable(timer);
-  timerDetachInterrupt(timer);
-  timerEnd(timer);
+  if (timers[_slot] != NULL) {
+    timerAlarmDisable(timers[_slot]);
+    timerDetachInterrupt(timers[_slot]);
+    timerEnd(timers[_slot]);
+    timers[_slot] = NULL;
+  }
 #endif  // ESP32
   detachInterrupt(params.recvpin);
 #endif  // UNIT_TEST
@@ -420,42 +733,86 @@ void IRrecv::pause(void) {
 /// Resume collection of received IR data.
 /// @note This is required if `decode()` is successful and `save_buffer` was
 ///   not set when the class was instanciated.
+/// @note With a capture queue, or incremental decoding, this only restarts
+///   capturing if it had stopped. A capture queue also gets the last decoded
+///   capture handed back to it.
+/// @note It also abandons a decode that is still pending.
+///   See setDecodeBudget().
 /// @see IRrecv class constructor
 void IRrecv::resume(void) {
+  _pending = false;  // Abandon any decode in progress.
+  if (_queue_size) {
+    _releaseCapture();
+    if (params.rcvstate != kStopState) return;  // Still capturing.
+  }
+  // decodeNext() can't carry on with a capture that is about to be reused.
+  if (_next_rawbuf >= params.rawbuf &&
+      _next_rawbuf < params.rawbuf + params.bufsize)
+    _next_rawbuf = NULL;
+  // Don't cut off a message that is still arriving after an early decode.
+  if (_incremental && (params.rcvstate == kMarkState ||
+                       params.rcvstate == kSpaceState)) return;
+  _stream_start = 0;
+  _stream_tried = 0;
   params.rcvstate = kIdleState;
   params.rawlen = 0;
   params.overflow = false;
 #if defined(ESP32)
-  timerAlarmDisable(timer);
+  if (_slot < kMaxReceivers && timers[_slot] != NULL)
+    timerAlarmDisable(timers[_slot]);
   gpio_intr_enable((gpio_num_t)params.recvpin);
 #endif  // ESP32
 }
 
-/// Make a copy of the interrupt state & buffer data.
+/// Make a copy of the interrupt state, but not of the buffer data.
 /// Needed because irparams is marked as volatile, thus memcpy() isn't allowed.
-/// Only call this when you know the interrupt handlers won't modify anything.
-/// i.e. In kStopState.
+/// @note `dst->rawbuf` ends up pointing to the same buffer as `src->rawbuf`.
 /// @param[in] src Pointer to an irparams_t structure to copy from.
 /// @param[out] dst Pointer to an irparams_t structure to copy to.
-void IRrecv::copyIrParams(volatile irparams_t *src, irparams_t *dst) {
+static void copyIrState(volatile irparams_t *src, irparams_t *dst) {
   // Typecast src and dst addresses to (char *)
   char *csrc = (char *)src;  // NOLINT(readability/casting)
   char *cdst = (char *)dst;  // NOLINT(readability/casting)
 
+  // Copy contents of src[] to dst[]
+  for (uint16_t i = 0; i < sizeof(irparams_t); i++) cdst[i] = csrc[i];
+}
+
+/// Make a copy of the interrupt state & buffer data.
+/// Only the `rawlen` entries captured (plus the zeroed entry after them, if
+/// there is room for it) are copied, not the entire buffer.
+/// Only call this when you know the interrupt handlers won't modify anything.
+/// i.e. In kStopState.
+/// @param[in] src Pointer to an irparams_t structure to copy from.
+/// @param[out] dst Pointer to an irparams_t structure to copy to.
+void IRrecv::copyIrParams(volatile irparams_t *src, irparams_t *dst) {
   // Save the pointer to the destination's rawbuf so we don't lose it as
-  // the for-loop/copy after this will overwrite it with src's rawbuf pointer.
-  // This isn't immediately obvious due to typecasting/different variable names.
+  // the copy after this will overwrite it with src's rawbuf pointer.
   uint16_t *dst_rawbuf_ptr;
   dst_rawbuf_ptr = dst->rawbuf;
 
-  // Copy contents of src[] to dst[]
-  for (uint16_t i = 0; i < sizeof(irparams_t); i++) cdst[i] = csrc[i];
+  copyIrState(src, dst);
 
   // Restore the buffer pointer
   dst->rawbuf = dst_rawbuf_ptr;
 
-  // Copy the rawbuf
-  for (uint16_t i = 0; i < dst->bufsize; i++) dst->rawbuf[i] = src->rawbuf[i];
+  // Copy the used part of the rawbuf
+  const uint16_t len = std::min((uint16_t)(dst->rawlen + 1), dst->bufsize);
+  for (uint16_t i = 0; i < len; i++) dst->rawbuf[i] = src->rawbuf[i];
+}
+
+/// Move the interrupt state & buffer data to `dst`, without copying the data.
+/// The two structures trade capture buffers instead. i.e. `src` gets the
+/// buffer `dst` had, ready for capturing the next message into.
+/// Only call this when you know the interrupt handlers won't modify anything.
+/// i.e. In kStopState.
+/// @param[in,out] src Pointer to an irparams_t structure to move from.
+/// @param[in,out] dst Pointer to an irparams_t structure to move to.
+/// @note Both buffers must have `bufsize` entries, and be owned by the class.
+void IRrecv::swapIrParams(volatile irparams_t *src, irparams_t *dst) {
+  uint16_t *spare = dst->rawbuf;
+  copyIrState(src, dst);
+  src->rawbuf = spare;
 }
 
 /// Obtain the maximum number of entries possible in the capture buffer.
@@ -463,6 +820,104 @@ void IRrecv::copyIrParams(volatile irparams_t *src, irparams_t *dst) {
 /// @return The size of the buffer that is in use by the object.
 uint16_t IRrecv::getBufSize(void) { return params.bufsize; }
 
+/// Set how many completed captures can wait to be decoded.
+/// While captures wait in the queue, the next message is already being
+/// captured. i.e. Bursts of messages aren't lost while we are busy decoding.
+/// decode() returns the captures in the order they arrived.
+/// @param[in] size Nr. of captures the queue can hold. 0 disables it.
+///   Each one costs another capture buffer of getBufSize() entries. (Or
+///   bytes. See setCompactCapture().)
+/// @note Only call this when capturing is disabled. i.e. Before enableIRIn(),
+///   or after disableIRIn(). Any captures already queued are discarded.
+/// @return true, if successful. false, if we ran out of memory. In which case
+///   the queue is disabled.
+bool IRrecv::setCaptureQueueSize(const uint8_t size) {
+  _freeCaptureQueue();
+  if (!size) return true;
+  capture_slot_t *queue = new capture_slot_t[size];
+  if (queue == NULL) return false;
+  for (uint8_t i = 0; i < size; i++) {
+    queue[i].rawbuf = _newCaptureBuffer();
+    queue[i].rawlen = 0;
+    queue[i].overflow = false;
+    queue[i].timestamp = 0;
+    if (queue[i].rawbuf == NULL) {
+      DPRINTLN("Could not allocate memory for the IR capture queue.");
+      for (uint8_t j = 0; j < i; j++) delete[] queue[j].rawbuf;
+      delete[] queue;
+      return false;
+    }
+  }
+  _queue = queue;
+  _queue_size = size;
+  return true;
+}
+
+/// Get how many completed captures the queue can hold.
+/// @return The nr. of captures. 0 means there is no queue.
+uint8_t IRrecv::getCaptureQueueSize(void) { return _queue_size; }
+
+/// Set if captures are stored in the compact format.
+/// Most entries take one byte rather than two, in multiples of kCompactTick
+/// (rather than kRawTick) uSecs. Ones too long for that take three bytes.
+/// The interrupt's capture buffer & each capture queue slot shrink to
+/// getBufSize() bytes. i.e. About twice the nr. of queued captures fit in the
+/// same memory.
+/// decode() expands each capture into the save buffer before decoding it, so
+/// the decoders, & the results they return, are unchanged. That save buffer
+/// still has getBufSize() entries. So the longest message that can be
+/// captured is the same, & without a queue the memory used only drops from
+/// four to three times getBufSize() bytes.
+/// @param[in] enable true to use the compact format, false for the normal one.
+/// @note Only call this when capturing is disabled. i.e. Before enableIRIn(),
+///   or after disableIRIn(). Any captures already made are discarded.
+/// @note It needs a save buffer to decode from. See the class constructor.
+/// @note The timings are only accurate to kCompactTick / 2 uSecs.
+/// @note decodeDiversity() ignores captures in the compact format.
+/// @return true, if successful. false, if there is no save buffer or we ran
+///   out of memory. In which case the normal format is used.
+bool IRrecv::setCompactCapture(const bool enable) {
+  if (enable && params_save == NULL) return false;
+  const uint8_t queue_size = _queue_size;
+  _freeCaptureQueue();
+  if (_next_rawbuf == params.rawbuf) _next_rawbuf = NULL;
+  delete[] params.rawbuf;
+  _compact = enable;
+  params.rawbuf = _newCaptureBuffer();
+  if (params.rawbuf == NULL && _compact) {
+    _compact = false;
+    params.rawbuf = _newCaptureBuffer();
+  }
+  params.rawlen = 0;
+  params.overflow = false;
+  return setCaptureQueueSize(queue_size) && _compact == enable;
+}
+
+/// Get if captures are stored in the compact format.
+/// @return true, if they are, otherwise false.
+bool IRrecv::getCompactCapture(void) { return _compact; }
+
+/// Get how many completed captures are waiting in the queue for decode().
+/// @return The nr. of captures.
+uint8_t IRrecv::getCapturesPending(void) {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < _queue_size; i++)
+    if (_queue[i].rawlen) count++;
+  // The slot lent to the last decode() has already been read.
+  if (_queue_held) count--;
+  return count;
+}
+
+/// Get how many messages were lost because there was nowhere to capture them.
+/// i.e. They arrived while the capture buffer was waiting to be decoded or
+/// resumed, and the capture queue (if any) was full.
+/// @return The nr. of messages lost since enableIRIn().
+uint32_t IRrecv::getCaptureDrops(void) { return _drops; }
+
+/// Get when the capture returned by the last decode() started.
+/// @return The value of micros() at the first edge of the capture.
+uint32_t IRrecv::getCaptureTimestamp(void) { return _timestamp; }
+
 #if DECODE_HASH
 /// Set the minimum length we will consider for reporting UNKNOWN message types.
 /// @param[in] length Min nr. of mark/space pulses required to be considered.
@@ -482,726 +937,2782 @@ void IRrecv::setTolerance(const uint8_t percent) {
 /// @return A integer percentage.
 uint8_t IRrecv::getTolerance(void) { return _tolerance; }
 
+/// Set if decode() should decode messages while they are still arriving.
+/// Normally a message is only decoded once no signal has been seen for the
+/// `timeout` given to the constructor. That delay can be avoided by decoding
+/// a message as soon as it has all the marks & spaces of a protocol.
+/// @note A protocol that accepts several lengths may be decoded at the
+///   shortest one, if no longer protocol with the same header is enabled.
+///   Use the normal mode if that is a problem for you.
+/// @note Incremental decoding isn't used with a save buffer or a capture
+///   queue.
+/// @param[in] enable true to decode incrementally, false to wait for the
+///   timeout. (Default)
+void IRrecv::setIncrementalDecode(const bool enable) {
+  _incremental = enable;
+  _stream_start = 0;
+  _stream_tried = 0;
+}
+
+/// Will decode() decode messages while they are still arriving?
+/// @return true, if it will. false, if it waits for the timeout.
+bool IRrecv::getIncrementalDecode(void) { return _incremental; }
+
+/// Set if decode() should try to decode a protocol.
+/// Every protocol is enabled by default. Disabling the ones you don't expect
+/// makes decode() faster, & it can't mistake a message for one of them.
+/// @note Only protocols enabled by their DECODE_* option at compile time can
+///   ever be decoded.
+/// @param[in] protocol The protocol to set. UNKNOWN is the hash decoder.
+/// @param[in] enable true to try it, false to not.
+void IRrecv::setProtocolEnabled(const decode_type_t protocol,
+                                const bool enable) {
+  if (protocol < UNKNOWN || protocol > kLastDecodeType) return;
+  const uint8_t bit = (protocol == UNKNOWN) ? 0 : protocol;
+  if (enable)
+    _enabled[bit / 8] |= 1 << (bit % 8);
+  else
+    _enabled[bit / 8] &= ~(1 << (bit % 8));
+}
+
+/// Set if decode() should try to decode every protocol or none of them.
+/// @param[in] enable true to try them all, false to try none.
+void IRrecv::setAllProtocolsEnabled(const bool enable) {
+  for (uint8_t i = 0; i < sizeof(_enabled); i++)
+    _enabled[i] = enable ? 0xFF : 0;
+}
+
+/// Will decode() try to decode a protocol?
+/// @param[in] protocol The protocol to check. UNKNOWN is the hash decoder.
+/// @return true, if it is enabled, otherwise false.
+bool IRrecv::isProtocolEnabled(const decode_type_t protocol) {
+  if (protocol < UNKNOWN || protocol > kLastDecodeType) return false;
+  const uint8_t bit = (protocol == UNKNOWN) ? 0 : protocol;
+  return (_enabled[bit / 8] >> (bit % 8)) & 1;
+}
+
+/// Set if decode() should rank every protocol that can decode a capture,
+/// rather than use the first one that does.
+/// Each decode is scored by how closely the capture's timings match the
+/// protocol's nominal ones. decode() returns the best one, & the rest are kept
+/// in the buffer, best first.
+/// @note It stops early if a candidate gets the maximum score, or when the
+///   buffer is full. So `size` is a budget for the work done.
+/// @note Protocols still have to be enabled. See setProtocolEnabled().
+/// @param[in] candidates A PTR to where to store the candidates. NULL disables
+///   ranking. The buffer must stay valid until then.
+/// @param[in] size The nr. of candidates the buffer can hold.
+void IRrecv::setCandidates(decode_candidate_t *candidates, const uint8_t size) {
+  _candidates = size ? candidates : NULL;
+  _candidates_size = (candidates != NULL) ? size : 0;
+  _candidate_count = 0;
+}
+
+/// How many candidates did the last decode() find?
+/// @return The nr. of candidates stored by the last decode. See
+///   setCandidates().
+uint8_t IRrecv::getCandidateCount(void) { return _candidate_count; }
+
+/// Limit how much work each call of decode() does, so a long chain of decoders
+/// over a large capture doesn't block the rest of the program for too long.
+/// When the budget runs out, decode() returns false & isDecodePending() is
+/// true. The capture stays pinned, & the next decode() call carries on where
+/// the last one stopped, rather than fetching a new capture.
+/// @note At least one decoder is tried per call, so it always makes progress.
+/// @note Not used by decodeAs(), or with incremental decoding.
+/// @note resume() abandons a pending decode.
+/// @param[in] usecs Max nr. of microseconds to spend per call. 0 is no limit.
+///   It is checked between decoders, so a call can run over by one decoder.
+/// @param[in] decoders Max nr. of protocol decoders to try per call. 0 is no
+///   limit.
+void IRrecv::setDecodeBudget(const uint32_t usecs, const uint16_t decoders) {
+  _budget_usecs = usecs;
+  _budget_decoders = decoders;
+}
+
+/// Did decode() run out of budget before it finished with a capture?
+/// @return true, if the next decode() call will carry on with it.
+///   See setDecodeBudget().
+bool IRrecv::isDecodePending(void) { return _pending; }
+
+#if ENABLE_DECODE_STATS
+/// Get the statistics collected on a protocol's decoder(s).
+/// Only protocols that decode() tries are counted. i.e. Not the hash decoder.
+/// Rejections are counted by the position in the capture they got to. i.e.
+/// The offset they started at, plus the nr. of entries they matched. Those
+/// that give up straight away end up in bucket 0 or 1.
+/// @param[in] protocol The protocol to get the statistics for.
+/// @return A copy of the statistics. All zeros for an unknown protocol.
+decode_stats_t IRrecv::getDecodeStats(const decode_type_t protocol) {
+  if (protocol < 0 || protocol > kLastDecodeType) {
+    decode_stats_t none = {};
+    return none;
+  }
+  return _stats[protocol];
+}
+
+/// Reset all of the decoder statistics back to zero.
+void IRrecv::resetDecodeStats(void) {
+  for (uint16_t i = 0; i <= kLastDecodeType; i++) {
+    _stats[i].attempts = 0;
+    _stats[i].successes = 0;
+    _stats[i].usecs = 0;
+    for (uint8_t b = 0; b < kDecodeStatsBuckets; b++) _stats[i].rejects[b] = 0;
+  }
+  _stats_depth = 0;
+}
+
+/// Summarise the decoder statistics as CSV. One line per protocol that has
+/// been tried, after a header line. The `rejects@N` columns are the buckets
+/// of the rejection histogram, named by the first position they count.
+/// e.g. "NEC,12,10,345,0,1,0,0,0,0,1,0"
+/// @return A String containing the statistics.
+String IRrecv::decodeStatsToString(void) {
+  String output = "";
+  output += F("protocol,attempts,successes,usecs");
+  for (uint8_t b = 0; b < kDecodeStatsBuckets; b++) {
+    output += F(",rejects@");
+    output += uint64ToString(b ? 1 << b : 0);
+  }
+  output += F("+\n");
+  for (uint16_t i = 0; i <= kLastDecodeType; i++) {
+    const decode_stats_t *stats = &_stats[i];
+    if (!stats->attempts) continue;
+    output += typeToString((decode_type_t)i);
+    output += ',';
+    output += uint64ToString(stats->attempts);
+    output += ',';
+    output += uint64ToString(stats->successes);
+    output += ',';
+    output += uint64ToString(stats->usecs);
+    for (uint8_t b = 0; b < kDecodeStatsBuckets; b++) {
+      output += ',';
+      output += uint64ToString(stats->rejects[b]);
+    }
+    output += '\n';
+  }
+  return output;
+}
+#endif  // ENABLE_DECODE_STATS
+
 #if ENABLE_NOISE_FILTER_OPTION
 /// Remove or merge pulses in the capture buffer that are too short.
+/// It is done in a single pass, so it is linear in the size of the capture.
 /// @param[in,out] results Ptr to the decode_results we are going to filter.
 /// @param[in] floor Only allow values in the buffer large than this.
 ///   (in microSeconds)
+/// @see setNoiseFilter() for how the short pulses are handled.
 void IRrecv::crudeNoiseFilter(decode_results *results, const uint16_t floor) {
   if (floor == 0) return;  // Nothing to do.
   const uint16_t kTickFloor = floor / kRawTick;
   const uint16_t kBufSize = getBufSize();
-  uint16_t offset = kStartOffset;
-  while (offset < results->rawlen && offset + 2 < kBufSize) {
-    uint16_t curr = results->rawbuf[offset];
-    uint16_t next = results->rawbuf[offset + 1];
-    uint16_t addition = curr + next;
+  const uint16_t rawlen = results->rawlen;
+  uint16_t *rawbuf = results->rawbuf;
+  // Read from `in` & write what we keep to `out`. `out` can never get ahead
+  // of `in`, so we can do it in place.
+  uint16_t in = kStartOffset;
+  uint16_t out = kStartOffset;
+  while (in < rawlen && out + 2 < kBufSize) {
+    const uint16_t curr = rawbuf[in];
     if (curr < kTickFloor) {  // Is it too short?
-      // Shuffle the buffer down. i.e. Remove the mark & space pair.
-      // Note: `memcpy()` can't be used as rawbuf is `volatile`.
-      for (uint16_t i = offset + 2; i <= results->rawlen && i < kBufSize; i++)
-        results->rawbuf[i - 2] = results->rawbuf[i];
-      if (offset > 1) {  // There is a previous pair we can add to.
+      const uint16_t next = (in + 1 < kBufSize) ? rawbuf[in + 1] : 0;
+      if (_noise_filter == kNoiseFilterSpike) {
+        // Only remove it if it is on its own. i.e. Between two longer pulses.
+        if (out > kStartOffset && in + 1 < rawlen &&
+            rawbuf[out - 1] >= kTickFloor && next >= kTickFloor) {
+          rawbuf[out - 1] += curr + next;  // e.g. space + spike + space.
+          in += 2;
+        } else {
+          rawbuf[out++] = rawbuf[in++];  // Keep it.
+        }
+        continue;
+      }
+      // Remove the mark & space pair.
+      if (out > 1) {  // There is a previous pair we can add to.
         // Merge this pair into into the previous space.
-        results->rawbuf[offset - 1] += addition;
+        rawbuf[out - 1] += curr + next;
       }
-      results->rawlen -= 2;  // Adjust the length.
+      in += 2;
     } else {
-      offset++;  // Move along.
+      rawbuf[out++] = rawbuf[in++];  // Move along.
     }
   }
+  // Move down whatever we didn't get to, & the entry after the end.
+  while (in <= rawlen && in < kBufSize) rawbuf[out++] = rawbuf[in++];
+  results->rawlen = rawlen - (in - out);  // Adjust the length.
 }
+
+/// Set how the noise filter treats pulses shorter than decode()'s noise_floor.
+/// @param[in] type kNoiseFilterMerge (the default) removes every short pulse
+///   & the pulse after it, & adds them to the pulse before it.
+///   kNoiseFilterSpike does the same, but only for an isolated short pulse
+///   between two longer ones. A run of short pulses is left alone, & the total
+///   duration of the capture never changes.
+void IRrecv::setNoiseFilter(const noise_filter_t type) { _noise_filter = type; }
+
+/// Get how the noise filter treats short pulses.
+/// @return The type of noise filter. See setNoiseFilter().
+noise_filter_t IRrecv::getNoiseFilter(void) { return _noise_filter; }
 #endif  // ENABLE_NOISE_FILTER_OPTION
 
-/// Decodes the received IR message.
-/// If the interrupt state is saved, we will immediately resume waiting
-/// for the next IR message to avoid missing messages.
-/// @note There is a trade-off here. Saving the state means less time lost until
-/// we can receiving the next message vs. using more RAM. Choose appropriately.
-/// @param[out] results A PTR to where the decoded IR message will be stored.
-/// @param[out] save A PTR to an irparams_t instance in which to save
-///   the interrupt's memory/state. NULL means don't save it.
-/// @param[in] max_skip Maximum Nr. of pulses at the begining of a capture we
-///   can skip when attempting to find a protocol we can successfully decode.
-///   This parameter can dramatically improve detection of protocols
-///   when there is light IR interference just before an incoming IR
-///   message, however, it comes at a steep performace price.
-///   (Default is 0. No skipping.)
-/// @warning Increasing the `max_skip` value will dramatically (linearly)
-///   increase the cpu time & usage to decode protocols.
-///   e.g. 0 -> 1 will be a 2x increase in cpu usage/time.
-///        0 -> 2 will be a 3x increase etc.
-///   If you are going to do this, consider disabling protocol decoding for
-///   protocols you are not expecting.
-/// @param[in] noise_floor Pulses below this size (in usecs) will be removed or
-///   merged prior to any decoding. This is to try to remove noise/poor
-///   readings & slightly increase the chances of a successful decode but at the
-///   cost of data fidelity & integrity.
-///   (Defaults to 0 usecs. i.e. Don't filter; which is safe!)
-/// @warning DANGER: **Here Be Dragons!**
-///   If you set the `noise_floor` value too high, it **WILL** break decoding
-///   of some protocols. You have been warned!
-///   **Any** non-zero value has the potential to **cook** the captured raw data
-///   i.e. The raw data is going to lie to you.
-///   It may obscure hardware, circuit, & environment issues thus making it
-///   impossible to support you accurately or confidently.
-///     Values of <= 50 usecs will probably be safe.
-///     51 - 100 usecs **might** be okay.
-///     100 - 150 usecs is "Danger, Will Robinson!".
-///     150 - 200 usecs expect broken protocols.
-///     At 200+ usecs, you **have** protocols you can't decode!!
-/// @return A boolean indicating if an IR message is ready or not.
-bool IRrecv::decode(decode_results *results, irparams_t *save,
-                    uint8_t max_skip, uint16_t noise_floor) {
-  // Proceed only if an IR message been received.
-#ifndef UNIT_TEST
-  if (params.rcvstate != kStopState) return false;
+namespace _IRrecv {  // Namespace extension
+/// How cheaply a decoder can be ruled out before it is even called.
+/// Used by `IRrecv::decode()`'s ordered table of decoders.
+typedef struct {
+  uint8_t protocol;        // The decode_type_t the entry is tried as.
+  uint16_t min_remaining;  // Min. nr. of entries needed from the offset.
+  uint16_t hdrmark;        // Nominal leading mark (usecs). 0 means unchecked.
+  uint16_t hdrspace;       // Nominal leading space (usecs). 0 means unchecked.
+  uint16_t min_message;    // Min. nr. of entries in a whole message.
+} decoder_entry_t;
+
+/// The order in which `IRrecv::decode()` tries each protocol, with the
+/// smallest capture & leading mark/space the decoder could ever accept.
+/// The order matters! Some protocols are subsets or look-alikes of others,
+/// so the more specific ones need to be tried first. Every such rule must also
+/// be listed in `kDecoderPrecedence`, as the adaptive order relies on it.
+/// @note `min_remaining` is taken from each decoder's own length check, and
+///   the header values are the nominal ones the decoder first matches against.
+///   Use 0 when a decoder has no fixed value (e.g. optional or variable
+///   headers), as that disables the pre-check for it.
+/// @note `min_message` is a lower bound (i.e. two entries per bit of the
+///   shortest size the decoder accepts) for the entries in a whole message,
+///   footers & gaps between sections included. It is only used to stop an
+///   early decode from cutting a longer message that is still arriving into
+///   shorter ones. e.g. A Pioneer message is two NEC-like sections. Entries
+///   without a checked header use 0, as they would otherwise hold back every
+///   early decode, as do those with short repeat messages (e.g. NEC) where
+///   `min_remaining` already is the bound. The larger of the two is used.
+constexpr decoder_entry_t kDecoderOrder[] = {
+#if DECODE_AIWA_RC_T501
+  // Try decodeAiwaRCT501() before decodeSanyoLC7461() & decodeNEC()
+  // because the protocols are similar. This protocol is more specific than
+  // those ones, so should go before them.
+  {AIWA_RC_T501, 3, 8960, 0, 0},
+#endif  // DECODE_AIWA_RC_T501
+#if DECODE_SANYO
+  // Try decodeSanyoLC7461() before decodeNEC() because the protocols are
+  // similar in timings & structure, but the Sanyo one is much longer than the
+  // NEC protocol (42 vs 32 bits) so this one should be tried first to try to
+  // reduce false detection as a NEC packet.
+  {SANYO_LC7461, 3, 8960, 0, 0},
+#endif  // DECODE_SANYO
+#if DECODE_CARRIER_AC
+  // Try decodeCarrierAC() before decodeNEC() because the protocols are
+  // similar in timings & structure, but the Carrier one is much longer than
+  // the NEC protocol (3x32 bits vs 1x32 bits) so this one should be tried
+  // first to try to reduce false detection as a NEC packet.
+  {CARRIER_AC, 0, 8532, 4228, 3 * 2 * kCarrierAcBits},
+#endif  // DECODE_CARRIER_AC
+#if DECODE_PIONEER
+  // Try decodePioneer() before decodeNEC() because the protocols are
+  // similar in timings & structure, but the Pioneer one is much longer than
+  // the NEC protocol (2x32 bits vs 1x32 bits) so this one should be tried
+  // first to try to reduce false detection as a NEC packet.
+  {PIONEER, 0, 8506, 4191, 2 * kPioneerBits},
+#endif  // DECODE_PIONEER
+#if DECODE_EPSON
+  // Try decodeEpson() before decodeNEC() because the protocols are
+  // similar in timings & structure, but the Epson one is much longer than the
+  // NEC protocol (3x32 identical bits vs 1x32 bits) so this one should be tried
+  // first to try to reduce false detection as a NEC packet.
+  {EPSON, 0, 8960, 4480, 2 * kEpsonBits},
+#endif  // DECODE_EPSON
+#if DECODE_NEC
+  {NEC, 3, 8960, 0, 0},
+#endif  // DECODE_NEC
+#if DECODE_MILESTAG2
+  // Try decodeMilestag2() before decodeSony() because the protocols are
+  // similar in timings & structure, but the Miles one differs in nbits
+  // so this one should be tried first to try to reduce false detection
+  {MILESTAG2, 0, 2400, 600, 2 * kMilesTag2ShotBits},
+#endif  // DECODE_MILESTAG2
+#if DECODE_SONY
+  {SONY, 25, 2400, 0, 0},
+#endif  // DECODE_SONY
+#if DECODE_MITSUBISHI
+  {MITSUBISHI, 0, 0, 0, 0},
+#endif  // DECODE_MITSUBISHI
+#if DECODE_MITSUBISHI_AC
+  {MITSUBISHI_AC, 0, 3400, 1750, 2 * kMitsubishiACBits},
+#endif  // DECODE_MITSUBISHI_AC
+#if DECODE_MITSUBISHI2
+  {MITSUBISHI2, 0, 8400, 4200, 2 * kMitsubishiBits},
+#endif  // DECODE_MITSUBISHI2
+#if DECODE_RC5
+  {RC5, 13, 0, 0, 0},
+#endif  // DECODE_RC5
+#if DECODE_RC6
+  {RC6, 9, 2664, 0, 0},
+#endif  // DECODE_RC6
+#if DECODE_RCMM
+  {RCMM, 4, 416, 0, 0},
+#endif  // DECODE_RCMM
+#if DECODE_FUJITSU_AC
+  // Fujitsu A/C needs to precede Panasonic and Denon as it has a short
+  // message which looks exactly the same as a Panasonic/Denon message.
+  {FUJITSU_AC, 0, 3324, 1574, 2 * kFujitsuAcMinBits},
+#endif  // DECODE_FUJITSU_AC
+#if DECODE_DENON
+  // Denon needs to precede Panasonic as it is a special case of Panasonic.
+  {DENON, 0, 0, 0, 0},
+#endif  // DECODE_DENON
+#if DECODE_PANASONIC
+  {PANASONIC, 0, 3456, 1728, 2 * kPanasonic40Bits},
+#endif  // DECODE_PANASONIC
+#if DECODE_LG
+  // LG32 should be tried before Samsung
+  {LG, 0, 0, 0, 0},
+#endif  // DECODE_LG
+#if DECODE_GICABLE
+  // Note: Needs to happen before JVC decode, because it looks similar except
+  //       with a required NEC-like repeat code.
+  {GICABLE, 0, 9000, 4400, 2 * kGicableBits},
+#endif  // DECODE_GICABLE
+#if DECODE_JVC
+  {JVC, 34, 0, 0, 0},
+#endif  // DECODE_JVC
+#if DECODE_SAMSUNG
+  {SAMSUNG, 0, 4480, 4480, 2 * kSamsungBits},
+#endif  // DECODE_SAMSUNG
+#if DECODE_SAMSUNG36
+  {SAMSUNG36, 77, 4515, 4438, 0},
+#endif  // DECODE_SAMSUNG36
+#if DECODE_WHYNTER
+  {WHYNTER, 70, 750, 750, 0},
+#endif  // DECODE_WHYNTER
+#if DECODE_DISH
+  {DISH, 0, 400, 6100, 2 * kDishBits},
+#endif  // DECODE_DISH
+#if DECODE_SHARP
+  {SHARP, 32, 0, 0, 0},
+#endif  // DECODE_SHARP
+#if DECODE_BOSCH144
+  // Bosch is similar to Coolix, so it must be attempted before decodeCOOLIX.
+  {BOSCH144, 0, 4366, 4415, 2 * kBosch144Bits},
+#endif  // DECODE_BOSCH144
+#if DECODE_COOLIX
+  {COOLIX, 99, 4692, 4416, 0},
+#endif  // DECODE_COOLIX
+#if DECODE_NIKAI
+  {NIKAI, 0, 4000, 4000, 2 * kNikaiBits},
+#endif  // DECODE_NIKAI
+#if DECODE_KELVINATOR
+  // Kelvinator based-devices use a similar code to Gree ones, to avoid false
+  // matches this needs to happen before decodeGree().
+  {KELVINATOR, 0, 9010, 4505, 2 * kKelvinatorBits},
+#endif  // DECODE_KELVINATOR
+#if DECODE_DAIKIN
+  {DAIKIN, 0, 0, 0, 0},
+#endif  // DECODE_DAIKIN
+#if DECODE_DAIKIN2
+  {DAIKIN2, 0, 10024, 25180, 2 * kDaikin2Bits},
+#endif  // DECODE_DAIKIN2
+#if DECODE_DAIKIN216
+  {DAIKIN216, 0, 3440, 1750, 2 * kDaikin216Bits},
+#endif  // DECODE_DAIKIN216
+#if DECODE_TOSHIBA_AC
+  {TOSHIBA_AC, 0, 4400, 4300, 2 * kToshibaACBitsShort},
+#endif  // DECODE_TOSHIBA_AC
+#if DECODE_MIDEA
+  {MIDEA, 0, 4480, 4480, 2 * kMideaBits},
+#endif  // DECODE_MIDEA
+#if DECODE_MAGIQUEST
+  {MAGIQUEST, 0, 0, 0, 0},
+#endif  // DECODE_MAGIQUEST
+  /* NOTE: Disabled due to poor quality.
+#if DECODE_SANYO
+  // The Sanyo S866500B decoder is very poor quality & depricated.
+  // *IF* you are going to enable it, do it near last to avoid false positive
+  // matches.
+  // (& add a matching `case SANYO:` to IRrecv::_decodeProtocol().)
+  {SANYO, 0, 3500, 0, 0},
 #endif
+  */
+#if DECODE_NEC
+  // Some devices send NEC-like codes that don't follow the true NEC spec.
+  // This should detect those. e.g. Apple TV remote etc.
+  // This needs to be done after all other codes that use strict and some
+  // other protocols that are NEC-like as well, as turning off strict may
+  // cause this to match other valid protocols.
+  {NEC_LIKE, 3, 8960, 0, 0},
+#endif  // DECODE_NEC
+#if DECODE_LASERTAG
+  {LASERTAG, 14, 0, 0, 0},
+#endif  // DECODE_LASERTAG
+#if DECODE_GREE
+  // Gree based-devices use a similar code to Kelvinator ones, to avoid false
+  // matches this needs to happen after decodeKelvinator().
+  {GREE, 0, 9000, 4500, 2 * kGreeBits},
+#endif  // DECODE_GREE
+#if DECODE_HAIER_AC
+  {HAIER_AC, 0, 3000, 3000, 2 * kHaierACBits},
+#endif  // DECODE_HAIER_AC
+#if DECODE_HAIER_AC_YRW02
+  {HAIER_AC_YRW02, 0, 3000, 3000, 2 * kHaierACYRW02Bits},
+#endif  // DECODE_HAIER_AC_YRW02
+#if DECODE_HAIER_AC176
+  {HAIER_AC176, 0, 3000, 3000, 2 * kHaierAC176Bits},
+#endif  // DECODE_HAIER_AC176
+#if DECODE_HITACHI_AC424
+  // HitachiAc424 should be checked before HitachiAC, HitachiAC2,
+  // & HitachiAC184
+  {HITACHI_AC424, 853, 29784, 49290, 0},
+#endif  // DECODE_HITACHI_AC424
+#if DECODE_MITSUBISHI136
+  // Needs to happen before HitachiAc3 decode.
+  {MITSUBISHI136, 0, 3324, 1474, 2 * kMitsubishi136Bits},
+#endif  // DECODE_MITSUBISHI136
+#if DECODE_HITACHI_AC3
+  // HitachiAc3 should be checked before HitachiAC & HitachiAC2
+  // Attempt normal before the short version.
+  // Order these in decreasing bit size, as it is more optimal.
+  {HITACHI_AC3, 243, 3400, 1660, 0},
+#endif  // DECODE_HITACHI_AC3
+#if DECODE_HITACHI_AC296
+  // HitachiAC296 should be checked before HitachiAC
+  {HITACHI_AC296, 0, 3300, 1700, 2 * kHitachiAc296Bits},
+#endif  // DECODE_HITACHI_AC296
+#if (DECODE_HITACHI_AC || DECODE_HITACHI_AC1 || DECODE_HITACHI_AC2 || \
+     DECODE_HITACHI_AC344 || DECODE_HITACHI_AC264)
+  // Also decodes HitachiAC344, HitachiAC264, HitachiAC2, & HitachiAC1.
+  {HITACHI_AC, 0, 0, 0, 0},
+#endif  // (DECODE_HITACHI_AC || DECODE_HITACHI_AC1 || DECODE_HITACHI_AC2 ||
+        //  DECODE_HITACHI_AC344 || DECODE_HITACHI_AC264)
+#if DECODE_WHIRLPOOL_AC
+  {WHIRLPOOL_AC, 343, 8950, 4484, 0},
+#endif  // DECODE_WHIRLPOOL_AC
+#if DECODE_SAMSUNG_AC
+  // Check the extended size first, as it should fail fast due to longer
+  // length.
+  // Now check for the more common length.
+  {SAMSUNG_AC, 233, 586, 17844, 0},
+#endif  // DECODE_SAMSUNG_AC
+#if DECODE_ELECTRA_AC
+  {ELECTRA_AC, 0, 9166, 4470, 2 * kElectraAcBits},
+#endif  // DECODE_ELECTRA_AC
+#if DECODE_PANASONIC_AC
+  {PANASONIC_AC, 0, 3456, 1728, 2 * kPanasonicAcShortBits},
+#endif  // DECODE_PANASONIC_AC
+#if DECODE_LUTRON
+  {LUTRON, 0, 0, 0, 0},
+#endif  // DECODE_LUTRON
+#if DECODE_MWM
+  {MWM, 7, 0, 0, 0},
+#endif  // DECODE_MWM
+#if DECODE_VESTEL_AC
+  {VESTEL_AC, 0, 3110, 9066, 2 * kVestelAcBits},
+#endif  // DECODE_VESTEL_AC
+#if DECODE_MITSUBISHI112 || DECODE_TCL112AC
+  // Mitsubish112 and Tcl112 share the same decoder.
+  {MITSUBISHI112, 0, 0, 0, 0},
+#endif  // DECODE_MITSUBISHI112 || DECODE_TCL112AC
+#if DECODE_TECO
+  {TECO, 0, 9000, 4440, 2 * kTecoBits},
+#endif  // DECODE_TECO
+#if DECODE_LEGOPF
+  {LEGOPF, 0, 158, 1026, 2 * kLegoPfBits},
+#endif  // DECODE_LEGOPF
+#if DECODE_MITSUBISHIHEAVY
+  {MITSUBISHI_HEAVY_152, 0, 3140, 1630, 2 * kMitsubishiHeavy88Bits},
+#endif  // DECODE_MITSUBISHIHEAVY
+#if DECODE_ARGO
+  {ARGO, 0, 6400, 3300, 2 * 8 * kArgo3iFeelReportStateLength},
+#endif  // DECODE_ARGO
+#if DECODE_SHARP_AC
+  {SHARP_AC, 0, 3800, 1900, 2 * kSharpAcBits},
+#endif  // DECODE_SHARP_AC
+#if DECODE_GOODWEATHER
+  {GOODWEATHER, 0, 6820, 6820, 2 * kGoodweatherBits},
+#endif  // DECODE_GOODWEATHER
+#if DECODE_INAX
+  {INAX, 0, 9000, 4500, 2 * kInaxBits},
+#endif  // DECODE_INAX
+#if DECODE_TROTEC
+  {TROTEC, 150, 5952, 7364, 0},
+#endif  // DECODE_TROTEC
+#if DECODE_TROTEC_3550
+  {TROTEC_3550, 0, 12000, 5130, 2 * kTrotecBits},
+#endif  // DECODE_TROTEC_3550
+#if DECODE_DAIKIN160
+  {DAIKIN160, 0, 5000, 2145, 2 * kDaikin160Bits},
+#endif  // DECODE_DAIKIN160
+#if DECODE_NEOCLIMA
+  {NEOCLIMA, 0, 6112, 7391, 2 * kNeoclimaBits},
+#endif  // DECODE_NEOCLIMA
+#if DECODE_DAIKIN176
+  {DAIKIN176, 0, 5070, 2140, 2 * kDaikin176Bits},
+#endif  // DECODE_DAIKIN176
+#if DECODE_DAIKIN128
+  {DAIKIN128, 0, 9800, 9800, 2 * kDaikin128Bits},
+#endif  // DECODE_DAIKIN128
+#if DECODE_AMCOR
+  {AMCOR, 130, 8200, 4200, 0},
+#endif  // DECODE_AMCOR
+#if DECODE_DAIKIN152
+  {DAIKIN152, 0, 0, 0, 0},
+#endif  // DECODE_DAIKIN152
+#if DECODE_SYMPHONY
+  {SYMPHONY, 23, 0, 0, 0},
+#endif  // DECODE_SYMPHONY
+#if DECODE_DAIKIN64
+  {DAIKIN64, 0, 9800, 9800, 2 * kDaikin64Bits},
+#endif  // DECODE_DAIKIN64
+#if DECODE_AIRWELL
+  {AIRWELL, 0, 0, 0, 0},
+#endif  // DECODE_AIRWELL
+#if DECODE_DELONGHI_AC
+  {DELONGHI_AC, 0, 8984, 4200, 2 * kDelonghiAcBits},
+#endif  // DECODE_DELONGHI_AC
+#if DECODE_DOSHISHA
+  {DOSHISHA, 83, 3412, 1722, 0},
+#endif  // DECODE_DOSHISHA
+#if DECODE_TRUMA
+  // Needs to happen before decodeMultibrackets() as they can appear similar.
+  {TRUMA, 113, 20200, 1000, 0},
+#endif  // DECODE_TRUMA
+#if DECODE_MULTIBRACKETS
+  {MULTIBRACKETS, 0, 0, 0, 0},
+#endif  // DECODE_MULTIBRACKETS
+#if DECODE_CARRIER_AC40
+  {CARRIER_AC40, 83, 8402, 4166, 0},
+#endif  // DECODE_CARRIER_AC40
+#if DECODE_CARRIER_AC64
+  {CARRIER_AC64, 131, 8940, 4556, 0},
+#endif  // DECODE_CARRIER_AC64
+#if DECODE_TECHNIBEL_AC
+  {TECHNIBEL_AC, 0, 8836, 4380, 2 * kTechnibelAcBits},
+#endif  // DECODE_TECHNIBEL_AC
+#if DECODE_CORONA_AC
+  {CORONA_AC, 0, 3500, 1680, 2 * kCoronaAcBits},
+#endif  // DECODE_CORONA_AC
+#if DECODE_MIDEA24
+  {MIDEA24, 0, 8960, 4480, 2 * kMidea24Bits},
+#endif  // DECODE_MIDEA24
+#if DECODE_ZEPEAL
+  {ZEPEAL, 35, 2330, 3380, 0},
+#endif  // DECODE_ZEPEAL
+#if DECODE_SANYO_AC
+  {SANYO_AC, 0, 8500, 4200, 2 * kSanyoAcBits},
+#endif  // DECODE_SANYO_AC
+#if DECODE_VOLTAS
+  {VOLTAS, 0, 0, 0, 0},
+#endif  // DECODE_VOLTAS
+#if DECODE_METZ
+  {METZ, 0, 880, 2336, 2 * kMetzBits},
+#endif  // DECODE_METZ
+#if DECODE_TRANSCOLD
+  {TRANSCOLD, 100, 5944, 7563, 0},
+#endif  // DECODE_TRANSCOLD
+#if DECODE_MIRAGE
+  {MIRAGE, 0, 8360, 4248, 2 * kMirageBits},
+#endif  // DECODE_MIRAGE
+#if DECODE_ELITESCREENS
+  {ELITESCREENS, 0, 0, 0, 0},
+#endif  // DECODE_ELITESCREENS
+#if DECODE_PANASONIC_AC32
+  {PANASONIC_AC32, 0, 3543, 3450, 2 * (kPanasonicAc32Bits / 2)},
+#endif  // DECODE_PANASONIC_AC32
+#if DECODE_ECOCLIM
+  {ECOCLIM, 0, 5730, 1935, 2 * kEcoclimShortBits},
+#endif  // DECODE_ECOCLIM
+#if DECODE_XMP
+  {XMP, 0, 0, 0, 0},
+#endif  // DECODE_XMP
+#if DECODE_TEKNOPOINT
+  {TEKNOPOINT, 0, 3600, 1600, 2 * kTeknopointBits},
+#endif  // DECODE_TEKNOPOINT
+#if DECODE_KELON168
+  {KELON168, 342, 9000, 4600, 0},
+#endif  // DECODE_KELON168
+#if DECODE_KELON
+  {KELON, 0, 9000, 4600, 2 * kKelonBits},
+#endif  // DECODE_KELON
+#if DECODE_SANYO_AC88
+  {SANYO_AC88, 0, 5400, 2000, 2 * kSanyoAc88Bits},
+#endif  // DECODE_SANYO_AC88
+#if DECODE_BOSE
+  {BOSE, 0, 1100, 1350, 2 * kBoseBits},
+#endif  // DECODE_BOSE
+#if DECODE_ARRIS
+  {ARRIS, 0, 2560, 1920, 2 * kArrisBits},
+#endif  // DECODE_ARRIS
+#if DECODE_RHOSS
+  {RHOSS, 196, 3042, 4248, 0},
+#endif  // DECODE_RHOSS
+#if DECODE_AIRTON
+  {AIRTON, 0, 6630, 3350, 2 * kAirtonBits},
+#endif  // DECODE_AIRTON
+#if DECODE_COOLIX48
+  {COOLIX48, 0, 4692, 4416, 2 * kCoolix48Bits},
+#endif  // DECODE_COOLIX48
+#if DECODE_DAIKIN200
+  {DAIKIN200, 0, 4920, 2230, 2 * kDaikin200Bits},
+#endif  // DECODE_DAIKIN200
+#if DECODE_HAIER_AC160
+  {HAIER_AC160, 0, 3000, 3000, 2 * kHaierAC160Bits},
+#endif  // DECODE_HAIER_AC160
+#if DECODE_CARRIER_AC128
+  {CARRIER_AC128, 0, 4600, 2600, 2 * kCarrierAc128Bits},
+#endif  // DECODE_CARRIER_AC128
+#if DECODE_TOTO
+  {TOTO, 0, 6197, 2754, 2 * kTotoShortBits},
+#endif  // DECODE_TOTO
+#if DECODE_CLIMABUTLER
+  {CLIMABUTLER, 0, 511, 3492, 2 * kClimaButlerBits},
+#endif  // DECODE_CLIMABUTLER
+#if DECODE_TCL96AC
+  {TCL96AC, 99, 1056, 550, 0},
+#endif  // DECODE_TCL96AC
+#if DECODE_SANYO_AC152
+  {SANYO_AC152, 0, 3300, 1725, 2 * kSanyoAc152Bits},
+#endif  // DECODE_SANYO_AC152
+#if DECODE_DAIKIN312
+  {DAIKIN312, 0, 0, 0, 0},
+#endif  // DECODE_DAIKIN312
+#if DECODE_GORENJE
+  {GORENJE, 0, 0, 0, 0},
+#endif  // DECODE_GORENJE
+#if DECODE_WOWWEE
+  {WOWWEE, 0, 6684, 723, 2 * kWowweeBits},
+#endif  // DECODE_WOWWEE
+#if DECODE_CARRIER_AC84
+  {CARRIER_AC84, 171, 5850, 1175, 0},
+#endif  // DECODE_CARRIER_AC84
+#if DECODE_YORK
+  {YORK, 0, 4887, 2267, 2 * kYorkBits},
+#endif  // DECODE_YORK
+#if DECODE_BLUESTARHEAVY
+  {BLUESTARHEAVY, 0, 4912, 5058, 2 * kBluestarHeavyBits},
+#endif  // DECODE_BLUESTARHEAVY
+  // Typically new protocols are added above this line, along with a matching
+  // `case` in IRrecv::_decodeProtocol().
+  {UNUSED, 0, 0, 0, 0}  // End of table marker. Must be last.
+};
+
+/// The partial order `kDecoderOrder` must respect. i.e. {first, second} means
+/// the first protocol must always be tried before the second one, as the
+/// second's decoder would also accept (some of) the first's messages.
+/// Only the direct rules are needed. e.g. If A precedes B, & B precedes C,
+/// then A precedes C.
+/// @note The adaptive decode order (`IRrecv::setAdaptiveOrder()`) can move any
+///   protocol anywhere that doesn't break these rules. If you find a pair of
+///   protocols that get confused, add them here.
+/// @note Only use the protocols of `kDecoderOrder` entries. The ones in
+///   `kDecoderAliases` are only ever tried as part of their entry.
+constexpr uint8_t kDecoderPrecedence[][2] = {
+    // Longer or more specific NEC-like protocols.
+    {AIWA_RC_T501, SANYO_LC7461},
+    {AIWA_RC_T501, NEC},
+    {SANYO_LC7461, NEC},
+    {CARRIER_AC, PIONEER},
+    {CARRIER_AC, NEC},
+    {PIONEER, NEC},
+    {EPSON, NEC},
+    // The non-strict NEC decoder accepts almost anything with a NEC header.
+    {NEC, NEC_LIKE},
+    {LG, NEC_LIKE},
+    {MILESTAG2, SONY},
+    {MITSUBISHI, DENON},
+    {FUJITSU_AC, DENON},
+    {DENON, PANASONIC},  // Denon is a special case of Panasonic.
+    {DENON, SHARP},  // & of Sharp.
+    {DENON, MAGIQUEST},
+    {LG, SAMSUNG},
+    {GICABLE, JVC},
+    {BOSCH144, COOLIX},
+    {COOLIX, COOLIX48},
+    {MIDEA, COOLIX48},
+    {KELVINATOR, GREE},
+    {LASERTAG, MWM},
+    {MIDEA24, KELON},
+    {DELONGHI_AC, CARRIER_AC64},
+    // The Hitachi family, from the longest to the shortest.
+    {HITACHI_AC424, HITACHI_AC3},
+    {MITSUBISHI136, HITACHI_AC3},
+    {HITACHI_AC3, HITACHI_AC296},
+    {HITACHI_AC3, HITACHI_AC},  // Also HITACHI_AC344, HITACHI_AC264 etc.
+    {HITACHI_AC296, HITACHI_AC},
+    {TRUMA, MULTIBRACKETS},
+    {UNUSED, UNUSED}  // End of list marker. Must be last.
+};
+
+/// Count the protocols in a table of decoders.
+/// @param[in] entry A PTR to the first entry of the decoder table to count.
+/// @param[in] count The nr. of entries counted so far.
+/// @return The nr. of entries before the end of table marker.
+constexpr uint8_t countDecoders(const decoder_entry_t *entry,
+                                const uint8_t count = 0) {
+  return (entry->protocol == UNUSED) ? count : countDecoders(entry + 1,
+                                                             count + 1);
+}
+
+/// Nr. of (enabled at compile time) protocols in `kDecoderOrder`.
+constexpr uint8_t kDecoderCount = countDecoders(kDecoderOrder);
+static_assert(sizeof(kDecoderOrder) / sizeof(kDecoderOrder[0]) ==
+              kDecoderCount + 1, "kDecoderOrder has too many entries.");
+
+/// Must one protocol always be tried before another?
+/// @param[in] first The protocol that may need to be first.
+/// @param[in] second The protocol that may need to be second.
+/// @return true, if there is a rule for it in `kDecoderPrecedence`.
+bool mustPrecede(const uint8_t first, const uint8_t second) {
+  for (uint8_t i = 0; kDecoderPrecedence[i][0] != UNUSED; i++)
+    if (kDecoderPrecedence[i][0] == first && kDecoderPrecedence[i][1] == second)
+      return true;
+  return false;
+}
+
+/// Must one protocol be tried before another, directly or indirectly?
+/// @param[in] first The protocol that may need to be first.
+/// @param[in] second The protocol that may need to be second.
+/// @return true, if the rules in `kDecoderPrecedence` lead from one to the
+///   other.
+bool precedes(const uint8_t first, const uint8_t second) {
+  for (uint8_t i = 0; kDecoderPrecedence[i][0] != UNUSED; i++)
+    if (kDecoderPrecedence[i][0] == first &&
+        (kDecoderPrecedence[i][1] == second ||
+         precedes(kDecoderPrecedence[i][1], second)))
+      return true;
+  return false;
+}
+
+/// Widest fixed tolerance (in %) any of the decoders use for a header.
+const uint8_t kMaxDecoderTolerance = 40;
+/// Extra tolerance (in %) for the envelope checks, so they are never stricter
+/// than the decoders' own checks. e.g. `_tolerance + kDaikin2Tolerance`.
+const uint8_t kEnvelopeExtraTolerance = 15;
+
+/// Find the fewest entries any of the enabled decoders could ever accept.
+/// @param[in] entry A PTR to the first entry of the decoder table to check.
+/// @param[in] lowest The smallest value found so far.
+/// @return The smallest `min_remaining` value in the table.
+constexpr uint16_t minRemaining(const decoder_entry_t *entry,
+                                const uint16_t lowest = UINT16_MAX) {
+  return (entry->protocol == UNUSED) ? lowest :
+      minRemaining(entry + 1, (entry->min_remaining < lowest) ?
+                              entry->min_remaining : lowest);
+}
+
+/// Fewest entries (after the offset) a capture needs to possibly be decoded by
+/// anything other than decodeHash().
+constexpr uint16_t kDecoderMinRemaining = minRemaining(kDecoderOrder);
+
+/// Protocols that a kDecoderOrder entry can decode, besides its own.
+/// i.e. {the entry's protocol, the other protocol}
+constexpr uint8_t kDecoderAliases[][2] = {
+#if DECODE_MITSUBISHI112 || DECODE_TCL112AC
+    {MITSUBISHI112, TCL112AC},
+#endif  // DECODE_MITSUBISHI112 || DECODE_TCL112AC
+#if DECODE_MITSUBISHIHEAVY
+    {MITSUBISHI_HEAVY_152, MITSUBISHI_HEAVY_88},
+#endif  // DECODE_MITSUBISHIHEAVY
+#if DECODE_HITACHI_AC344
+    {HITACHI_AC, HITACHI_AC344},
+#endif  // DECODE_HITACHI_AC344
+#if DECODE_HITACHI_AC264
+    {HITACHI_AC, HITACHI_AC264},
+#endif  // DECODE_HITACHI_AC264
+#if DECODE_HITACHI_AC2
+    {HITACHI_AC, HITACHI_AC2},
+#endif  // DECODE_HITACHI_AC2
+#if DECODE_HITACHI_AC1
+    {HITACHI_AC, HITACHI_AC1},
+#endif  // DECODE_HITACHI_AC1
+    {UNUSED, UNUSED}  // End of list marker. Must be last.
+};
+
+/// Find the kDecoderOrder entry that decodes a protocol.
+/// @param[in] protocol The protocol we want to decode.
+/// @return The protocol of the entry that decodes it.
+decode_type_t decoderFor(const decode_type_t protocol) {
+  for (uint8_t i = 0; kDecoderAliases[i][0] != UNUSED; i++)
+    if (kDecoderAliases[i][1] == protocol)
+      return static_cast<decode_type_t>(kDecoderAliases[i][0]);
+  return protocol;
+}
+
+/// Are two decode results the same message?
+/// @param[in] first Ptr to one of the results.
+/// @param[in] second Ptr to the other.
+/// @return true, if they are. false, if not.
+bool sameResult(const decode_results *first, const decode_results *second) {
+  if (first->decode_type != second->decode_type ||
+      first->bits != second->bits || first->repeat != second->repeat)
+    return false;
+  if (hasACState(first->decode_type)) {
+    for (uint16_t i = 0; i < first->bits / 8; i++)
+      if (first->state[i] != second->state[i]) return false;
+    return true;
+  }
+  return first->value == second->value &&
+      first->address == second->address && first->command == second->command;
+}
+
+/// Fingerprint a capture for the decode cache. Each entry (bar the leading
+/// gap) is rounded to its three most significant bits first, so small timing
+/// differences between captures of the same message don't change it.
+/// @param[in] results Ptr to the capture.
+/// @return The fingerprint of the capture.
+uint32_t fingerprint(const decode_results *results) {
+  uint32_t hash = kFnvBasis32;
+  for (uint16_t i = 1; i < results->rawlen; i++) {
+    uint16_t value = results->rawbuf[i];
+    uint8_t shift = 0;
+    for (; value > 7; value >>= 1) shift++;
+    hash = (hash ^ ((shift << 3) | value)) * kFnvPrime32;
+  }
+  return hash;
+}
+
+/// Clear out any previously (partially) decoded result.
+/// @param[in,out] results Ptr to the results to clear.
+void clearResults(decode_results *results) {
+  results->decode_type = UNKNOWN;
+  results->bits = 0;
+  results->value = 0;
+  results->address = 0;
+  results->command = 0;
+  results->repeat = false;
+}
+
+/// Scale a value by a percentage, rounding down, without any floating point.
+/// @param[in] usecs The value to scale.
+/// @param[in] percent The percentage to scale it by. e.g. 75 is 75%.
+/// @return usecs * percent / 100
+constexpr uint32_t scalePercent(const uint32_t usecs, const uint32_t percent) {
+  // Split the value so the intermediate products can't overflow.
+  return (usecs / 100) * percent + (usecs % 100) * percent / 100;
+}
+
+/// Check if a raw capture value is in a pre-calculated range.
+/// @param[in] measured The recorded period of the signal pulse (in ticks).
+/// @param[in] range The range of matching values.
+/// @return A Boolean. true if it matches, false if it doesn't.
+inline bool inRange(const uint32_t measured, const tick_range_t &range) {
+  return measured >= range.low && measured <= range.high;
+}
+
+/// The nominal value of a pre-calculated range. i.e. Its middle.
+/// @param[in] range The range of matching values.
+/// @return The nominal value (in ticks).
+inline uint32_t midRange(const tick_range_t &range) {
+  return (range.low + range.high) / 2;
+}
+
+/// Are two pre-calculated ranges the same?
+/// @param[in] a The first range.
+/// @param[in] b The second range.
+/// @return true, if they match exactly the same values. false, if not.
+inline bool sameRange(const tick_range_t &a, const tick_range_t &b) {
+  return a.low == b.low && a.high == b.high;
+}
+
+/// Are two sets of pre-calculated bit ranges the same?
+/// @param[in] a The first set of ranges.
+/// @param[in] b The second set of ranges.
+/// @return true, if they classify bits exactly the same way. false, if not.
+inline bool sameRanges(const bit_ranges_t &a, const bit_ranges_t &b) {
+  return sameRange(a.onemark, b.onemark) && sameRange(a.onespace, b.onespace) &&
+         sameRange(a.zeromark, b.zeromark) &&
+         sameRange(a.zerospace, b.zerospace);
+}
+
+/// Check if a measured leading pulse could possibly be a nominal header value.
+/// @param[in] usecs The measured period of the pulse (in usecs).
+/// @param[in] nominal The protocol's nominal header value (in usecs).
+///   0 means anything matches.
+/// @param[in] tolerance A percentage expressed as an integer. e.g. 10 is 10%.
+/// @return A Boolean. true if it could match, false if it can't.
+bool withinEnvelope(const uint32_t usecs, const uint16_t nominal,
+                    const uint8_t tolerance) {
+  if (!nominal) return true;
+  // Allow for the mark excess in either direction, so marks & spaces share it.
+  const uint32_t low = (nominal > kMarkExcess) ?
+      (nominal - kMarkExcess) * (100UL - tolerance) / 100 : 0;
+  const uint32_t high = (nominal + kMarkExcess) * (100UL + tolerance) / 100 + 1;
+  return usecs >= low && usecs <= high;
+}
+
+/// Could a capture starting with this leading mark & space be the protocol?
+/// @param[in] entry The protocol's entry in kDecoderOrder.
+/// @param[in] lead_mark The measured leading mark. (uSeconds)
+/// @param[in] lead_space The measured leading space. (uSeconds)
+/// @param[in] tolerance Percentage error margin to allow.
+/// @return true, if the header is within the protocol's envelope.
+bool fitsHeader(const decoder_entry_t *entry, const uint32_t lead_mark,
+                const uint32_t lead_space, const uint8_t tolerance) {
+  return withinEnvelope(lead_mark, entry->hdrmark, tolerance) &&
+      withinEnvelope(lead_space, entry->hdrspace, tolerance);
+}
+
+/// The tolerance to use for the envelope checks. It is deliberately wider than
+/// any decoder's own checks, so it never rejects something a decoder would
+/// have accepted.
+/// @param[in] tolerance The receiver's percentage error margin.
+/// @return The percentage error margin for `fitsHeader()`.
+uint8_t envelopeTolerance(const uint8_t tolerance) {
+  return std::min(100, std::max(tolerance, kMaxDecoderTolerance) +
+                       kEnvelopeExtraTolerance);
+}
+}  // namespace _IRrecv
+
+/// Set if decode() should adapt the order it tries protocols in to the ones it
+/// actually receives. The most often decoded protocols are moved earlier, but
+/// never before a protocol that needs to be tried first. See
+/// `mustDecodeBefore()`. It doesn't change what is decoded, only how quickly.
+/// @param[in] enable true to adapt the order, false to use the fixed order.
+/// @return true, if it was set. false, if we ran out of memory.
+bool IRrecv::setAdaptiveOrder(const bool enable) {
+  if (enable == (_order != NULL)) return true;  // Nothing to do.
+  if (!enable) {
+    delete[] _order;
+    delete[] _hits;
+    _order = NULL;
+    _hits = NULL;
+    return true;
+  }
+  _hits = new uint16_t[_IRrecv::kDecoderCount];
+  _order = new uint8_t[_IRrecv::kDecoderCount];
+  if (_hits == NULL || _order == NULL) {
+    DPRINTLN("Could not allocate memory for the adaptive decode order.");
+    delete[] _hits;
+    delete[] _order;
+    _hits = NULL;
+    _order = NULL;
+    return false;
+  }
+  resetDecodeOrder();
+  return true;
+}
+
+/// Is decode() adapting the order it tries protocols in?
+/// @return true, if it is. false, if it uses the fixed order.
+bool IRrecv::getAdaptiveOrder(void) { return _order != NULL; }
+
+/// Forget what has been received, & go back to the fixed decode order.
+void IRrecv::resetDecodeOrder(void) {
+  if (_order == NULL) return;
+  for (uint8_t i = 0; i < _IRrecv::kDecoderCount; i++) {
+    _order[i] = i;
+    _hits[i] = 0;
+  }
+}
+
+/// Which protocol decode() tries at a given position in its order.
+/// @param[in] position The position in the order. 0 is the first.
+/// @return The protocol. UNUSED if past the last one.
+/// @note Decoders that handle more than one protocol (e.g. MITSUBISHI112 &
+///   TCL112AC) are only listed once.
+decode_type_t IRrecv::getDecodeOrder(const uint8_t position) {
+  if (position >= _IRrecv::kDecoderCount) return UNUSED;
+  const uint8_t index = (_order != NULL) ? _order[position] : position;
+  return static_cast<decode_type_t>(_IRrecv::kDecoderOrder[index].protocol);
+}
+
+/// Must decode() always try one protocol before another?
+/// @param[in] first The protocol that may need to be tried first.
+/// @param[in] second The protocol that may need to be tried second.
+/// @return true, if first must be directly tried before second.
+bool IRrecv::mustDecodeBefore(const decode_type_t first,
+                              const decode_type_t second) {
+  return _IRrecv::mustPrecede(first, second);
+}
+
+/// Count a successful decode by a decoder, & move it earlier in the adaptive
+/// order if it is now more popular than those before it.
+/// @param[in] index The decoder's index in the fixed decoder table.
+void IRrecv::_noteHit(const uint8_t index) {
+  if (_hits[index] == UINT16_MAX)  // Age everything, rather than overflow.
+    for (uint8_t i = 0; i < _IRrecv::kDecoderCount; i++) _hits[i] /= 2;
+  _hits[index]++;
+  uint8_t pos = 0;
+  while (_order[pos] != index) pos++;
+  // Swapping neighbours can't break any (indirect) rule, only a direct one.
+  while (pos > 0 && _hits[_order[pos - 1]] < _hits[index] &&
+         !_IRrecv::mustPrecede(_IRrecv::kDecoderOrder[_order[pos - 1]].protocol,
+                               _IRrecv::kDecoderOrder[index].protocol)) {
+    _order[pos] = _order[pos - 1];
+    _order[--pos] = index;
+  }
+}
+
+/// Decodes the received IR message.
+/// If the interrupt state is saved, we will immediately resume waiting
+/// for the next IR message to avoid missing messages.
+/// @note There is a trade-off here. Saving the state means less time lost until
+/// we can receiving the next message vs. using more RAM. Choose appropriately.
+/// @note With the class's own save buffer (`save_buffer` in the constructor)
+///   nothing is copied. The interrupts and decode() trade buffers instead.
+///   So the `rawbuf` of an earlier result is the one being captured into
+///   after the next decode(). Copy anything you want to keep from it first.
+///   e.g. Before calling resultToSourceCode() on it.
+/// @param[out] results A PTR to where the decoded IR message will be stored.
+/// @param[out] save A PTR to an irparams_t instance in which to save
+///   the interrupt's memory/state. NULL means don't save it.
+///   Only the captured part of the buffer is copied into it.
+/// @param[in] max_skip Maximum Nr. of pulses at the begining of a capture we
+///   can skip when attempting to find a protocol we can successfully decode.
+///   This parameter can dramatically improve detection of protocols
+///   when there is light IR interference just before an incoming IR
+///   message, however, it comes at a steep performace price.
+///   (Default is 0. No skipping.)
+/// @warning Increasing the `max_skip` value will dramatically (linearly)
+///   increase the cpu time & usage to decode protocols.
+///   e.g. 0 -> 1 will be a 2x increase in cpu usage/time.
+///        0 -> 2 will be a 3x increase etc.
+///   If you are going to do this, consider disabling protocol decoding for
+///   protocols you are not expecting.
+/// @param[in] noise_floor Pulses below this size (in usecs) will be removed or
+///   merged prior to any decoding. This is to try to remove noise/poor
+///   readings & slightly increase the chances of a successful decode but at the
+///   cost of data fidelity & integrity. See setNoiseFilter().
+///   (Defaults to 0 usecs. i.e. Don't filter; which is safe!)
+/// @warning DANGER: **Here Be Dragons!**
+///   If you set the `noise_floor` value too high, it **WILL** break decoding
+///   of some protocols. You have been warned!
+///   **Any** non-zero value has the potential to **cook** the captured raw data
+///   i.e. The raw data is going to lie to you.
+///   It may obscure hardware, circuit, & environment issues thus making it
+///   impossible to support you accurately or confidently.
+///     Values of <= 50 usecs will probably be safe.
+///     51 - 100 usecs **might** be okay.
+///     100 - 150 usecs is "Danger, Will Robinson!".
+///     150 - 200 usecs expect broken protocols.
+///     At 200+ usecs, you **have** protocols you can't decode!!
+/// @return A boolean indicating if an IR message is ready or not.
+bool IRrecv::decode(decode_results *results, irparams_t *save,
+                    uint8_t max_skip, uint16_t noise_floor) {
+  _next_rawbuf = NULL;  // decodeNext() only follows what this decodes.
+  if (_pending) {  // Carry on with the capture we have pinned.
+    if (decodeCapture(results, max_skip, noise_floor)) return true;
+    if (_pending) return false;  // Still not finished.
+    if (_pending_resume) resume();  // Throw away and start over
+    return false;
+  }
+  if (_incremental && !_queue_size && save == NULL &&
+      params_save == NULL)
+    return _decodeIncremental(results, max_skip, noise_floor);
+  if (_queue_size) {  // Take them from the capture queue, in order.
+    if (save == NULL) save = params_save;
+    if (!_dequeueCapture(results, save, save == params_save)) return false;
+    _pending_resume = false;
+    return decodeCapture(results, max_skip, noise_floor);
+  }
+  // Proceed only if an IR message been received.
+#ifndef UNIT_TEST
+  if (params.rcvstate != kStopState) return false;
+#endif
+
+  // Clear the entry we are currently pointing to when we got the timeout.
+  // i.e. Stopped collecting IR data.
+  // It's junk as we never wrote an entry to it and can only confuse decoding.
+  // This is done here rather than logically the best place in read_timeout()
+  // as it saves a few bytes of ICACHE_RAM as that routine is bound to an
+  // interrupt. decode() is not stored in ICACHE_RAM.
+  // Another better option would be to zero the entire irparams.rawbuf[] on
+  // resume() but that is a much more expensive operation compare to this.
+  // However, don't do this if rawbuf is already full as we stomp over the heap.
+  // See: https://github.com/crankyoldgit/IRremoteESP8266/issues/1516
+  if (!params.overflow && !_compact) params.rawbuf[params.rawlen] = 0;
+
+  bool resumed = false;  // Flag indicating if we have resumed.
+
+  // If we were requested to use a save buffer previously, do so.
+  if (save == NULL) save = params_save;
+
+  _timestamp = params.timestamp;
+  if (save == NULL) {
+    // We haven't been asked to copy it so use the existing memory.
+#ifndef UNIT_TEST
+    results->rawbuf = params.rawbuf;
+    results->rawlen = params.rawlen;
+    results->overflow = params.overflow;
+#endif
+  } else {
+    if (_compact) {  // Expand it into the save buffer, rather than copy it.
+      uint16_t *rawbuf = save->rawbuf;
+      copyIrState(&params, save);
+      save->rawbuf = rawbuf;
+      _expandCapture(params.rawbuf, params.rawlen, save);
+    } else if (save == params_save) {  // We own both, so trade, not copy.
+      swapIrParams(&params, save);
+    } else {
+      copyIrParams(&params, save);  // Duplicate the interrupt's memory.
+    }
+    resume();  // It's now safe to rearm. The IR message won't be overridden.
+    resumed = true;
+    // Point the results at the saved copy.
+    results->rawbuf = save->rawbuf;
+    results->rawlen = save->rawlen;
+    results->overflow = save->overflow;
+  }
+
+  if (decodeCapture(results, max_skip, noise_floor)) return true;
+  _pending_resume = !resumed;
+  if (_pending) return false;  // Out of budget. Carry on with it next time.
+  // Throw away and start over
+  if (!resumed)  // Check if we have already resumed.
+    resume();
+  return false;
+}
+
+/// Decodes an IR message that has already been captured.
+/// Unlike decode(), this doesn't touch the receiver's capture state, so it
+/// can be used on any buffer. e.g. One loaded from elsewhere, or on a host.
+/// @param[in,out] results A PTR to the capture to decode, & where the decoded
+///   IR message will be stored. `rawbuf`, `rawlen`, & `overflow` must be set.
+///   `rawbuf[0]` is the gap before the message, & the rest are the mark &
+///   space periods in ticks (kRawTick uSeconds).
+/// @param[in] max_skip Maximum Nr. of pulses at the begining of a capture we
+///   can skip when attempting to find a protocol we can successfully decode.
+///   See decode().
+/// @param[in] noise_floor Pulses below this size (in usecs) will be removed or
+///   merged prior to any decoding. See decode().
+/// @return A boolean indicating if the IR message was decoded or not.
+/// @note If it runs out of budget (see setDecodeBudget()), call it again with
+///   the same capture, untouched, while isDecodePending() is true.
+bool IRrecv::decodeCapture(decode_results *results, const uint8_t max_skip,
+                           const uint16_t noise_floor) {
+#if ENABLE_NOISE_FILTER_OPTION
+  // Only filter it once, not again each time a pending decode carries on.
+  if (!_pending) crudeNoiseFilter(results, noise_floor);
+#else  // ENABLE_NOISE_FILTER_OPTION
+  (void)noise_floor;  // Unused.
+#endif  // ENABLE_NOISE_FILTER_OPTION
+  if (_segment_state != NULL && !_pending) {
+    bool claimed = false;
+    if (_decodeSegments(results, &claimed)) return true;
+    if (claimed) return false;  // Part of a message. Wait for the rest.
+  }
+  _beginCapture(results);
+  if (_decodeCached(results, max_skip)) return _noteMessage(results);
+  if (_decodeKnown(results, max_skip)) {
+    _cacheResult(results);
+    return _noteMessage(results);
+  }
+  if (_pending) return false;  // Out of budget. Carry on next time.
+#if DECODE_HASH
+  // decodeHash returns a hash on any input.
+  // Thus, it needs to be last in the list.
+  // If you add any decodes, add them before this.
+  if ((_decode_as == UNUSED) ? isProtocolEnabled(UNKNOWN)
+                             : _decode_as == UNKNOWN) {
+    if (decodeHash(results)) return _noteMessage(results);
+  }
+#endif  // DECODE_HASH
+  return false;
+}
+
+/// Decodes the received IR message as one particular protocol only.
+/// A fast path for when the caller already knows what to expect. Only the
+/// protocol's own decoder(s) are tried. e.g. All of its bit length variants.
+/// Apart from that, it works exactly like decode(). The protocol doesn't need
+/// to be enabled. See setProtocolEnabled().
+/// @param[out] results A PTR to where the decoded IR message will be stored.
+/// @param[in] protocol The protocol to decode it as. UNKNOWN means only the
+///   hash decoder.
+/// @param[out] save A PTR to an irparams_t instance in which to save
+///   the interrupt's memory/state. NULL means don't save it.
+/// @param[in] max_skip Maximum Nr. of pulses at the begining of a capture we
+///   can skip when attempting to find the protocol.
+/// @param[in] noise_floor Pulses below this size (in usecs) will be removed or
+///   merged prior to any decoding. See decode() before using this!
+/// @return A boolean indicating if an IR message of that protocol was decoded.
+bool IRrecv::decodeAs(decode_results *results, const decode_type_t protocol,
+                      irparams_t *save, const uint8_t max_skip,
+                      const uint16_t noise_floor) {
+  if (protocol == UNUSED) return false;
+  _decode_as = protocol;
+  const bool decoded = decode(results, save, max_skip, noise_floor);
+  _decode_as = UNUSED;
+  return decoded;
+}
+
+/// Decode a message from several captures of it. e.g. From receivers in
+/// different parts of a large room, where any one of them can miss or mangle
+/// part of a long message.
+/// The first capture that a protocol decoder (i.e. not the hash) accepts on
+/// its own is used. If none are, those with the most common length are
+/// merged entry by entry, and the normal decode chain is run once on that.
+/// @param[out] results A PTR to where the decoded IR message will be stored.
+///   It points to the save buffer afterwards.
+/// @param[in] captures The captures of the message. Only `rawbuf`, `rawlen`,
+///   & `overflow` are used. They aren't modified.
+/// @param[in] count Nr. of entries in `captures`. Only the first
+///   kMaxDiversity are used.
+/// @param[in] merge How to merge the captures if none decode on their own.
+/// @param[in] max_skip Maximum Nr. of pulses at the begining of a capture we
+///   can skip when attempting to find a protocol we can successfully decode.
+/// @param[in] noise_floor Pulses below this size (in usecs) will be removed or
+///   merged prior to any decoding. See decode() before using this!
+/// @note The object must have been created with a save buffer, as that is
+///   where the capture that is decoded is put. Captures longer than it are
+///   cut short.
+/// @note It always decodes the whole capture. Any decode budget is ignored.
+/// @return A boolean indicating if an IR message was decoded.
+bool IRrecv::decodeCombined(decode_results *results,
+                            const decode_results captures[],
+                            const uint8_t count,
+                            const diversity_merge_t merge,
+                            const uint8_t max_skip,
+                            const uint16_t noise_floor) {
+  if (params_save == NULL || !count) return false;
+  const uint8_t total = std::min(count, kMaxDiversity);
+  // Note where they are first, in case `results` is one of them.
+  const uint16_t *rawbufs[kMaxDiversity];
+  uint16_t rawlens[kMaxDiversity];
+  bool overflows[kMaxDiversity];
+  for (uint8_t i = 0; i < total; i++) {
+    rawbufs[i] = captures[i].rawbuf;
+    rawlens[i] = captures[i].rawlen;
+    overflows[i] = captures[i].overflow;
+  }
+  const uint16_t bufsize = params.bufsize;
+  uint16_t *buffer = params_save->rawbuf;
+  _pending = false;  // Abandon any decode in progress.
+  const uint32_t budget_usecs = _budget_usecs;
+  const uint16_t budget_decoders = _budget_decoders;
+  _budget_usecs = 0;
+  _budget_decoders = 0;
+  bool decoded = false;
+  results->rawbuf = buffer;
+  // Does one decode on its own? Try each of them in a copy, as the noise
+  // filter changes what it decodes, & the original may be needed for merging.
+  for (uint8_t i = 0; i < total && !decoded; i++) {
+    results->rawlen = std::min(rawlens[i], bufsize);
+    results->overflow = overflows[i] || rawlens[i] > bufsize;
+    for (uint16_t p = 0; p < results->rawlen; p++) buffer[p] = rawbufs[i][p];
+    if (results->rawlen < bufsize) buffer[results->rawlen] = 0;
+#if ENABLE_NOISE_FILTER_OPTION
+    crudeNoiseFilter(results, noise_floor);
+#endif  // ENABLE_NOISE_FILTER_OPTION
+    _beginCapture(results);
+    if (_decodeKnown(results, max_skip)) decoded = _noteMessage(results);
+  }
+  if (!decoded) {
+    // Only captures of the same length line up entry by entry. Use the length
+    // most of them have. The first one's, if there is a tie.
+    uint8_t group[kMaxDiversity];
+    uint8_t size = 0;
+    for (uint8_t i = 0; i < total; i++) {
+      uint8_t same[kMaxDiversity];
+      uint8_t matches = 0;
+      for (uint8_t j = 0; j < total; j++)
+        if (rawlens[j] == rawlens[i]) same[matches++] = j;
+      if (matches > size) {
+        size = matches;
+        for (uint8_t j = 0; j < size; j++) group[j] = same[j];
+      }
+    }
+    results->rawlen = std::min(rawlens[group[0]], bufsize);
+    results->overflow = rawlens[group[0]] > bufsize;
+    for (uint8_t j = 0; j < size; j++) results->overflow |= overflows[group[j]];
+    for (uint16_t p = 0; p < results->rawlen; p++) {
+      uint16_t values[kMaxDiversity];
+      for (uint8_t j = 0; j < size; j++)
+        values[j] = rawbufs[group[j]][p];
+      uint32_t value;
+      if (merge == kDiversityMajority) {
+        // Which value do the most others match? Use the mean of them all.
+        uint8_t best = 0;
+        value = 0;
+        for (uint8_t j = 0; j < size; j++) {
+          uint8_t agree = 0;
+          uint32_t sum = 0;
+          for (uint8_t k = 0; k < size; k++)
+            if (match(values[k], values[j] * kRawTick)) {
+              agree++;
+              sum += values[k];
+            }
+          if (agree > best) {
+            best = agree;
+            value = sum / agree;
+          }
+        }
+        if (!best) value = values[0];  // Nothing matches. Not even itself.
+      } else {  // kDiversityMedian
+        std::sort(values, values + size);
+        value = (size & 1) ? values[size / 2]
+                           : (values[size / 2 - 1] + values[size / 2]) / 2;
+      }
+      buffer[p] = value;
+    }
+    if (results->rawlen < bufsize) buffer[results->rawlen] = 0;
+    decoded = decodeCapture(results, max_skip, noise_floor);
+  }
+  _budget_usecs = budget_usecs;
+  _budget_decoders = budget_decoders;
+  return decoded;
+}
+
+/// Decode the next message received by this & several other receivers.
+/// i.e. Diversity reception. Captures from them that started within `window`
+/// milliSeconds of the earliest one waiting are treated as the same message,
+/// & decoded together with decodeCombined(). Those are then handed back to
+/// their receivers, as a resume() would, whether they decoded or not.
+/// Use it instead of decode() on all of the receivers.
+/// @param[out] results A PTR to where the decoded IR message will be stored.
+///   It points to this object's save buffer afterwards.
+/// @param[in] others The other receivers.
+/// @param[in] count Nr. of entries in `others`. Only the first
+///   kMaxDiversity - 1 are used.
+/// @param[in] window The max. nr. of milliSeconds between the starts of
+///   captures of the same message.
+/// @param[in] merge How to merge the captures if none decode on their own.
+/// @param[in] max_skip Maximum Nr. of pulses at the begining of a capture we
+///   can skip when attempting to find a protocol we can successfully decode.
+/// @param[in] noise_floor Pulses below this size (in usecs) will be removed or
+///   merged prior to any decoding. See decode() before using this!
+/// @note This object must have been created with a save buffer.
+/// @note While a receiver is still capturing something that started within
+///   the window, it waits for it. i.e. It returns false.
+/// @return A boolean indicating if an IR message was decoded.
+bool IRrecv::decodeDiversity(decode_results *results, IRrecv *const others[],
+                             const uint8_t count, const uint8_t window,
+                             const diversity_merge_t merge,
+                             const uint8_t max_skip,
+                             const uint16_t noise_floor) {
+  if (params_save == NULL) return false;
+  IRrecv *receivers[kMaxDiversity];
+  uint8_t total = 0;
+  receivers[total++] = this;
+  for (uint8_t i = 0; i < count && total < kMaxDiversity; i++)
+    if (others[i] != NULL && others[i] != this) receivers[total++] = others[i];
+  // Find the earliest capture that is waiting.
+  decode_results captures[kMaxDiversity];
+  uint32_t starts[kMaxDiversity];
+  bool waiting[kMaxDiversity];
+  bool found = false;
+  uint32_t start = 0;
+  for (uint8_t i = 0; i < total; i++) {
+    waiting[i] = receivers[i]->_peekCapture(&captures[i], &starts[i]);
+    if (waiting[i] &&
+        (!found || static_cast<int32_t>(starts[i] - start) < 0)) {
+      start = starts[i];
+      found = true;
+    }
+  }
+  if (!found) return false;
+  const uint32_t usecs = MS_TO_USEC(window);
+  decode_results usable[kMaxDiversity];
+  IRrecv *used[kMaxDiversity];
+  uint8_t nr_used = 0;
+  for (uint8_t i = 0; i < total; i++) {
+    volatile irparams_t *state = &receivers[i]->params;
+    // Is a capture of the same message still arriving?
+    if ((state->rcvstate == kMarkState || state->rcvstate == kSpaceState) &&
+        (state->timestamp - start <= usecs ||
+         start - state->timestamp <= usecs))
+      return false;  // Wait for it.
+    if (waiting[i] && starts[i] - start <= usecs) {
+      usable[nr_used] = captures[i];
+      used[nr_used++] = receivers[i];
+    }
+  }
+  const bool decoded = decodeCombined(results, usable, nr_used, merge,
+                                      max_skip, noise_floor);
+  _timestamp = start;
+  // We have copied what we need. Hand the captures back to their receivers.
+  for (uint8_t i = 0; i < nr_used; i++) {
+    // The queue slot it was read from is now finished with.
+    if (used[i]->_queue_size) used[i]->_queue_held = true;
+    used[i]->resume();
+  }
+  return decoded;
+}
+
+/// Decode the next message in the capture the last decode() returned.
+/// e.g. When two remotes are pressed at once, or a remote sends two different
+///   messages close together, they end up in the same capture. decode() only
+///   returns the first of them. Call this until it returns false for the rest.
+/// A message ends at the first gap (a space of kMinMessageGap or more) after
+/// which it decodes as the same protocol on its own. Where the next message
+/// doesn't follow straight on, it is found by scanning for the header of an
+/// enabled protocol, rather than by trying every decoder at every offset.
+/// Anything between messages that doesn't decode is skipped, unless nothing
+/// after it does. In which case, the rest is given to the hash decoder.
+/// @param[in,out] results A PTR to where the decoded IR message will be stored.
+///   Its `rawbuf` & `rawlen` are only the part of the capture with the message.
+///   i.e. From the gap before it, to the gap after it.
+/// @param[in] max_skip Maximum Nr. of pulses at the begining of a message we
+///   can skip when attempting to find a protocol we can successfully decode.
+/// @return A boolean indicating if another IR message was decoded.
+/// @note The capture must still be there. i.e. Don't resume() before this,
+///   unless decode() was given a save buffer. It has already been through the
+///   noise filter, if decode() was asked to use it.
+/// @note It isn't limited by the decode budget. See setDecodeBudget().
+bool IRrecv::decodeNext(decode_results *results, const uint8_t max_skip) {
+  if (_next_rawbuf == NULL || _pending) return false;
+  const uint32_t budget_usecs = _budget_usecs;
+  const uint16_t budget_decoders = _budget_decoders;
+  _budget_usecs = 0;
+  _budget_decoders = 0;
+  if (!_next_end) _next_end = _messageEnd(max_skip);
+  uint16_t start = _next_end;
+  bool decoded = false;
+  while (start + kStartOffset < _next_rawlen) {
+    results->rawbuf = _next_rawbuf + start;
+    results->rawlen = _next_rawlen - start;
+    results->overflow = _next_overflow;
+    decoded = _decodeKnown(results, max_skip);
+    if (decoded) break;
+    // Skip to the next header of a protocol we could decode.
+    const uint16_t header = _findHeader(start + max_skip * 2 + 3);
+    if (!header) break;  // There isn't one.
+    start = header - 1;  // i.e. The gap before it.
+  }
+#if DECODE_HASH
+  if (!decoded && isProtocolEnabled(UNKNOWN) &&
+      _next_end + kStartOffset < _next_rawlen) {
+    start = _next_end;
+    results->rawbuf = _next_rawbuf + start;
+    results->rawlen = _next_rawlen - start;
+    results->overflow = _next_overflow;
+    decoded = decodeHash(results);
+  }
+#endif  // DECODE_HASH
+  _budget_usecs = budget_usecs;
+  _budget_decoders = budget_decoders;
+  if (!decoded) {  // There's nothing more in it.
+    _next_rawbuf = NULL;
+    return false;
+  }
+  _next_start = start;
+  _noteMessage(results);
+  _next_end = _messageEnd(max_skip);
+  results->rawlen = _next_end - start;
+  results->overflow = _next_overflow && _next_end >= _next_rawlen;
+  return true;
+}
+
+/// Note the capture a message is about to be decoded from, for decodeNext().
+/// @param[in] results A PTR to the capture.
+void IRrecv::_beginCapture(const decode_results *results) {
+  _next_rawbuf = results->rawbuf;
+  _next_rawlen = results->rawlen;
+  _next_overflow = results->overflow;
+  _next_start = 0;
+  _next_end = 0;
+  _next_type = UNUSED;
+}
+
+/// Note what was decoded from the start of the capture, for decodeNext().
+/// @param[in] results A PTR to the decoded message.
+/// @return true. i.e. A message was decoded.
+bool IRrecv::_noteMessage(const decode_results *results) {
+  _next_type = results->decode_type;
+  _next_bits = results->bits;
+  return true;
+}
+
+/// Find where the message decodeNext() got to ends in its capture.
+/// @param[in] max_skip Maximum Nr. of pulses it was allowed to skip.
+/// @return The index of the first gap after which it decodes as the same
+///   protocol & size on its own, or the capture's length if there isn't one.
+uint16_t IRrecv::_messageEnd(const uint8_t max_skip) {
+  if (_next_type == UNUSED) return _next_start;  // Nothing was decoded.
+  decode_results message;
+  message.rawbuf = _next_rawbuf + _next_start;
+  message.overflow = false;
+  // Don't let this disturb the decode order, or the candidates of the caller.
+  decode_candidate_t *candidates = _candidates;
+  _candidates = NULL;
+  _decode_as = _next_type;
+  uint16_t end = _next_start + 2;
+  for (; end < _next_rawlen; end += 2) {
+    if (_next_rawbuf[end] * kRawTick < kMinMessageGap) continue;
+    message.rawlen = end - _next_start;
+#if DECODE_HASH
+    if (_next_type == UNKNOWN) {
+      if (decodeHash(&message)) break;
+      continue;
+    }
+#endif  // DECODE_HASH
+    if (_decodeKnown(&message, max_skip) && message.bits == _next_bits) break;
+  }
+  _decode_as = UNUSED;
+  _candidates = candidates;
+  return std::min(end, _next_rawlen);
+}
+
+/// Find the next header of an enabled protocol in the capture decodeNext() is
+/// in. i.e. Where a message we could decode may start.
+/// @param[in] from The index to start looking from.
+/// @return The index of the header's mark, or 0 if there isn't one.
+uint16_t IRrecv::_findHeader(const uint16_t from) {
+  const uint8_t tolerance = _IRrecv::envelopeTolerance(_tolerance);
+  for (uint16_t i = from | 1; i + 1 < _next_rawlen; i += 2) {
+    const uint32_t mark = _next_rawbuf[i] * kRawTick;
+    const uint32_t space = _next_rawbuf[i + 1] * kRawTick;
+    for (const _IRrecv::decoder_entry_t *entry = _IRrecv::kDecoderOrder;
+         entry->protocol != UNUSED; entry++)
+      if (entry->hdrmark && _next_rawlen - i >= entry->min_remaining &&
+          _IRrecv::fitsHeader(entry, mark, space, tolerance) &&
+          _decoderEnabled(entry->protocol))
+        return i;
+  }
+  return 0;
+}
+
+/// Get the oldest completed capture waiting to be decoded, & when it started.
+/// It isn't taken from the receiver. Call resume() when finished with it.
+/// @param[out] capture Where to point at the capture.
+/// @param[out] timestamp Where to store when the capture started. (micros())
+/// @return true, if there was a capture waiting, otherwise false.
+bool IRrecv::_peekCapture(decode_results *capture, uint32_t *timestamp) {
+  if (_compact) return false;  // It can't be used without expanding it.
+  if (_queue_size) {
+    _releaseCapture();
+    volatile capture_slot_t *slot = &_queue[_queue_tail];
+    if (!slot->rawlen) return false;
+    capture->rawbuf = slot->rawbuf;
+    capture->rawlen = slot->rawlen;
+    capture->overflow = slot->overflow;
+    *timestamp = slot->timestamp;
+  } else {
+    // In kStopState the interrupts leave `params` alone.
+    if (params.rcvstate != kStopState || !params.rawlen) return false;
+    capture->rawbuf = params.rawbuf;
+    capture->rawlen = params.rawlen;
+    capture->overflow = params.overflow;
+    *timestamp = params.timestamp;
+  }
+  return true;
+}
+
+/// Set if decode() should assemble messages that are sent in sections, from a
+/// separate capture of each section. Long A/C messages are often sent like
+/// that. e.g. DAIKIN312 sends a short leader, then two sections, with gaps of
+/// 25ms+ between them. If the `timeout` given to the constructor is shorter
+/// than the gaps, each section ends up in a capture of its own. The buffers
+/// then only have to be large enough for the largest section, rather than the
+/// whole message. The sections are decoded as they arrive, & decode() only
+/// reports the message once the last one has been.
+/// The captures have to follow each other with the expected gaps between them,
+/// so use a capture queue (see setCaptureQueueSize()), or call decode() &
+/// resume() quickly enough to catch the next section.
+/// @note Only some protocols can be split up. See `kSegmented`. A capture that
+///   has more than one section (or all of them) in it works too.
+/// @note It needs to know when each capture started, so only decode() can
+///   assemble them. Not decodeCapture() on its own, or incremental decoding.
+/// @param[in] enable true to assemble sections, false to not. (Default)
+/// @return true, if it was set. false, if we ran out of memory.
+bool IRrecv::setSegmentedDecode(const bool enable) {
+  _segment_candidates = 0;
+  if (enable == (_segment_state != NULL)) return true;  // Nothing to do.
+  if (!enable) {
+    delete[] _segment_state;
+    _segment_state = NULL;
+    return true;
+  }
+  _segment_state = new uint8_t[kStateSizeMax];
+  if (_segment_state == NULL) {
+    DPRINTLN("Could not allocate memory for segmented decoding.");
+    return false;
+  }
+  return true;
+}
+
+/// Is decode() assembling messages from captures of their sections?
+/// @return true, if it is. false, if not.
+bool IRrecv::getSegmentedDecode(void) { return _segment_state != NULL; }
+
+/// Set how many recent decodes to remember, so a capture like one of them can
+/// skip the decode chain. e.g. While a button is held, or when an A/C remote
+/// resends its state, the same message is decoded again & again.
+/// Captures are looked up by a fingerprint of their entries, each rounded to
+/// its three most significant bits. i.e. Allowing for some timing jitter.
+/// A hit is checked by running only the decoder that produced it, which must
+/// give the same result again. If not, the decode chain is run as normal.
+/// @param[in] size The nr. of decodes to remember. 0 turns it off. (Default)
+/// @return true, if it was set. false, if we ran out of memory.
+/// @note Not used by decodeAs(), or when ranking candidates. It also resets
+///   the hit & miss counts.
+bool IRrecv::setDecodeCache(const uint8_t size) {
+  _cache_hits = 0;
+  _cache_misses = 0;
+  _cache_next = 0;
+  if (size == _cache_size && _cache != NULL) {  // Just empty it.
+    for (uint8_t i = 0; i < _cache_size; i++) _cache[i].rawlen = 0;
+    return true;
+  }
+  delete[] _cache;
+  _cache = NULL;
+  _cache_size = 0;
+  if (!size) return true;
+  _cache = new decode_cache_t[size];
+  if (_cache == NULL) {
+    DPRINTLN("Could not allocate memory for the decode cache.");
+    return false;
+  }
+  _cache_size = size;
+  for (uint8_t i = 0; i < _cache_size; i++) _cache[i].rawlen = 0;
+  return true;
+}
+
+/// Get how many recent decodes are remembered. See setDecodeCache().
+/// @return The nr. of decodes. 0 if it is off.
+uint8_t IRrecv::getDecodeCacheSize(void) { return _cache_size; }
+
+/// Get how many captures were decoded from the cache. See setDecodeCache().
+/// @return The nr. of hits since the cache was set.
+uint32_t IRrecv::getDecodeCacheHits(void) { return _cache_hits; }
+
+/// Get how many captures had to be decoded the long way, because they weren't
+/// in the cache, or failed the check. See setDecodeCache().
+/// @return The nr. of misses since the cache was set.
+uint32_t IRrecv::getDecodeCacheMisses(void) { return _cache_misses; }
+
+/// Decode a capture from the cache, if it is like one we decoded recently.
+/// @param[in,out] results A PTR to the capture, & where the decoded IR message
+///   will be stored.
+/// @param[in] max_skip Maximum Nr. of pulses at the begining of a capture we
+///   can skip when attempting to find a protocol we can successfully decode.
+/// @return true, if it was a hit. false, if it wasn't, or it isn't in use.
+bool IRrecv::_decodeCached(decode_results *results, const uint8_t max_skip) {
+  if (_cache == NULL || _decode_as != UNUSED || _candidates != NULL ||
+      _pending)
+    return false;
+  _cache_fingerprint = _IRrecv::fingerprint(results);
+  for (uint8_t i = 0; i < _cache_size; i++) {
+    const decode_cache_t *entry = &_cache[i];
+    if (entry->rawlen != results->rawlen ||
+        entry->fingerprint != _cache_fingerprint)
+      continue;
+    // Check it, with only the decoder that decoded it last time.
+    _decode_as = entry->result.decode_type;
+    const bool decoded = _decodeKnown(results, max_skip);
+    _decode_as = UNUSED;
+    if (decoded && _IRrecv::sameResult(results, &entry->result)) {
+      _cache_hits++;
+      return true;
+    }
+    break;  // A false hit. There is only ever one entry for a fingerprint.
+  }
+  _cache_misses++;
+  return false;
+}
 
-  // Clear the entry we are currently pointing to when we got the timeout.
-  // i.e. Stopped collecting IR data.
-  // It's junk as we never wrote an entry to it and can only confuse decoding.
-  // This is done here rather than logically the best place in read_timeout()
-  // as it saves a few bytes of ICACHE_RAM as that routine is bound to an
-  // interrupt. decode() is not stored in ICACHE_RAM.
-  // Another better option would be to zero the entire irparams.rawbuf[] on
-  // resume() but that is a much more expensive operation compare to this.
-  // However, don't do this if rawbuf is already full as we stomp over the heap.
-  // See: https://github.com/crankyoldgit/IRremoteESP8266/issues/1516
-  if (!params.overflow) params.rawbuf[params.rawlen] = 0;
+/// Remember what a capture was decoded as, in the cache. See setDecodeCache().
+/// @param[in] results A PTR to the decoded IR message.
+void IRrecv::_cacheResult(const decode_results *results) {
+  if (_cache == NULL || _decode_as != UNUSED || _candidates != NULL) return;
+  uint8_t slot = _cache_next;
+  for (uint8_t i = 0; i < _cache_size; i++)
+    if (_cache[i].rawlen == results->rawlen &&
+        _cache[i].fingerprint == _cache_fingerprint) {
+      slot = i;  // Replace the one it failed the check against.
+      break;
+    }
+  if (slot == _cache_next && ++_cache_next >= _cache_size) _cache_next = 0;
+  _cache[slot].fingerprint = _cache_fingerprint;
+  _cache[slot].rawlen = results->rawlen;
+  _cache[slot].result = *results;
+  _cache[slot].result.rawbuf = NULL;
+}
 
-  bool resumed = false;  // Flag indicating if we have resumed.
+/// Decode the sections of a message sent in several, that are in a capture.
+/// It carries on with the message it was part way through, if the capture
+/// started the right gap after the last one ended. Otherwise, it tries it as
+/// the start of a new message.
+/// @note Some sections look the same in more than one protocol. e.g. The
+///   DAIKIN & DAIKIN312 leaders. Every protocol they could be is kept as a
+///   candidate, until a section with data in it decides which one it is.
+/// @param[in,out] results A PTR to the capture, & where the decoded IR
+///   message will be stored.
+/// @param[out] claimed Set to true if the capture was part of a message, but
+///   not the end of it. i.e. Wait for the rest.
+/// @return true, if the capture completed a message, otherwise false.
+bool IRrecv::_decodeSegments(decode_results *results, bool *claimed) {
+  using _IRrecv::kSegmented;
+  const uint16_t candidates = _segment_candidates;
+  _segment_candidates = 0;  // Unless it carries on.
+  const uint32_t gap = (_timestamp - _segment_end) / kRawTick;
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    const bool carry_on = attempt == 0;
+    if (carry_on && !candidates) continue;
+    if (!carry_on) {  // Start a new message.
+      _segment_next = 0;
+      _segment_pos = 0;
+    }
+    uint16_t found = 0;
+    uint8_t found_next = 0;
+    uint16_t found_pos = 0;
+    for (uint8_t i = 0; kSegmented[i].protocol != UNUSED; i++) {
+      const _IRrecv::segmented_t *message = &kSegmented[i];
+      const decode_type_t protocol =
+          static_cast<decode_type_t>(message->protocol);
+      if (carry_on) {
+        if (!(candidates & (1 << i))) continue;
+        if (!matchSpace(gap, message->section[_segment_next - 1].gap,
+                        message->tolerance, message->excess)) continue;
+      } else if ((_decode_as == UNUSED) ? !isProtocolEnabled(protocol)
+                                        : _decode_as != protocol) {
+        continue;
+      }
+      uint8_t next = _segment_next;
+      uint16_t pos = _segment_pos;
+      if (!_matchSections(results, i, &next, &pos)) continue;
+      if (next >= message->sections) {  // That's the whole message.
+        if (message->valid != NULL && !message->valid(_segment_state, pos))
+          continue;
+        _IRrecv::clearResults(results);
+        for (uint16_t j = 0; j < pos; j++)
+          results->state[j] = _segment_state[j];
+        results->decode_type = protocol;
+        results->bits = message->nbits;
+        return true;
+      }
+      if (pos != _segment_pos) {  // Its data is in _segment_state now.
+        found = 1 << i;
+        found_next = next;
+        found_pos = pos;
+        break;
+      }
+      if (found && next != found_next) continue;  // Out of step.
+      found |= 1 << i;
+      found_next = next;
+      found_pos = pos;
+    }
+    if (found) {  // Wait for the rest of it.
+      uint32_t duration = 0;
+      for (uint16_t i = kStartOffset; i < results->rawlen; i++)
+        duration += results->rawbuf[i] * kRawTick;
+      _segment_candidates = found;
+      _segment_next = found_next;
+      _segment_pos = found_pos;
+      _segment_end = _timestamp + duration;
+      *claimed = true;
+      return false;
+    }
+  }
+  return false;
+}
 
-  // If we were requested to use a save buffer previously, do so.
-  if (save == NULL) save = params_save;
+/// Match all of a capture as the next sections of a message.
+/// @param[in] results A PTR to the capture.
+/// @param[in] index The message's entry in `_IRrecv::kSegmented`.
+/// @param[in,out] next The next section of the message we expect.
+/// @param[in,out] pos Where in `_segment_state` the next data goes.
+/// @return true, if the sections fill the capture exactly, otherwise false.
+bool IRrecv::_matchSections(const decode_results *results,
+                            const uint8_t index, uint8_t *next,
+                            uint16_t *pos) {
+  const _IRrecv::segmented_t *message = &_IRrecv::kSegmented[index];
+  uint16_t offset = kStartOffset;
+  while (offset < results->rawlen) {
+    if (*next >= message->sections) return false;  // Too long.
+    const _IRrecv::section_t *section = &message->section[*next];
+    const uint16_t remaining = results->rawlen - offset;
+    uint16_t used;
+    if (section->stored) {
+      used = matchGeneric(results->rawbuf + offset, _segment_state + *pos,
+                          remaining, section->nbits,
+                          section->hdrmark, section->hdrspace,
+                          message->bitmark, message->onespace,
+                          message->bitmark, message->zerospace,
+                          message->bitmark, section->gap,
+                          section->gap == 0, message->tolerance,
+                          message->excess, false);
+      if (used) *pos += section->nbits / 8;
+    } else {
+      uint64_t data = 0;
+      used = matchGeneric(results->rawbuf + offset, &data, remaining,
+                          section->nbits, section->hdrmark, section->hdrspace,
+                          message->bitmark, message->onespace,
+                          message->bitmark, message->zerospace,
+                          message->bitmark, section->gap,
+                          section->gap == 0, message->tolerance,
+                          message->excess, false);
+      if (data) return false;
+    }
+    if (!used) return false;
+    offset += used;
+    (*next)++;
+  }
+  return true;
+}
 
-  if (save == NULL) {
-    // We haven't been asked to copy it so use the existing memory.
-#ifndef UNIT_TEST
-    results->rawbuf = params.rawbuf;
-    results->rawlen = params.rawlen;
-    results->overflow = params.overflow;
-#endif
+/// Try all the enabled protocol decoders (except the hash) on a capture.
+/// @param[in,out] results A PTR to the capture to decode, & where the decoded
+///   IR message will be stored.
+/// @param[in] max_skip Maximum Nr. of pulses at the begining of a capture we
+///   can skip when attempting to find a protocol we can successfully decode.
+/// @param[in] early The capture is still in progress. i.e. More may follow.
+///   Only succeed if no protocol the capture could still grow into needs more
+///   entries than we have so far.
+/// @return A boolean indicating if a protocol was decoded or not.
+bool IRrecv::_decodeKnown(decode_results *results, const uint8_t max_skip,
+                          const bool early) {
+  // Only a full decode() can run out of budget, & carry on with it later.
+  const bool budgeted = !early && !_incremental && _decode_as == UNUSED &&
+                        (_budget_usecs || _budget_decoders);
+  uint16_t start_offset = kStartOffset;
+  uint8_t start_index = 0;
+  uint8_t best = 0;  // Index of the best candidate's decoder.
+  if (_pending && budgeted) {  // Carry on from where we ran out last time.
+    start_offset = _pending_offset;
+    start_index = _pending_index;
+    best = _pending_best;
   } else {
-    copyIrParams(&params, save);  // Duplicate the interrupt's memory.
-    resume();  // It's now safe to rearm. The IR message won't be overridden.
-    resumed = true;
-    // Point the results at the saved copy.
-    results->rawbuf = save->rawbuf;
-    results->rawlen = save->rawlen;
-    results->overflow = save->overflow;
+    // Reset any previously partially processed results.
+    _IRrecv::clearResults(results);
+    _candidate_count = 0;
+    _bit_run_count = 0;  // Nothing has been classified in this capture yet.
   }
+  _pending = false;
+  if (_decode_as == UNKNOWN) return false;  // Only the hash was asked for.
+  const decode_type_t decode_as = _IRrecv::decoderFor(_decode_as);
 
-  // Reset any previously partially processed results.
-  results->decode_type = UNKNOWN;
-  results->bits = 0;
-  results->value = 0;
-  results->address = 0;
-  results->command = 0;
-  results->repeat = false;
-
-#if ENABLE_NOISE_FILTER_OPTION
-  crudeNoiseFilter(results, noise_floor);
-#endif  // ENABLE_NOISE_FILTER_OPTION
+  // Only protocols that fit the capture's length & leading mark/space are
+  // attempted.
+  const uint8_t envelope_tolerance = _IRrecv::envelopeTolerance(_tolerance);
   // Keep looking for protocols until we've run out of entries to skip or we
   // find a valid protocol message.
-  for (uint16_t offset = kStartOffset;
+  IRtimer took;
+  uint16_t tried = 0;  // Nr. of decoders tried by this call.
+  for (uint16_t offset = start_offset;
        offset <= (max_skip * 2) + kStartOffset;
        offset += 2) {
+    const uint16_t remaining = (results->rawlen > offset) ?
+        results->rawlen - offset : 0;
+    // Too short for any protocol here, & it only gets shorter as we skip.
+    if (remaining < _IRrecv::kDecoderMinRemaining) break;
+    if (decode_as != UNUSED) {  // Only try what we were asked to.
+      if (_tryDecoder(results, decode_as, offset)) return true;
+      continue;
+    }
+    // Measure the leading mark & space once, rather than in every decoder.
+    const uint32_t lead_mark = (remaining > 0) ?
+        results->rawbuf[offset] * kRawTick : 0;
+    const uint32_t lead_space = (remaining > 1) ?
+        results->rawbuf[offset + 1] * kRawTick : 0;
+    if (early) {
+      // A shorter protocol matching now doesn't mean the message is over.
+      for (const _IRrecv::decoder_entry_t *entry = _IRrecv::kDecoderOrder;
+           entry->protocol != UNUSED; entry++)
+        if (remaining < std::max(entry->min_remaining, entry->min_message) &&
+            _IRrecv::fitsHeader(entry, lead_mark, lead_space,
+                                envelope_tolerance) &&
+            _decoderEnabled(entry->protocol))
+          return false;  // It could still become this protocol.
+    }
+    for (uint8_t i = (offset == start_offset) ? start_index : 0;
+         i < _IRrecv::kDecoderCount; i++) {
+      const uint8_t index = (_order != NULL) ? _order[i] : i;
+      const _IRrecv::decoder_entry_t *entry = &_IRrecv::kDecoderOrder[index];
+      if (remaining < entry->min_remaining ||
+          !_IRrecv::fitsHeader(entry, lead_mark, lead_space,
+                               envelope_tolerance) ||
+          !_decoderEnabled(entry->protocol))
+        continue;  // It can't possibly be this protocol, or we don't want it.
+      if (budgeted && tried &&
+          ((_budget_decoders && tried >= _budget_decoders) ||
+           (_budget_usecs && took.elapsed() >= _budget_usecs))) {
+        // Out of budget. Remember where we got to, & carry on from here.
+        _pending = true;
+        _pending_offset = offset;
+        _pending_index = i;
+        _pending_best = best;
+        return false;
+      }
+      tried++;
+      _residual = 0;
+      _residual_count = 0;
+      if (_tryDecoder(results, static_cast<decode_type_t>(entry->protocol),
+                      offset)) {
+        if (_candidates == NULL) {
+          if (_order != NULL) _noteHit(index);
+          return true;
+        }
+        if (_addCandidate(results) == 0) best = index;
+        // Stop if it can't be beaten, or we have used up our budget.
+        if (_candidates[0].score == kMaxCandidateScore ||
+            _candidate_count == _candidates_size) break;
+      }
+    }
+    if (_candidate_count) {  // Use the best of the candidates we found.
+      *results = _candidates[0].result;
+      if (_order != NULL) _noteHit(best);
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Rank a successful decode amongst the candidates found so far.
+/// Candidates with the same score stay in the order they were found, & a
+/// candidate never outranks a protocol that must be tried before it.
+/// @param[in] results Ptr to the decoded result.
+/// @return Where it was ranked. 0 is the best.
+uint8_t IRrecv::_addCandidate(const decode_results *results) {
+  const uint32_t mean = _residual_count ? _residual / _residual_count
+                                        : kMaxCandidateScore;
+  const uint8_t score = kMaxCandidateScore -
+      std::min(mean, static_cast<uint32_t>(kMaxCandidateScore));
+  uint8_t pos = _candidate_count++;
+  for (; pos > 0 && _candidates[pos - 1].score < score; pos--) {
+    if (_IRrecv::precedes(_candidates[pos - 1].result.decode_type,
+                          results->decode_type)) break;
+    _candidates[pos] = _candidates[pos - 1];
+  }
+  _candidates[pos].result = *results;
+  _candidates[pos].score = score;
+  return pos;
+}
+
+/// Is a kDecoderOrder entry able to decode any of the enabled protocols?
+/// @param[in] protocol The protocol of the entry.
+/// @return true, if it should be tried, otherwise false.
+bool IRrecv::_decoderEnabled(const uint8_t protocol) {
+  if (isProtocolEnabled(static_cast<decode_type_t>(protocol))) return true;
+  for (uint8_t i = 0; _IRrecv::kDecoderAliases[i][0] != UNUSED; i++)
+    if (_IRrecv::kDecoderAliases[i][0] == protocol &&
+        isProtocolEnabled(
+            static_cast<decode_type_t>(_IRrecv::kDecoderAliases[i][1])))
+      return true;
+  return false;
+}
+
+/// Run a kDecoderOrder entry's decoder(s) at an offset, & only accept a result
+/// that was asked for. i.e. Is enabled, or is what decodeAs() wants.
+/// @param[in,out] results Ptr to the data to decode & where to store the decode
+///   result.
+/// @param[in] protocol The protocol of the entry to try.
+/// @param[in] offset The starting index to use when attempting to decode.
+/// @return A boolean. True if it can decode it, false if it can't.
+bool IRrecv::_tryDecoder(decode_results *results, const decode_type_t protocol,
+                         const uint16_t offset) {
+  _bit_runs_active = true;  // The capture won't change until we're done.
+#if ENABLE_DECODE_STATS
+  const bool decoded = _decodeProtocolStats(results, protocol, offset);
+#else  // ENABLE_DECODE_STATS
+  const bool decoded = _decodeProtocol(results, protocol, offset);
+#endif  // ENABLE_DECODE_STATS
+  _bit_runs_active = false;
+  if (!decoded) return false;
+  if (_decode_as == UNUSED ? isProtocolEnabled(results->decode_type)
+                           : results->decode_type == _decode_as)
+    return true;
+  _IRrecv::clearResults(results);  // It isn't one we want.
+  return false;
+}
+
+#if ENABLE_DECODE_STATS
+/// Try a protocol's decoder(s) at an offset, & record how it went.
+/// @param[in,out] results Ptr to the data to decode & where to store the decode
+///   result.
+/// @param[in] protocol The protocol to try.
+/// @param[in] offset The starting index to use when attempting to decode.
+/// @return A boolean. True if it can decode it, false if it can't.
+bool IRrecv::_decodeProtocolStats(decode_results *results,
+                                  const decode_type_t protocol,
+                                  const uint16_t offset) {
+  decode_stats_t *stats = &_stats[protocol];
+  _stats_depth = 0;
+  IRtimer took;
+  const bool success = _decodeProtocol(results, protocol, offset);
+  stats->usecs += took.elapsed();
+  stats->attempts++;
+  if (success) {
+    stats->successes++;
+  } else {
+    // Which power of two bucket did it get to before it gave up?
+    uint8_t bucket = 0;
+    for (uint16_t pos = offset + _stats_depth;
+         pos > 1 && bucket < kDecodeStatsBuckets - 1; pos >>= 1) bucket++;
+    if (stats->rejects[bucket] < UINT16_MAX) stats->rejects[bucket]++;
+  }
+  return success;
+}
+#endif  // ENABLE_DECODE_STATS
+
+/// Decode what has been captured so far, without waiting for the timeout.
+/// A message is returned as soon as it ends with a mark that completes a
+/// protocol, and nothing longer could still match. What follows it in the
+/// capture buffer is decoded as the next message(s). Whatever is left when the
+/// timeout fires is decoded as normal, including by the hash decoder.
+/// @param[out] results A PTR to where the decoded IR message will be stored.
+///   It points into the live capture buffer, which is only appended to until
+///   the capture stops & is resumed.
+/// @param[in] max_skip Maximum Nr. of pulses at the begining of a capture we
+///   can skip. Only used once the capture has stopped.
+/// @param[in] noise_floor Pulses below this size (in usecs) will be removed or
+///   merged prior to any decoding. Only used once the capture has stopped.
+/// @return A boolean indicating if an IR message is ready or not.
+bool IRrecv::_decodeIncremental(decode_results *results,
+                                const uint8_t max_skip,
+                                const uint16_t noise_floor) {
+  const uint8_t state = params.rcvstate;
+  // The interrupts only ever append to the buffer until we resume().
+  const uint16_t rawlen = params.rawlen;
+  if (state == kIdleState || rawlen <= _stream_start) {
+    if (state == kStopState) resume();  // Nothing left that we haven't used.
+    return false;
+  }
+  results->rawbuf = params.rawbuf + _stream_start;
+  results->rawlen = rawlen - _stream_start;
+  results->overflow = false;
+  _timestamp = params.timestamp;
+  if (state == kStopState) {  // The capture is complete. Decode the rest.
+    results->overflow = params.overflow;
+    // Clear the junk entry after the capture, if it has one. See decode().
+    if (rawlen < params.bufsize) params.rawbuf[rawlen] = 0;
+    if (results->rawlen > kStartOffset + 1 &&
+        decodeCapture(results, max_skip, noise_floor)) return true;
+    resume();  // Throw away and start over
+    return false;
+  }
+  // Still capturing. Marks are at odd indexes, & only a mark ends a message.
+  if (rawlen % 2 || rawlen == _stream_tried) return false;
+  _stream_tried = rawlen;  // Don't try the same length twice.
+  if (!_decodeKnown(results, 0, true)) return false;
+  _stream_start = rawlen;  // The next message starts from its leading gap.
+  return true;
+}
+
+/// Attempt to decode the captured message as a single protocol.
+/// Protocols with several variants (e.g. bit sizes) try each of them in turn.
+/// @param[in,out] results Ptr to the data to decode & where to store the result
+/// @param[in] protocol The protocol to attempt to decode the message as.
+/// @param[in] offset The starting index to use when attempting to decode the
+///   raw data. Typically/Defaults to kStartOffset.
+/// @return A boolean. True if it can decode it, false if it can't.
+bool IRrecv::_decodeProtocol(decode_results *results,
+                             const decode_type_t protocol,
+                             const uint16_t offset) {
+  switch (protocol) {
 #if DECODE_AIWA_RC_T501
-    DPRINTLN("Attempting Aiwa RC T501 decode");
-    // Try decodeAiwaRCT501() before decodeSanyoLC7461() & decodeNEC()
-    // because the protocols are similar. This protocol is more specific than
-    // those ones, so should go before them.
-    if (decodeAiwaRCT501(results, offset)) return true;
-#endif
+    case AIWA_RC_T501:
+      DPRINTLN("Attempting Aiwa RC T501 decode");
+      if (decodeAiwaRCT501(results, offset)) return true;
+      break;
+#endif  // DECODE_AIWA_RC_T501
 #if DECODE_SANYO
-    DPRINTLN("Attempting Sanyo LC7461 decode");
-    // Try decodeSanyoLC7461() before decodeNEC() because the protocols are
-    // similar in timings & structure, but the Sanyo one is much longer than the
-    // NEC protocol (42 vs 32 bits) so this one should be tried first to try to
-    // reduce false detection as a NEC packet.
-    if (decodeSanyoLC7461(results, offset)) return true;
-#endif
+    case SANYO_LC7461:
+      DPRINTLN("Attempting Sanyo LC7461 decode");
+      if (decodeSanyoLC7461(results, offset)) return true;
+      break;
+#endif  // DECODE_SANYO
 #if DECODE_CARRIER_AC
-    DPRINTLN("Attempting Carrier AC decode");
-    // Try decodeCarrierAC() before decodeNEC() because the protocols are
-    // similar in timings & structure, but the Carrier one is much longer than
-    // the NEC protocol (3x32 bits vs 1x32 bits) so this one should be tried
-    // first to try to reduce false detection as a NEC packet.
-    if (decodeCarrierAC(results, offset)) return true;
-#endif
+    case CARRIER_AC:
+      DPRINTLN("Attempting Carrier AC decode");
+      if (decodeCarrierAC(results, offset)) return true;
+      break;
+#endif  // DECODE_CARRIER_AC
 #if DECODE_PIONEER
-    DPRINTLN("Attempting Pioneer decode");
-    // Try decodePioneer() before decodeNEC() because the protocols are
-    // similar in timings & structure, but the Pioneer one is much longer than
-    // the NEC protocol (2x32 bits vs 1x32 bits) so this one should be tried
-    // first to try to reduce false detection as a NEC packet.
-    if (decodePioneer(results, offset)) return true;
-#endif
+    case PIONEER:
+      DPRINTLN("Attempting Pioneer decode");
+      if (decodePioneer(results, offset)) return true;
+      break;
+#endif  // DECODE_PIONEER
 #if DECODE_EPSON
-  DPRINTLN("Attempting Epson decode");
-  // Try decodeEpson() before decodeNEC() because the protocols are
-  // similar in timings & structure, but the Epson one is much longer than the
-  // NEC protocol (3x32 identical bits vs 1x32 bits) so this one should be tried
-  // first to try to reduce false detection as a NEC packet.
-  if (decodeEpson(results, offset)) return true;
-#endif
+    case EPSON:
+      DPRINTLN("Attempting Epson decode");
+      if (decodeEpson(results, offset)) return true;
+      break;
+#endif  // DECODE_EPSON
 #if DECODE_NEC
-    DPRINTLN("Attempting NEC decode");
-    if (decodeNEC(results, offset)) return true;
-#endif
+    case NEC:
+      DPRINTLN("Attempting NEC decode");
+      if (decodeNEC(results, offset)) return true;
+      break;
+#endif  // DECODE_NEC
 #if DECODE_MILESTAG2
-    DPRINTLN("Attempting MilesTag2 decode");
-  // Try decodeMilestag2() before decodeSony() because the protocols are
-  // similar in timings & structure, but the Miles one differs in nbits
-  // so this one should be tried first to try to reduce false detection
-    if (decodeMilestag2(results, offset, kMilesTag2MsgBits) ||
-        decodeMilestag2(results, offset, kMilesTag2ShotBits)) return true;
-#endif
+    case MILESTAG2:
+      DPRINTLN("Attempting MilesTag2 decode");
+      if (decodeMilestag2(results, offset, kMilesTag2MsgBits) ||
+          decodeMilestag2(results, offset, kMilesTag2ShotBits)) return true;
+      break;
+#endif  // DECODE_MILESTAG2
 #if DECODE_SONY
-    DPRINTLN("Attempting Sony decode");
-    if (decodeSony(results, offset)) return true;
-#endif
+    case SONY:
+      DPRINTLN("Attempting Sony decode");
+      if (decodeSony(results, offset)) return true;
+      break;
+#endif  // DECODE_SONY
 #if DECODE_MITSUBISHI
-    DPRINTLN("Attempting Mitsubishi decode");
-    if (decodeMitsubishi(results, offset)) return true;
-#endif
+    case MITSUBISHI:
+      DPRINTLN("Attempting Mitsubishi decode");
+      if (decodeMitsubishi(results, offset)) return true;
+      break;
+#endif  // DECODE_MITSUBISHI
 #if DECODE_MITSUBISHI_AC
-    DPRINTLN("Attempting Mitsubishi AC decode");
-    if (decodeMitsubishiAC(results, offset)) return true;
-#endif
+    case MITSUBISHI_AC:
+      DPRINTLN("Attempting Mitsubishi AC decode");
+      if (decodeMitsubishiAC(results, offset)) return true;
+      break;
+#endif  // DECODE_MITSUBISHI_AC
 #if DECODE_MITSUBISHI2
-    DPRINTLN("Attempting Mitsubishi2 decode");
-    if (decodeMitsubishi2(results, offset)) return true;
-#endif
+    case MITSUBISHI2:
+      DPRINTLN("Attempting Mitsubishi2 decode");
+      if (decodeMitsubishi2(results, offset)) return true;
+      break;
+#endif  // DECODE_MITSUBISHI2
 #if DECODE_RC5
-    DPRINTLN("Attempting RC5 decode");
-    if (decodeRC5(results, offset)) return true;
-#endif
+    case RC5:
+      DPRINTLN("Attempting RC5 decode");
+      if (decodeRC5(results, offset)) return true;
+      break;
+#endif  // DECODE_RC5
 #if DECODE_RC6
-    DPRINTLN("Attempting RC6 decode");
-    if (decodeRC6(results, offset)) return true;
-#endif
+    case RC6:
+      DPRINTLN("Attempting RC6 decode");
+      if (decodeRC6(results, offset)) return true;
+      break;
+#endif  // DECODE_RC6
 #if DECODE_RCMM
-    DPRINTLN("Attempting RC-MM decode");
-    if (decodeRCMM(results, offset)) return true;
-#endif
+    case RCMM:
+      DPRINTLN("Attempting RC-MM decode");
+      if (decodeRCMM(results, offset)) return true;
+      break;
+#endif  // DECODE_RCMM
 #if DECODE_FUJITSU_AC
-    // Fujitsu A/C needs to precede Panasonic and Denon as it has a short
-    // message which looks exactly the same as a Panasonic/Denon message.
-    DPRINTLN("Attempting Fujitsu A/C decode");
-    if (decodeFujitsuAC(results, offset)) return true;
-#endif
+    case FUJITSU_AC:
+      DPRINTLN("Attempting Fujitsu A/C decode");
+      if (decodeFujitsuAC(results, offset)) return true;
+      break;
+#endif  // DECODE_FUJITSU_AC
 #if DECODE_DENON
-    // Denon needs to precede Panasonic as it is a special case of Panasonic.
-    DPRINTLN("Attempting Denon decode");
-    if (decodeDenon(results, offset, kDenon48Bits) ||
-        decodeDenon(results, offset, kDenonBits) ||
-        decodeDenon(results, offset, kDenonLegacyBits))
-      return true;
-#endif
+    case DENON:
+      DPRINTLN("Attempting Denon decode");
+      if (decodeDenon(results, offset, kDenon48Bits) ||
+          decodeDenon(results, offset, kDenonBits) ||
+          decodeDenon(results, offset, kDenonLegacyBits))
+        return true;
+      break;
+#endif  // DECODE_DENON
 #if DECODE_PANASONIC
-    DPRINTLN("Attempting Panasonic (48-bit) decode");
-    if (decodePanasonic(results, offset)) return true;
-    DPRINTLN("Attempting Panasonic (40-bit) decode");
-    if (decodePanasonic(results, offset, kPanasonic40Bits, true,
-                        kPanasonic40Manufacturer)) return true;
+    case PANASONIC:
+      DPRINTLN("Attempting Panasonic (48 & 40-bit) decode");
+      if (decodePanasonic(results, offset, 0)) return true;
+      break;
 #endif  // DECODE_PANASONIC
 #if DECODE_LG
-    DPRINTLN("Attempting LG (28-bit) decode");
-    if (decodeLG(results, offset, kLgBits, true)) return true;
-    DPRINTLN("Attempting LG (32-bit) decode");
-    // LG32 should be tried before Samsung
-    if (decodeLG(results, offset, kLg32Bits, true)) return true;
-#endif
+    case LG:
+      DPRINTLN("Attempting LG (28 & 32-bit) decode");
+      if (decodeLG(results, offset, 0, true)) return true;
+      break;
+#endif  // DECODE_LG
 #if DECODE_GICABLE
-    // Note: Needs to happen before JVC decode, because it looks similar except
-    //       with a required NEC-like repeat code.
-    DPRINTLN("Attempting GICable decode");
-    if (decodeGICable(results, offset)) return true;
-#endif
+    case GICABLE:
+      DPRINTLN("Attempting GICable decode");
+      if (decodeGICable(results, offset)) return true;
+      break;
+#endif  // DECODE_GICABLE
 #if DECODE_JVC
-    DPRINTLN("Attempting JVC decode");
-    if (decodeJVC(results, offset)) return true;
-#endif
+    case JVC:
+      DPRINTLN("Attempting JVC decode");
+      if (decodeJVC(results, offset)) return true;
+      break;
+#endif  // DECODE_JVC
 #if DECODE_SAMSUNG
-    DPRINTLN("Attempting SAMSUNG decode");
-    if (decodeSAMSUNG(results, offset)) return true;
-#endif
+    case SAMSUNG:
+      DPRINTLN("Attempting SAMSUNG decode");
+      if (decodeSAMSUNG(results, offset)) return true;
+      break;
+#endif  // DECODE_SAMSUNG
 #if DECODE_SAMSUNG36
-    DPRINTLN("Attempting Samsung36 decode");
-    if (decodeSamsung36(results, offset)) return true;
-#endif
+    case SAMSUNG36:
+      DPRINTLN("Attempting Samsung36 decode");
+      if (decodeSamsung36(results, offset)) return true;
+      break;
+#endif  // DECODE_SAMSUNG36
 #if DECODE_WHYNTER
-    DPRINTLN("Attempting Whynter decode");
-    if (decodeWhynter(results, offset)) return true;
-#endif
+    case WHYNTER:
+      DPRINTLN("Attempting Whynter decode");
+      if (decodeWhynter(results, offset)) return true;
+      break;
+#endif  // DECODE_WHYNTER
 #if DECODE_DISH
-    DPRINTLN("Attempting DISH decode");
-    if (decodeDISH(results, offset)) return true;
-#endif
+    case DISH:
+      DPRINTLN("Attempting DISH decode");
+      if (decodeDISH(results, offset)) return true;
+      break;
+#endif  // DECODE_DISH
 #if DECODE_SHARP
-    DPRINTLN("Attempting Sharp decode");
-    if (decodeSharp(results, offset)) return true;
-#endif
+    case SHARP:
+      DPRINTLN("Attempting Sharp decode");
+      if (decodeSharp(results, offset)) return true;
+      break;
+#endif  // DECODE_SHARP
 #if DECODE_BOSCH144
-    DPRINTLN("Attempting Bosch 144-bit decode");
-    // Bosch is similar to Coolix, so it must be attempted before decodeCOOLIX.
-    if (decodeBosch144(results, offset)) return true;
+    case BOSCH144:
+      DPRINTLN("Attempting Bosch 144-bit decode");
+      if (decodeBosch144(results, offset)) return true;
+      break;
 #endif  // DECODE_BOSCH144
 #if DECODE_COOLIX
-    DPRINTLN("Attempting Coolix 24-bit decode");
-    if (decodeCOOLIX(results, offset)) return true;
+    case COOLIX:
+      DPRINTLN("Attempting Coolix 24-bit decode");
+      if (decodeCOOLIX(results, offset)) return true;
+      break;
 #endif  // DECODE_COOLIX
 #if DECODE_NIKAI
-    DPRINTLN("Attempting Nikai decode");
-    if (decodeNikai(results, offset)) return true;
-#endif
+    case NIKAI:
+      DPRINTLN("Attempting Nikai decode");
+      if (decodeNikai(results, offset)) return true;
+      break;
+#endif  // DECODE_NIKAI
 #if DECODE_KELVINATOR
-    // Kelvinator based-devices use a similar code to Gree ones, to avoid false
-    // matches this needs to happen before decodeGree().
-    DPRINTLN("Attempting Kelvinator decode");
-    if (decodeKelvinator(results, offset)) return true;
-#endif
+    case KELVINATOR:
+      DPRINTLN("Attempting Kelvinator decode");
+      if (decodeKelvinator(results, offset)) return true;
+      break;
+#endif  // DECODE_KELVINATOR
 #if DECODE_DAIKIN
-    DPRINTLN("Attempting Daikin decode");
-    if (decodeDaikin(results, offset)) return true;
-#endif
+    case DAIKIN:
+      DPRINTLN("Attempting Daikin decode");
+      if (decodeDaikin(results, offset)) return true;
+      break;
+#endif  // DECODE_DAIKIN
 #if DECODE_DAIKIN2
-    DPRINTLN("Attempting Daikin2 decode");
-    if (decodeDaikin2(results, offset)) return true;
-#endif
+    case DAIKIN2:
+      DPRINTLN("Attempting Daikin2 decode");
+      if (decodeDaikin2(results, offset)) return true;
+      break;
+#endif  // DECODE_DAIKIN2
 #if DECODE_DAIKIN216
-    DPRINTLN("Attempting Daikin216 decode");
-    if (decodeDaikin216(results, offset)) return true;
-#endif
+    case DAIKIN216:
+      DPRINTLN("Attempting Daikin216 decode");
+      if (decodeDaikin216(results, offset)) return true;
+      break;
+#endif  // DECODE_DAIKIN216
 #if DECODE_TOSHIBA_AC
-    DPRINTLN("Attempting Toshiba AC 72bit decode");
-    if (decodeToshibaAC(results, offset)) return true;
-    DPRINTLN("Attempting Toshiba AC 80bit decode");
-    if (decodeToshibaAC(results, offset, kToshibaACBitsLong)) return true;
-    DPRINTLN("Attempting Toshiba AC 56bit decode");
-    if (decodeToshibaAC(results, offset, kToshibaACBitsShort)) return true;
-#endif
+    case TOSHIBA_AC:
+      DPRINTLN("Attempting Toshiba AC 72bit decode");
+      if (decodeToshibaAC(results, offset)) return true;
+      DPRINTLN("Attempting Toshiba AC 80bit decode");
+      if (decodeToshibaAC(results, offset, kToshibaACBitsLong)) return true;
+      DPRINTLN("Attempting Toshiba AC 56bit decode");
+      if (decodeToshibaAC(results, offset, kToshibaACBitsShort)) return true;
+      break;
+#endif  // DECODE_TOSHIBA_AC
 #if DECODE_MIDEA
-    DPRINTLN("Attempting Midea decode");
-    if (decodeMidea(results, offset)) return true;
-#endif
+    case MIDEA:
+      DPRINTLN("Attempting Midea decode");
+      if (decodeMidea(results, offset)) return true;
+      break;
+#endif  // DECODE_MIDEA
 #if DECODE_MAGIQUEST
-    DPRINTLN("Attempting Magiquest decode");
-    if (decodeMagiQuest(results, offset)) return true;
-#endif
-  /* NOTE: Disabled due to poor quality.
-#if DECODE_SANYO
-    // The Sanyo S866500B decoder is very poor quality & depricated.
-    // *IF* you are going to enable it, do it near last to avoid false positive
-    // matches.
-    DPRINTLN("Attempting Sanyo SA8650B decode");
-    if (decodeSanyo(results, offset))
-      return true;
-#endif
-  */
+    case MAGIQUEST:
+      DPRINTLN("Attempting Magiquest decode");
+      if (decodeMagiQuest(results, offset)) return true;
+      break;
+#endif  // DECODE_MAGIQUEST
 #if DECODE_NEC
-    // Some devices send NEC-like codes that don't follow the true NEC spec.
-    // This should detect those. e.g. Apple TV remote etc.
-    // This needs to be done after all other codes that use strict and some
-    // other protocols that are NEC-like as well, as turning off strict may
-    // cause this to match other valid protocols.
-    DPRINTLN("Attempting NEC (non-strict) decode");
-    if (decodeNEC(results, offset, kNECBits, false)) {
-      results->decode_type = NEC_LIKE;
-      return true;
-    }
-#endif
+    case NEC_LIKE:
+      DPRINTLN("Attempting NEC (non-strict) decode");
+      if (decodeNEC(results, offset, kNECBits, false)) {
+        results->decode_type = NEC_LIKE;
+        return true;
+      }
+      break;
+#endif  // DECODE_NEC
 #if DECODE_LASERTAG
-    DPRINTLN("Attempting Lasertag decode");
-    if (decodeLasertag(results, offset)) return true;
-#endif
+    case LASERTAG:
+      DPRINTLN("Attempting Lasertag decode");
+      if (decodeLasertag(results, offset)) return true;
+      break;
+#endif  // DECODE_LASERTAG
 #if DECODE_GREE
-    // Gree based-devices use a similar code to Kelvinator ones, to avoid false
-    // matches this needs to happen after decodeKelvinator().
-    DPRINTLN("Attempting Gree decode");
-    if (decodeGree(results, offset)) return true;
-#endif
+    case GREE:
+      DPRINTLN("Attempting Gree decode");
+      if (decodeGree(results, offset)) return true;
+      break;
+#endif  // DECODE_GREE
 #if DECODE_HAIER_AC
-    DPRINTLN("Attempting Haier AC decode");
-    if (decodeHaierAC(results, offset)) return true;
-#endif
+    case HAIER_AC:
+      DPRINTLN("Attempting Haier AC decode");
+      if (decodeHaierAC(results, offset)) return true;
+      break;
+#endif  // DECODE_HAIER_AC
 #if DECODE_HAIER_AC_YRW02
-    DPRINTLN("Attempting Haier AC YR-W02 decode");
-    if (decodeHaierACYRW02(results, offset)) return true;
-#endif
+    case HAIER_AC_YRW02:
+      DPRINTLN("Attempting Haier AC YR-W02 decode");
+      if (decodeHaierACYRW02(results, offset)) return true;
+      break;
+#endif  // DECODE_HAIER_AC_YRW02
 #if DECODE_HAIER_AC176
-    DPRINTLN("Attempting Haier AC 176 bit decode");
-    if (decodeHaierAC176(results, offset)) return true;
+    case HAIER_AC176:
+      DPRINTLN("Attempting Haier AC 176 bit decode");
+      if (decodeHaierAC176(results, offset)) return true;
+      break;
 #endif  // DECODE_HAIER_AC176
 #if DECODE_HITACHI_AC424
-    // HitachiAc424 should be checked before HitachiAC, HitachiAC2,
-    // & HitachiAC184
-    DPRINTLN("Attempting Hitachi AC 424 decode");
-    if (decodeHitachiAc424(results, offset, kHitachiAc424Bits)) return true;
+    case HITACHI_AC424:
+      DPRINTLN("Attempting Hitachi AC 424 decode");
+      if (decodeHitachiAc424(results, offset, kHitachiAc424Bits)) return true;
+      break;
 #endif  // DECODE_HITACHI_AC424
 #if DECODE_MITSUBISHI136
-    // Needs to happen before HitachiAc3 decode.
-    DPRINTLN("Attempting Mitsubishi136 decode");
-    if (decodeMitsubishi136(results, offset)) return true;
+    case MITSUBISHI136:
+      DPRINTLN("Attempting Mitsubishi136 decode");
+      if (decodeMitsubishi136(results, offset)) return true;
+      break;
 #endif  // DECODE_MITSUBISHI136
 #if DECODE_HITACHI_AC3
-    // HitachiAc3 should be checked before HitachiAC & HitachiAC2
-    // Attempt normal before the short version.
-    DPRINTLN("Attempting Hitachi AC3 decode");
-    // Order these in decreasing bit size, as it is more optimal.
-    if (decodeHitachiAc3(results, offset, kHitachiAc3Bits) ||
-        decodeHitachiAc3(results, offset, kHitachiAc3Bits - 4 * 8) ||
-        decodeHitachiAc3(results, offset, kHitachiAc3Bits - 6 * 8) ||
-        decodeHitachiAc3(results, offset, kHitachiAc3MinBits + 2 * 8) ||
-        decodeHitachiAc3(results, offset, kHitachiAc3MinBits))
-      return true;
+    case HITACHI_AC3:
+      DPRINTLN("Attempting Hitachi AC3 decode");
+      if (decodeHitachiAc3(results, offset, kHitachiAc3Bits) ||
+          decodeHitachiAc3(results, offset, kHitachiAc3Bits - 4 * 8) ||
+          decodeHitachiAc3(results, offset, kHitachiAc3Bits - 6 * 8) ||
+          decodeHitachiAc3(results, offset, kHitachiAc3MinBits + 2 * 8) ||
+          decodeHitachiAc3(results, offset, kHitachiAc3MinBits))
+        return true;
+      break;
 #endif  // DECODE_HITACHI_AC3
-#if DECODE_HITACHI_AC344
-    // HitachiAC344 should be checked before HitachiAC
-    DPRINTLN("Attempting Hitachi AC344 decode");
-    if (decodeHitachiAC(results, offset, kHitachiAc344Bits, true, false))
-      return true;
-#endif  // DECODE_HITACHI_AC344
-#if DECODE_HITACHI_AC264
-    // HitachiAC264 should be checked before HitachiAC
-    DPRINTLN("Attempting Hitachi AC264 decode");
-    if (decodeHitachiAC(results, offset, kHitachiAc264Bits, true, false))
-      return true;
-#endif  // DECODE_HITACHI_AC264
 #if DECODE_HITACHI_AC296
-    // HitachiAC296 should be checked before HitachiAC
-    DPRINTLN("Attempting Hitachi AC296 decode");
-    if (decodeHitachiAc296(results, offset, kHitachiAc296Bits, true))
-      return true;
+    case HITACHI_AC296:
+      DPRINTLN("Attempting Hitachi AC296 decode");
+      if (decodeHitachiAc296(results, offset, kHitachiAc296Bits, true))
+        return true;
+      break;
 #endif  // DECODE_HITACHI_AC296
-#if DECODE_HITACHI_AC2
-    // HitachiAC2 should be checked before HitachiAC
-    DPRINTLN("Attempting Hitachi AC2 decode");
-    if (decodeHitachiAC(results, offset, kHitachiAc2Bits)) return true;
-#endif  // DECODE_HITACHI_AC2
-#if DECODE_HITACHI_AC
-    DPRINTLN("Attempting Hitachi AC decode");
-    if (decodeHitachiAC(results, offset, kHitachiAcBits)) return true;
-#endif
-#if DECODE_HITACHI_AC1
-    DPRINTLN("Attempting Hitachi AC1 decode");
-    if (decodeHitachiAC(results, offset, kHitachiAc1Bits)) return true;
-#endif
+#if (DECODE_HITACHI_AC || DECODE_HITACHI_AC1 || DECODE_HITACHI_AC2 || \
+     DECODE_HITACHI_AC344 || DECODE_HITACHI_AC264)
+    case HITACHI_AC:
+      // One pass for HitachiAC344, HitachiAC264, HitachiAC2, HitachiAC, &
+      // HitachiAC1. Only the sizes the capture has room for are matched.
+      DPRINTLN("Attempting Hitachi AC (any size) decode");
+      if (decodeHitachiAC(results, offset, 0)) return true;
+      break;
+#endif  // (DECODE_HITACHI_AC || DECODE_HITACHI_AC1 || DECODE_HITACHI_AC2 ||
+        //  DECODE_HITACHI_AC344 || DECODE_HITACHI_AC264)
 #if DECODE_WHIRLPOOL_AC
-    DPRINTLN("Attempting Whirlpool AC decode");
-    if (decodeWhirlpoolAC(results, offset)) return true;
-#endif
+    case WHIRLPOOL_AC:
+      DPRINTLN("Attempting Whirlpool AC decode");
+      if (decodeWhirlpoolAC(results, offset)) return true;
+      break;
+#endif  // DECODE_WHIRLPOOL_AC
 #if DECODE_SAMSUNG_AC
-    DPRINTLN("Attempting Samsung AC (extended) decode");
-    // Check the extended size first, as it should fail fast due to longer
-    // length.
-    if (decodeSamsungAC(results, offset, kSamsungAcExtendedBits)) return true;
-    // Now check for the more common length.
-    DPRINTLN("Attempting Samsung AC decode");
-    if (decodeSamsungAC(results, offset, kSamsungAcBits)) return true;
-#endif
+    case SAMSUNG_AC:
+      DPRINTLN("Attempting Samsung AC (extended & normal) decode");
+      if (decodeSamsungAC(results, offset, 0)) return true;
+      break;
+#endif  // DECODE_SAMSUNG_AC
 #if DECODE_ELECTRA_AC
-    DPRINTLN("Attempting Electra AC decode");
-    if (decodeElectraAC(results, offset)) return true;
-#endif
+    case ELECTRA_AC:
+      DPRINTLN("Attempting Electra AC decode");
+      if (decodeElectraAC(results, offset)) return true;
+      break;
+#endif  // DECODE_ELECTRA_AC
 #if DECODE_PANASONIC_AC
-    DPRINTLN("Attempting Panasonic AC decode");
-    if (decodePanasonicAC(results, offset)) return true;
-    DPRINTLN("Attempting Panasonic AC short decode");
-    if (decodePanasonicAC(results, offset, kPanasonicAcShortBits)) return true;
-#endif
+    case PANASONIC_AC:
+      DPRINTLN("Attempting Panasonic AC decode");
+      if (decodePanasonicAC(results, offset)) return true;
+      DPRINTLN("Attempting Panasonic AC short decode");
+      if (decodePanasonicAC(results, offset, kPanasonicAcShortBits))
+        return true;
+      break;
+#endif  // DECODE_PANASONIC_AC
 #if DECODE_LUTRON
-    DPRINTLN("Attempting Lutron decode");
-    if (decodeLutron(results, offset)) return true;
-#endif
+    case LUTRON:
+      DPRINTLN("Attempting Lutron decode");
+      if (decodeLutron(results, offset)) return true;
+      break;
+#endif  // DECODE_LUTRON
 #if DECODE_MWM
-    DPRINTLN("Attempting MWM decode");
-    if (decodeMWM(results, offset)) return true;
-#endif
+    case MWM:
+      DPRINTLN("Attempting MWM decode");
+      if (decodeMWM(results, offset)) return true;
+      break;
+#endif  // DECODE_MWM
 #if DECODE_VESTEL_AC
-    DPRINTLN("Attempting Vestel AC decode");
-    if (decodeVestelAc(results, offset)) return true;
-#endif
+    case VESTEL_AC:
+      DPRINTLN("Attempting Vestel AC decode");
+      if (decodeVestelAc(results, offset)) return true;
+      break;
+#endif  // DECODE_VESTEL_AC
 #if DECODE_MITSUBISHI112 || DECODE_TCL112AC
-    // Mitsubish112 and Tcl112 share the same decoder.
-    DPRINTLN("Attempting Mitsubishi112/TCL112AC decode");
-    if (decodeMitsubishi112(results, offset)) return true;
+    case MITSUBISHI112:
+      DPRINTLN("Attempting Mitsubishi112/TCL112AC decode");
+      if (decodeMitsubishi112(results, offset)) return true;
+      break;
 #endif  // DECODE_MITSUBISHI112 || DECODE_TCL112AC
 #if DECODE_TECO
-    DPRINTLN("Attempting Teco decode");
-    if (decodeTeco(results, offset)) return true;
-#endif
+    case TECO:
+      DPRINTLN("Attempting Teco decode");
+      if (decodeTeco(results, offset)) return true;
+      break;
+#endif  // DECODE_TECO
 #if DECODE_LEGOPF
-    DPRINTLN("Attempting LEGOPF decode");
-    if (decodeLegoPf(results, offset)) return true;
-#endif
+    case LEGOPF:
+      DPRINTLN("Attempting LEGOPF decode");
+      if (decodeLegoPf(results, offset)) return true;
+      break;
+#endif  // DECODE_LEGOPF
 #if DECODE_MITSUBISHIHEAVY
-    DPRINTLN("Attempting MITSUBISHIHEAVY (152 bit) decode");
-    if (decodeMitsubishiHeavy(results, offset, kMitsubishiHeavy152Bits))
-      return true;
-    DPRINTLN("Attempting MITSUBISHIHEAVY (88 bit) decode");
-    if (decodeMitsubishiHeavy(results, offset, kMitsubishiHeavy88Bits))
-      return true;
-#endif
+    case MITSUBISHI_HEAVY_152:
+      DPRINTLN("Attempting MITSUBISHIHEAVY (152 bit) decode");
+      if (decodeMitsubishiHeavy(results, offset, kMitsubishiHeavy152Bits))
+        return true;
+      DPRINTLN("Attempting MITSUBISHIHEAVY (88 bit) decode");
+      if (decodeMitsubishiHeavy(results, offset, kMitsubishiHeavy88Bits))
+        return true;
+      break;
+#endif  // DECODE_MITSUBISHIHEAVY
 #if DECODE_ARGO
-  DPRINTLN("Attempting Argo WREM3 decode (AC Control)");
-  if (decodeArgoWREM3(results, offset, kArgo3AcControlStateLength * 8, true))
-    return true;
-  DPRINTLN("Attempting Argo WREM3 decode (iFeel report)");
-  if (decodeArgoWREM3(results, offset, kArgo3iFeelReportStateLength * 8, true))
-    return true;
-  DPRINTLN("Attempting Argo WREM3 decode (Config)");
-  if (decodeArgoWREM3(results, offset, kArgo3ConfigStateLength * 8, true))
-    return true;
-  DPRINTLN("Attempting Argo WREM3 decode (Timer)");
-  if (decodeArgoWREM3(results, offset, kArgo3TimerStateLength * 8, true))
-    return true;
-  DPRINTLN("Attempting Argo WREM2 decode");
-    if (decodeArgo(results, offset, kArgoBits) ||
-        decodeArgo(results, offset, kArgoShortBits, false)) return true;
+    case ARGO:
+      DPRINTLN("Attempting Argo WREM3 decode (AC Control)");
+      if (decodeArgoWREM3(results, offset, kArgo3AcControlStateLength * 8,
+                          true))
+        return true;
+      DPRINTLN("Attempting Argo WREM3 decode (iFeel report)");
+      if (decodeArgoWREM3(results, offset, kArgo3iFeelReportStateLength * 8,
+                          true))
+        return true;
+      DPRINTLN("Attempting Argo WREM3 decode (Config)");
+      if (decodeArgoWREM3(results, offset, kArgo3ConfigStateLength * 8, true))
+        return true;
+      DPRINTLN("Attempting Argo WREM3 decode (Timer)");
+      if (decodeArgoWREM3(results, offset, kArgo3TimerStateLength * 8, true))
+        return true;
+      DPRINTLN("Attempting Argo WREM2 decode");
+      if (decodeArgo(results, offset, kArgoBits) ||
+          decodeArgo(results, offset, kArgoShortBits, false)) return true;
+      break;
 #endif  // DECODE_ARGO
 #if DECODE_SHARP_AC
-    DPRINTLN("Attempting SHARP_AC decode");
-    if (decodeSharpAc(results, offset)) return true;
-#endif
+    case SHARP_AC:
+      DPRINTLN("Attempting SHARP_AC decode");
+      if (decodeSharpAc(results, offset)) return true;
+      break;
+#endif  // DECODE_SHARP_AC
 #if DECODE_GOODWEATHER
-    DPRINTLN("Attempting GOODWEATHER decode");
-    if (decodeGoodweather(results, offset)) return true;
+    case GOODWEATHER:
+      DPRINTLN("Attempting GOODWEATHER decode");
+      if (decodeGoodweather(results, offset)) return true;
+      break;
 #endif  // DECODE_GOODWEATHER
 #if DECODE_INAX
-    DPRINTLN("Attempting Inax decode");
-    if (decodeInax(results, offset)) return true;
+    case INAX:
+      DPRINTLN("Attempting Inax decode");
+      if (decodeInax(results, offset)) return true;
+      break;
 #endif  // DECODE_INAX
 #if DECODE_TROTEC
-    DPRINTLN("Attempting Trotec decode");
-    if (decodeTrotec(results, offset)) return true;
+    case TROTEC:
+      DPRINTLN("Attempting Trotec decode");
+      if (decodeTrotec(results, offset)) return true;
+      break;
 #endif  // DECODE_TROTEC
 #if DECODE_TROTEC_3550
-    DPRINTLN("Attempting Trotec 3550 decode");
-    if (decodeTrotec3550(results, offset)) return true;
+    case TROTEC_3550:
+      DPRINTLN("Attempting Trotec 3550 decode");
+      if (decodeTrotec3550(results, offset)) return true;
+      break;
 #endif  // DECODE_TROTEC_3550
 #if DECODE_DAIKIN160
-    DPRINTLN("Attempting Daikin160 decode");
-    if (decodeDaikin160(results, offset)) return true;
+    case DAIKIN160:
+      DPRINTLN("Attempting Daikin160 decode");
+      if (decodeDaikin160(results, offset)) return true;
+      break;
 #endif  // DECODE_DAIKIN160
 #if DECODE_NEOCLIMA
-    DPRINTLN("Attempting Neoclima decode");
-    if (decodeNeoclima(results, offset)) return true;
+    case NEOCLIMA:
+      DPRINTLN("Attempting Neoclima decode");
+      if (decodeNeoclima(results, offset)) return true;
+      break;
 #endif  // DECODE_NEOCLIMA
 #if DECODE_DAIKIN176
-    DPRINTLN("Attempting Daikin176 decode");
-    if (decodeDaikin176(results, offset)) return true;
+    case DAIKIN176:
+      DPRINTLN("Attempting Daikin176 decode");
+      if (decodeDaikin176(results, offset)) return true;
+      break;
 #endif  // DECODE_DAIKIN176
 #if DECODE_DAIKIN128
-    DPRINTLN("Attempting Daikin128 decode");
-    if (decodeDaikin128(results, offset)) return true;
+    case DAIKIN128:
+      DPRINTLN("Attempting Daikin128 decode");
+      if (decodeDaikin128(results, offset)) return true;
+      break;
 #endif  // DECODE_DAIKIN128
 #if DECODE_AMCOR
-    DPRINTLN("Attempting Amcor decode");
-    if (decodeAmcor(results, offset)) return true;
+    case AMCOR:
+      DPRINTLN("Attempting Amcor decode");
+      if (decodeAmcor(results, offset)) return true;
+      break;
 #endif  // DECODE_AMCOR
 #if DECODE_DAIKIN152
-    DPRINTLN("Attempting Daikin152 decode");
-    if (decodeDaikin152(results, offset)) return true;
+    case DAIKIN152:
+      DPRINTLN("Attempting Daikin152 decode");
+      if (decodeDaikin152(results, offset)) return true;
+      break;
 #endif  // DECODE_DAIKIN152
 #if DECODE_SYMPHONY
-    DPRINTLN("Attempting Symphony decode");
-    if (decodeSymphony(results, offset)) return true;
+    case SYMPHONY:
+      DPRINTLN("Attempting Symphony decode");
+      if (decodeSymphony(results, offset)) return true;
+      break;
 #endif  // DECODE_SYMPHONY
 #if DECODE_DAIKIN64
-    DPRINTLN("Attempting Daikin64 decode");
-    if (decodeDaikin64(results, offset)) return true;
+    case DAIKIN64:
+      DPRINTLN("Attempting Daikin64 decode");
+      if (decodeDaikin64(results, offset)) return true;
+      break;
 #endif  // DECODE_DAIKIN64
 #if DECODE_AIRWELL
-    DPRINTLN("Attempting Airwell decode");
-    if (decodeAirwell(results, offset)) return true;
+    case AIRWELL:
+      DPRINTLN("Attempting Airwell decode");
+      if (decodeAirwell(results, offset)) return true;
+      break;
 #endif  // DECODE_AIRWELL
 #if DECODE_DELONGHI_AC
-    DPRINTLN("Attempting Delonghi AC decode");
-    if (decodeDelonghiAc(results, offset)) return true;
+    case DELONGHI_AC:
+      DPRINTLN("Attempting Delonghi AC decode");
+      if (decodeDelonghiAc(results, offset)) return true;
+      break;
 #endif  // DECODE_DELONGHI_AC
 #if DECODE_DOSHISHA
-    DPRINTLN("Attempting Doshisha decode");
-    if (decodeDoshisha(results, offset)) return true;
+    case DOSHISHA:
+      DPRINTLN("Attempting Doshisha decode");
+      if (decodeDoshisha(results, offset)) return true;
+      break;
 #endif  // DECODE_DOSHISHA
 #if DECODE_TRUMA
-    // Needs to happen before decodeMultibrackets() as they can appear similar.
-    DPRINTLN("Attempting Truma decode");
-    if (decodeTruma(results, offset)) return true;
+    case TRUMA:
+      DPRINTLN("Attempting Truma decode");
+      if (decodeTruma(results, offset)) return true;
+      break;
 #endif  // DECODE_TRUMA
 #if DECODE_MULTIBRACKETS
-    DPRINTLN("Attempting Multibrackets decode");
-    if (decodeMultibrackets(results, offset)) return true;
+    case MULTIBRACKETS:
+      DPRINTLN("Attempting Multibrackets decode");
+      if (decodeMultibrackets(results, offset)) return true;
+      break;
 #endif  // DECODE_MULTIBRACKETS
 #if DECODE_CARRIER_AC40
-    DPRINTLN("Attempting Carrier 40bit decode");
-    if (decodeCarrierAC40(results, offset)) return true;
+    case CARRIER_AC40:
+      DPRINTLN("Attempting Carrier 40bit decode");
+      if (decodeCarrierAC40(results, offset)) return true;
+      break;
 #endif  // DECODE_CARRIER_AC40
 #if DECODE_CARRIER_AC64
-    DPRINTLN("Attempting Carrier 64bit decode");
-    if (decodeCarrierAC64(results, offset)) return true;
+    case CARRIER_AC64:
+      DPRINTLN("Attempting Carrier 64bit decode");
+      if (decodeCarrierAC64(results, offset)) return true;
+      break;
 #endif  // DECODE_CARRIER_AC64
 #if DECODE_TECHNIBEL_AC
-    DPRINTLN("Attempting Technibel AC decode");
-    if (decodeTechnibelAc(results, offset)) return true;
+    case TECHNIBEL_AC:
+      DPRINTLN("Attempting Technibel AC decode");
+      if (decodeTechnibelAc(results, offset)) return true;
+      break;
 #endif  // DECODE_TECHNIBEL_AC
 #if DECODE_CORONA_AC
-    DPRINTLN("Attempting CoronaAc decode");
-    if (decodeCoronaAc(results, offset)) return true;
+    case CORONA_AC:
+      DPRINTLN("Attempting CoronaAc decode");
+      if (decodeCoronaAc(results, offset)) return true;
+      break;
 #endif  // DECODE_CORONA_AC
 #if DECODE_MIDEA24
-    DPRINTLN("Attempting Midea-Nec decode");
-    if (decodeMidea24(results, offset)) return true;
+    case MIDEA24:
+      DPRINTLN("Attempting Midea-Nec decode");
+      if (decodeMidea24(results, offset)) return true;
+      break;
 #endif  // DECODE_MIDEA24
 #if DECODE_ZEPEAL
-    DPRINTLN("Attempting Zepeal decode");
-    if (decodeZepeal(results, offset)) return true;
+    case ZEPEAL:
+      DPRINTLN("Attempting Zepeal decode");
+      if (decodeZepeal(results, offset)) return true;
+      break;
 #endif  // DECODE_ZEPEAL
 #if DECODE_SANYO_AC
-    DPRINTLN("Attempting Sanyo AC decode");
-    if (decodeSanyoAc(results, offset)) return true;
+    case SANYO_AC:
+      DPRINTLN("Attempting Sanyo AC decode");
+      if (decodeSanyoAc(results, offset)) return true;
+      break;
 #endif  // DECODE_SANYO_AC
 #if DECODE_VOLTAS
-  DPRINTLN("Attempting Voltas decode");
-  if (decodeVoltas(results)) return true;
+    case VOLTAS:
+      DPRINTLN("Attempting Voltas decode");
+      if (decodeVoltas(results, offset)) return true;
+      break;
 #endif  // DECODE_VOLTAS
 #if DECODE_METZ
-    DPRINTLN("Attempting Metz decode");
-    if (decodeMetz(results, offset)) return true;
+    case METZ:
+      DPRINTLN("Attempting Metz decode");
+      if (decodeMetz(results, offset)) return true;
+      break;
 #endif  // DECODE_METZ
 #if DECODE_TRANSCOLD
-    DPRINTLN("Attempting Transcold decode");
-    if (decodeTranscold(results, offset)) return true;
+    case TRANSCOLD:
+      DPRINTLN("Attempting Transcold decode");
+      if (decodeTranscold(results, offset)) return true;
+      break;
 #endif  // DECODE_TRANSCOLD
 #if DECODE_MIRAGE
-    DPRINTLN("Attempting Mirage decode");
-    if (decodeMirage(results, offset)) return true;
+    case MIRAGE:
+      DPRINTLN("Attempting Mirage decode");
+      if (decodeMirage(results, offset)) return true;
+      break;
 #endif  // DECODE_MIRAGE
 #if DECODE_ELITESCREENS
-    DPRINTLN("Attempting EliteScreens decode");
-    if (decodeElitescreens(results, offset)) return true;
+    case ELITESCREENS:
+      DPRINTLN("Attempting EliteScreens decode");
+      if (decodeElitescreens(results, offset)) return true;
+      break;
 #endif  // DECODE_ELITESCREENS
 #if DECODE_PANASONIC_AC32
-    DPRINTLN("Attempting Panasonic AC (32bit) long decode");
-    if (decodePanasonicAC32(results, offset, kPanasonicAc32Bits)) return true;
-    DPRINTLN("Attempting Panasonic AC (32bit) short decode");
-    if (decodePanasonicAC32(results, offset, kPanasonicAc32Bits / 2))
-      return true;
+    case PANASONIC_AC32:
+      DPRINTLN("Attempting Panasonic AC (32bit) long decode");
+      if (decodePanasonicAC32(results, offset, kPanasonicAc32Bits)) return true;
+      DPRINTLN("Attempting Panasonic AC (32bit) short decode");
+      if (decodePanasonicAC32(results, offset, kPanasonicAc32Bits / 2))
+        return true;
+      break;
 #endif  // DECODE_PANASONIC_AC32
 #if DECODE_ECOCLIM
-    DPRINTLN("Attempting Ecoclim decode");
-    if (decodeEcoclim(results, offset, kEcoclimBits) ||
-        decodeEcoclim(results, offset, kEcoclimShortBits)) return true;
+    case ECOCLIM:
+      DPRINTLN("Attempting Ecoclim decode");
+      if (decodeEcoclim(results, offset, kEcoclimBits) ||
+          decodeEcoclim(results, offset, kEcoclimShortBits)) return true;
+      break;
 #endif  // DECODE_ECOCLIM
 #if DECODE_XMP
-    DPRINTLN("Attempting XMP decode");
-    if (decodeXmp(results, offset, kXmpBits)) return true;
+    case XMP:
+      DPRINTLN("Attempting XMP decode");
+      if (decodeXmp(results, offset, kXmpBits)) return true;
+      break;
 #endif  // DECODE_XMP
 #if DECODE_TEKNOPOINT
-    DPRINTLN("Attempting Teknopoint decode");
-    if (decodeTeknopoint(results, offset)) return true;
+    case TEKNOPOINT:
+      DPRINTLN("Attempting Teknopoint decode");
+      if (decodeTeknopoint(results, offset)) return true;
+      break;
 #endif  // DECODE_TEKNOPOINT
 #if DECODE_KELON168
-    DPRINTLN("Attempting Kelon 168-bit decode");
-    if (decodeKelon168(results, offset)) return true;
+    case KELON168:
+      DPRINTLN("Attempting Kelon 168-bit decode");
+      if (decodeKelon168(results, offset)) return true;
+      break;
 #endif  // DECODE_KELON168
 #if DECODE_KELON
-    DPRINTLN("Attempting Kelon 48-bit decode");
-    if (decodeKelon(results, offset)) return true;
+    case KELON:
+      DPRINTLN("Attempting Kelon 48-bit decode");
+      if (decodeKelon(results, offset)) return true;
+      break;
 #endif  // DECODE_KELON
 #if DECODE_SANYO_AC88
-    DPRINTLN("Attempting SanyoAc88 decode");
-    if (decodeSanyoAc88(results, offset)) return true;
+    case SANYO_AC88:
+      DPRINTLN("Attempting SanyoAc88 decode");
+      if (decodeSanyoAc88(results, offset)) return true;
+      break;
 #endif  // DECODE_SANYO_AC88
 #if DECODE_BOSE
-    DPRINTLN("Attempting Bose decode");
-    if (decodeBose(results, offset)) return true;
+    case BOSE:
+      DPRINTLN("Attempting Bose decode");
+      if (decodeBose(results, offset)) return true;
+      break;
 #endif  // DECODE_BOSE
 #if DECODE_ARRIS
-    DPRINTLN("Attempting Arris decode");
-    if (decodeArris(results, offset)) return true;
+    case ARRIS:
+      DPRINTLN("Attempting Arris decode");
+      if (decodeArris(results, offset)) return true;
+      break;
 #endif  // DECODE_ARRIS
 #if DECODE_RHOSS
-    DPRINTLN("Attempting Rhoss decode");
-    if (decodeRhoss(results, offset)) return true;
+    case RHOSS:
+      DPRINTLN("Attempting Rhoss decode");
+      if (decodeRhoss(results, offset)) return true;
+      break;
 #endif  // DECODE_RHOSS
 #if DECODE_AIRTON
-    DPRINTLN("Attempting Airton decode");
-    if (decodeAirton(results, offset)) return true;
+    case AIRTON:
+      DPRINTLN("Attempting Airton decode");
+      if (decodeAirton(results, offset)) return true;
+      break;
 #endif  // DECODE_AIRTON
 #if DECODE_COOLIX48
-    DPRINTLN("Attempting Coolix 48-bit decode");
-    if (decodeCoolix48(results, offset)) return true;
+    case COOLIX48:
+      DPRINTLN("Attempting Coolix 48-bit decode");
+      if (decodeCoolix48(results, offset)) return true;
+      break;
 #endif  // DECODE_COOLIX48
 #if DECODE_DAIKIN200
-    DPRINTLN("Attempting Daikin 200-bit decode");
-    if (decodeDaikin200(results, offset)) return true;
+    case DAIKIN200:
+      DPRINTLN("Attempting Daikin 200-bit decode");
+      if (decodeDaikin200(results, offset)) return true;
+      break;
 #endif  // DECODE_DAIKIN200
 #if DECODE_HAIER_AC160
-    DPRINTLN("Attempting Haier AC 160 bit decode");
-    if (decodeHaierAC160(results, offset)) return true;
+    case HAIER_AC160:
+      DPRINTLN("Attempting Haier AC 160 bit decode");
+      if (decodeHaierAC160(results, offset)) return true;
+      break;
 #endif  // DECODE_HAIER_AC160
 #if DECODE_CARRIER_AC128
-    DPRINTLN("Attempting Carrier AC 128-bit decode");
-    if (decodeCarrierAC128(results, offset)) return true;
+    case CARRIER_AC128:
+      DPRINTLN("Attempting Carrier AC 128-bit decode");
+      if (decodeCarrierAC128(results, offset)) return true;
+      break;
 #endif  // DECODE_CARRIER_AC128
 #if DECODE_TOTO
-    DPRINTLN("Attempting Toto 48/24-bit decode");
-    if (decodeToto(results, offset, kTotoLongBits) ||  // Long needs to be first
-        decodeToto(results, offset, kTotoShortBits)) return true;
+    case TOTO:
+      DPRINTLN("Attempting Toto 48/24-bit decode");
+      // Long needs to be first
+      if (decodeToto(results, offset, kTotoLongBits) ||
+          decodeToto(results, offset, kTotoShortBits)) return true;
+      break;
 #endif  // DECODE_TOTO
 #if DECODE_CLIMABUTLER
-    DPRINTLN("Attempting ClimaButler decode");
-    if (decodeClimaButler(results)) return true;
+    case CLIMABUTLER:
+      DPRINTLN("Attempting ClimaButler decode");
+      if (decodeClimaButler(results, offset)) return true;
+      break;
 #endif  // DECODE_CLIMABUTLER
 #if DECODE_TCL96AC
-    DPRINTLN("Attempting TCL AC 96-bit decode");
-    if (decodeTcl96Ac(results, offset)) return true;
+    case TCL96AC:
+      DPRINTLN("Attempting TCL AC 96-bit decode");
+      if (decodeTcl96Ac(results, offset)) return true;
+      break;
 #endif  // DECODE_TCL96AC
 #if DECODE_SANYO_AC152
-    DPRINTLN("Attempting Sanyo AC 152-bit decode");
-    if (decodeSanyoAc152(results, offset)) return true;
+    case SANYO_AC152:
+      DPRINTLN("Attempting Sanyo AC 152-bit decode");
+      if (decodeSanyoAc152(results, offset)) return true;
+      break;
 #endif  // DECODE_SANYO_AC152
 #if DECODE_DAIKIN312
-    DPRINTLN("Attempting Daikin 312-bit decode");
-    if (decodeDaikin312(results, offset)) return true;
+    case DAIKIN312:
+      DPRINTLN("Attempting Daikin 312-bit decode");
+      if (decodeDaikin312(results, offset)) return true;
+      break;
 #endif  // DECODE_DAIKIN312
 #if DECODE_GORENJE
-    DPRINTLN("Attempting GORENJE decode");
-    if (decodeGorenje(results, offset)) return true;
+    case GORENJE:
+      DPRINTLN("Attempting GORENJE decode");
+      if (decodeGorenje(results, offset)) return true;
+      break;
 #endif  // DECODE_GORENJE
 #if DECODE_WOWWEE
-    DPRINTLN("Attempting WOWWEE decode");
-    if (decodeWowwee(results, offset)) return true;
+    case WOWWEE:
+      DPRINTLN("Attempting WOWWEE decode");
+      if (decodeWowwee(results, offset)) return true;
+      break;
 #endif  // DECODE_WOWWEE
 #if DECODE_CARRIER_AC84
-    DPRINTLN("Attempting Carrier A/C 84-bit decode");
-    if (decodeCarrierAC84(results, offset)) return true;
+    case CARRIER_AC84:
+      DPRINTLN("Attempting Carrier A/C 84-bit decode");
+      if (decodeCarrierAC84(results, offset)) return true;
+      break;
 #endif  // DECODE_CARRIER_AC84
 #if DECODE_YORK
-    DPRINTLN("Attempting York decode");
-    if (decodeYork(results, offset, kYorkBits)) return true;
+    case YORK:
+      DPRINTLN("Attempting York decode");
+      if (decodeYork(results, offset, kYorkBits)) return true;
+      break;
 #endif  // DECODE_YORK
 #if DECODE_BLUESTARHEAVY
-    DPRINTLN("Attempting BluestarHeavy decode");
-    if (decodeBluestarHeavy(results, offset, kBluestarHeavyBits)) return true;
+    case BLUESTARHEAVY:
+      DPRINTLN("Attempting BluestarHeavy decode");
+      if (decodeBluestarHeavy(results, offset, kBluestarHeavyBits)) return true;
+      break;
 #endif  // DECODE_BLUESTARHEAVY
-  // Typically new protocols are added above this line.
-  }
-#if DECODE_HASH
-  // decodeHash returns a hash on any input.
-  // Thus, it needs to be last in the list.
-  // If you add any decodes, add them before this.
-  if (decodeHash(results)) {
-    return true;
+    default:
+      break;
   }
-#endif  // DECODE_HASH
-  // Throw away and start over
-  if (!resumed)  // Check if we have already resumed.
-    resume();
   return false;
 }  // NOLINT(readability/fn_size)
 
@@ -1218,11 +3729,9 @@ uint8_t IRrecv::_validTolerance(const uint8_t percentage) {
 /// @return Nr. of ticks.
 uint32_t IRrecv::ticksLow(const uint32_t usecs, const uint8_t tolerance,
                           const uint16_t delta) {
-  // max() used to ensure the result can't drop below 0 before the cast.
-  return (static_cast<uint32_t>(std::max(
-      static_cast<int32_t>(usecs * (1.0 - _validTolerance(tolerance) / 100.0) -
-          delta),
-      static_cast<int32_t>(0))));
+  const uint32_t scaled = _IRrecv::scalePercent(
+      usecs, 100 - _validTolerance(tolerance));
+  return (scaled > delta) ? scaled - delta : 0;
 }
 
 /// Calculate the upper bound of the nr. of ticks.
@@ -1232,8 +3741,46 @@ uint32_t IRrecv::ticksLow(const uint32_t usecs, const uint8_t tolerance,
 /// @return Nr. of ticks.
 uint32_t IRrecv::ticksHigh(const uint32_t usecs, const uint8_t tolerance,
                            const uint16_t delta) {
-  return (static_cast<uint32_t>(usecs * (1.0 + _validTolerance(tolerance) /
-                                100.0)) + 1 + delta);
+  return _IRrecv::scalePercent(usecs, 100 + _validTolerance(tolerance)) + 1 +
+      delta;
+}
+
+/// Calculate the range of raw capture values (ticks) that `match()` accepts.
+/// Use this to pre-calculate the bounds of a pulse that is going to be
+/// matched many times, so each match is only a pair of integer compares.
+/// @param[in] usecs Nr. of uSeconds.
+/// @param[in] tolerance Percent as an integer. e.g. 10 is 10%
+/// @param[in] delta A non-scaling (+/-) error margin (in useconds).
+/// @return The range of matching raw capture values.
+tick_range_t IRrecv::_tickRange(const uint32_t usecs, const uint8_t tolerance,
+                                const uint16_t delta) {
+  tick_range_t range;
+  // match() compares `measured * kRawTick` to these, so round them inwards.
+  range.low = (ticksLow(usecs, tolerance, delta) + kRawTick - 1) / kRawTick;
+  range.high = ticksHigh(usecs, tolerance, delta) / kRawTick;
+  return range;
+}
+
+/// Calculate the ranges of raw capture values that make up a '1' or '0' bit.
+/// i.e. What matchMark() & matchSpace() would accept for each of them.
+/// @param[in] onemark Nr. of uSeconds in an expected mark signal for a '1' bit.
+/// @param[in] onespace Nr. of uSecs in an expected space signal for a '1' bit.
+/// @param[in] zeromark Nr. of uSecs in an expected mark signal for a '0' bit.
+/// @param[in] zerospace Nr. of uSecs in an expected space signal for a '0' bit.
+/// @param[in] tolerance Percentage error margin to allow. (Default: kUseDefTol)
+/// @param[in] excess Nr. of uSeconds. (Def: kMarkExcess)
+/// @return The ranges of matching raw capture values.
+bit_ranges_t IRrecv::_bitRanges(const uint16_t onemark,
+                                const uint32_t onespace,
+                                const uint16_t zeromark,
+                                const uint32_t zerospace,
+                                const uint8_t tolerance, const int16_t excess) {
+  bit_ranges_t ranges;
+  ranges.onemark = _tickRange(onemark + excess, tolerance);
+  ranges.onespace = _tickRange(onespace - excess, tolerance);
+  ranges.zeromark = _tickRange(zeromark + excess, tolerance);
+  ranges.zerospace = _tickRange(zerospace - excess, tolerance);
+  return ranges;
 }
 
 /// Check if we match a pulse(measured) with the desired within
@@ -1263,8 +3810,25 @@ bool IRrecv::match(uint32_t measured, uint32_t desired, uint8_t tolerance,
   // If there is a legit case, then this should be removed.
   assert(ticksHigh(desired, tolerance, delta) >= desired);
 #endif  // UNIT_TEST
-  return (measured >= ticksLow(desired, tolerance, delta) &&
-          measured <= ticksHigh(desired, tolerance, delta));
+  const bool matched = (measured >= ticksLow(desired, tolerance, delta) &&
+                        measured <= ticksHigh(desired, tolerance, delta));
+#if ENABLE_DECODE_STATS
+  if (matched) _stats_depth++;
+#endif  // ENABLE_DECODE_STATS
+  if (matched && _candidates != NULL) _addResidual(measured, desired);
+  return matched;
+}
+
+/// Add how far a matched pulse is from its nominal value to the residual of
+/// the decoder being scored. See setCandidates().
+/// @param[in] measured The measured value. (Any unit)
+/// @param[in] nominal The nominal value. (The same unit)
+void IRrecv::_addResidual(const uint32_t measured, const uint32_t nominal) {
+  if (!nominal) return;
+  const uint32_t diff = (measured > nominal) ? measured - nominal
+                                            : nominal - measured;
+  _residual += diff * 100 / nominal;  // As a percentage.
+  _residual_count++;
 }
 
 /// Check if we match a pulse(measured) of at least desired within
@@ -1305,10 +3869,40 @@ bool IRrecv::matchAtLeast(uint32_t measured, uint32_t desired,
 #endif  // UNIT_TEST
   // We really should never get a value of 0, except as the last value
   // in the buffer. If that is the case, then assume infinity and return true.
-  if (measured == 0) return true;
-  return measured >= ticksLow(std::min(
+  const bool matched = (measured == 0) || measured >= ticksLow(std::min(
       desired, static_cast<uint32_t>(MS_TO_USEC(params.timeout))), tolerance,
       delta);
+#if ENABLE_DECODE_STATS
+  if (matched) _stats_depth++;
+#endif  // ENABLE_DECODE_STATS
+  return matched;
+}
+
+/// Could a message with a pulse distance data section end after a given nr.
+/// of data bits? i.e. Is there a footer gap, or the end of the capture, right
+/// after the footer mark that would follow them.
+/// Lets a decoder of a protocol with several lengths skip the lengths the
+/// capture can't be, without matching all of their data first.
+/// @param[in] results Ptr to the data to decode.
+/// @param[in] offset Where the first data mark is in the capture buffer.
+/// @param[in] nbits Nr. of data bits.
+/// @param[in] gap Nr. of uSeconds the footer gap needs to be at least.
+/// @param[in] tolerance Percentage error margin to allow. (Default: kUseDefTol)
+/// @param[in] excess Nr. of uSeconds. (Def: kMarkExcess)
+/// @return true, if it could end there. false, if it definitely can't.
+/// @note The gap is tested like matchAtLeast() does, so this never rejects a
+///   length a decoder using matchGeneric() with `atleast` would have accepted.
+bool IRrecv::_canEndAfter(const decode_results *results,
+                          const uint16_t offset, const uint16_t nbits,
+                          const uint32_t gap, const uint8_t tolerance,
+                          const int16_t excess) {
+  const uint32_t index = offset + nbits * 2 + 1;  // Just after the footer.
+  if (index > results->rawlen) return false;  // No room for the footer mark.
+  if (index == results->rawlen) return true;  // The capture ends with it.
+  const uint32_t measured = results->rawbuf[index] * kRawTick;
+  return measured == 0 || measured >= ticksLow(std::min(
+      gap, static_cast<uint32_t>(MS_TO_USEC(params.timeout))), tolerance,
+      excess);
 }
 
 /// Check if we match a mark signal(measured) with the desired within
@@ -1455,43 +4049,135 @@ bool IRrecv::decodeHash(decode_results *results) {
 /// @return A match_result_t structure containing the success (or not), the
 ///   data value, and how many buffer entries were used.
 match_result_t IRrecv::matchData(
-    volatile uint16_t *data_ptr, const uint16_t nbits, const uint16_t onemark,
+    const uint16_t *data_ptr, const uint16_t nbits, const uint16_t onemark,
     const uint32_t onespace, const uint16_t zeromark, const uint32_t zerospace,
     const uint8_t tolerance, const int16_t excess, const bool MSBfirst,
     const bool expectlastspace) {
+  return _matchData(data_ptr, nbits,
+                    _bitRanges(onemark, onespace, zeromark, zerospace,
+                               tolerance, excess),
+                    MSBfirst, expectlastspace);
+}
+
+/// Find the bits already classified from a data section with a set of bit
+/// timings, or start classifying them.
+/// Only done for the decoders called by decode(), as only then do we know the
+/// capture hasn't changed since the bits were classified.
+/// @param[in] data_ptr A pointer to where the data section starts.
+/// @param[in] nbits Nr. of data bits we expect.
+/// @param[in] ranges The ranges of raw capture values for each part of a bit.
+/// @return A ptr to the run of bits to use, or NULL if they aren't shared.
+bit_run_t *IRrecv::_bitRun(const uint16_t *data_ptr, const uint16_t nbits,
+                           const bit_ranges_t &ranges) {
+  // Ranked candidates need the timing of every pulse, so they can't share.
+  if (!_bit_runs_active || _candidates != NULL || nbits > 64) return NULL;
+  for (uint8_t i = 0; i < _bit_run_count; i++)
+    if (_bit_runs[i].start == data_ptr &&
+        _IRrecv::sameRanges(_bit_runs[i].ranges, ranges))
+      return &_bit_runs[i];
+  if (!_bit_run_slots) return NULL;
+  bit_run_t *run;
+  if (_bit_run_count < _bit_run_slots) {
+    run = &_bit_runs[_bit_run_count++];
+  } else {  // Replace the oldest one.
+    run = &_bit_runs[_bit_run_next];
+    _bit_run_next = (_bit_run_next + 1) % _bit_run_slots;
+  }
+  run->start = data_ptr;
+  run->ranges = ranges;
+  run->bits = 0;
+  run->nbits = 0;
+  run->complete = false;
+  return run;
+}
+
+/// Match & decode the typical data section of an IR message, using
+/// pre-calculated ranges for the bit timings.
+/// The data value is stored in the least significant bits reguardless of the
+/// bit ordering requested.
+/// @param[in] data_ptr A pointer to where we are at in the capture buffer.
+/// @param[in] nbits Nr. of data bits we expect.
+/// @param[in] ranges The ranges of raw capture values for each part of a bit.
+/// @param[in] MSBfirst Bit order to save the data in. (Def: true)
+///   true is Most Significant Bit First Order, false is Least Significant First
+/// @param[in] expectlastspace Do we expect a space at the end of the message?
+/// @return A match_result_t structure containing the success (or not), the
+///   data value, and how many buffer entries were used.
+/// @note Inside decode(), bits classified by an earlier decoder with the same
+///   timings at the same place are reused. See _bitRun().
+match_result_t IRrecv::_matchData(const uint16_t *data_ptr,
+                                  const uint16_t nbits,
+                                  const bit_ranges_t &ranges,
+                                  const bool MSBfirst,
+                                  const bool expectlastspace) {
+  using _IRrecv::inRange;
   match_result_t result;
   result.success = false;  // Fail by default.
   result.data = 0;
   if (expectlastspace) {  // We are expecting data with a final space.
-    for (result.used = 0; result.used < nbits * 2;
-         result.used += 2, data_ptr += 2) {
+    bit_run_t *run = _bitRun(data_ptr, nbits, ranges);
+    result.used = 0;
+    if (run != NULL) {  // Start with what has already been classified.
+      const uint16_t known = std::min(nbits, static_cast<uint16_t>(run->nbits));
+      if (known) result.data = run->bits >> (run->nbits - known);
+      result.used = known * 2;
+      data_ptr += result.used;
+    }
+    for (; result.used < nbits * 2; result.used += 2, data_ptr += 2) {
+      if (run != NULL && run->complete) break;  // We know it isn't a bit.
       // Is the bit a '1'?
-      if (matchMark(*data_ptr, onemark, tolerance, excess) &&
-          matchSpace(*(data_ptr + 1), onespace, tolerance, excess)) {
+      if (inRange(*data_ptr, ranges.onemark) &&
+          inRange(*(data_ptr + 1), ranges.onespace)) {
         result.data = (result.data << 1) | 1;
-      } else if (matchMark(*data_ptr, zeromark, tolerance, excess) &&
-                 matchSpace(*(data_ptr + 1), zerospace, tolerance, excess)) {
+        if (_candidates != NULL) {
+          _addResidual(*data_ptr, _IRrecv::midRange(ranges.onemark));
+          _addResidual(*(data_ptr + 1), _IRrecv::midRange(ranges.onespace));
+        }
+      } else if (inRange(*data_ptr, ranges.zeromark) &&
+                 inRange(*(data_ptr + 1), ranges.zerospace)) {
         result.data <<= 1;  // The bit is a '0'.
-      } else {
-        if (!MSBfirst) result.data = reverseBits(result.data, result.used / 2);
-        return result;  // It's neither, so fail.
+        if (_candidates != NULL) {
+          _addResidual(*data_ptr, _IRrecv::midRange(ranges.zeromark));
+          _addResidual(*(data_ptr + 1), _IRrecv::midRange(ranges.zerospace));
+        }
+      } else {  // It's neither.
+        if (run != NULL) run->complete = true;
+        break;
+      }
+      if (run != NULL) {  // Share it with the decoders after us.
+        run->bits = result.data;
+        run->nbits++;
       }
     }
+#if ENABLE_DECODE_STATS
+    _stats_depth += result.used;
+#endif  // ENABLE_DECODE_STATS
+    if (result.used < nbits * 2) {  // So fail.
+      if (!MSBfirst) result.data = reverseBits(result.data, result.used / 2);
+      return result;
+    }
     result.success = true;
   } else {  // We are expecting data without a final space.
     // Match all but the last bit, as it may not match easily.
-    result = matchData(data_ptr, nbits ? nbits - 1 : 0, onemark, onespace,
-                       zeromark, zerospace, tolerance, excess, true, true);
+    result = _matchData(data_ptr, nbits ? nbits - 1 : 0, ranges, true, true);
     if (result.success) {
       // Is the bit a '1'?
-      if (matchMark(*(data_ptr + result.used), onemark, tolerance, excess))
+      const uint16_t last = *(data_ptr + result.used);
+      if (inRange(last, ranges.onemark)) {
         result.data = (result.data << 1) | 1;
-      else if (matchMark(*(data_ptr + result.used), zeromark, tolerance,
-               excess))
+        if (_candidates != NULL)
+          _addResidual(last, _IRrecv::midRange(ranges.onemark));
+      } else if (inRange(last, ranges.zeromark)) {
         result.data <<= 1;  // The bit is a '0'.
-      else
+        if (_candidates != NULL)
+          _addResidual(last, _IRrecv::midRange(ranges.zeromark));
+      } else {
         result.success = false;
+      }
       if (result.success) result.used++;
+#if ENABLE_DECODE_STATS
+      if (result.success) _stats_depth++;
+#endif  // ENABLE_DECODE_STATS
     }
   }
   if (!MSBfirst) result.data = reverseBits(result.data, nbits);
@@ -1515,7 +4201,7 @@ match_result_t IRrecv::matchData(
 ///   true is Most Significant Bit First Order, false is Least Significant First
 /// @param[in] expectlastspace Do we expect a space at the end of the message?
 /// @return If successful, how many buffer entries were used. Otherwise 0.
-uint16_t IRrecv::matchBytes(volatile uint16_t *data_ptr, uint8_t *result_ptr,
+uint16_t IRrecv::matchBytes(const uint16_t *data_ptr, uint8_t *result_ptr,
                             const uint16_t remaining, const uint16_t nbytes,
                             const uint16_t onemark, const uint32_t onespace,
                             const uint16_t zeromark, const uint32_t zerospace,
@@ -1525,11 +4211,13 @@ uint16_t IRrecv::matchBytes(volatile uint16_t *data_ptr, uint8_t *result_ptr,
   if (remaining + expectlastspace < (nbytes * 8 * 2) + 1)
     return 0;  // Nope, so abort.
   uint16_t offset = 0;
+  // Only work out what each bit should look like once, not for every byte.
+  const bit_ranges_t ranges = _bitRanges(onemark, onespace, zeromark,
+                                         zerospace, tolerance, excess);
   for (uint16_t byte_pos = 0; byte_pos < nbytes; byte_pos++) {
     bool lastspace = (byte_pos + 1 == nbytes) ? expectlastspace : true;
-    match_result_t result = matchData(data_ptr + offset, 8, onemark, onespace,
-                                      zeromark, zerospace, tolerance, excess,
-                                      MSBfirst, lastspace);
+    match_result_t result = _matchData(data_ptr + offset, 8, ranges, MSBfirst,
+                                       lastspace);
     if (result.success == false) return 0;  // Fail
     result_ptr[byte_pos] = (uint8_t)result.data;
     offset += result.used;
@@ -1567,7 +4255,7 @@ uint16_t IRrecv::matchBytes(volatile uint16_t *data_ptr, uint8_t *result_ptr,
 /// @param[in] MSBfirst Bit order to save the data in. (Def: true)
 ///   true is Most Significant Bit First Order, false is Least Significant First
 /// @return If successful, how many buffer entries were used. Otherwise 0.
-uint16_t IRrecv::_matchGeneric(volatile uint16_t *data_ptr,
+uint16_t IRrecv::_matchGeneric(const uint16_t *data_ptr,
                               uint64_t *result_bits_ptr,
                               uint8_t *result_bytes_ptr,
                               const bool use_bits,
@@ -1669,7 +4357,7 @@ uint16_t IRrecv::_matchGeneric(volatile uint16_t *data_ptr,
 /// @param[in] MSBfirst Bit order to save the data in. (Def: true)
 ///   true is Most Significant Bit First Order, false is Least Significant First
 /// @return If successful, how many buffer entries were used. Otherwise 0.
-uint16_t IRrecv::matchGeneric(volatile uint16_t *data_ptr,
+uint16_t IRrecv::matchGeneric(const uint16_t *data_ptr,
                               uint64_t *result_ptr,
                               const uint16_t remaining,
                               const uint16_t nbits,
@@ -1716,7 +4404,7 @@ uint16_t IRrecv::matchGeneric(volatile uint16_t *data_ptr,
 /// @param[in] MSBfirst Bit order to save the data in. (Def: true)
 ///   true is Most Significant Bit First Order, false is Least Significant First
 /// @return If successful, how many buffer entries were used. Otherwise 0.
-uint16_t IRrecv::matchGeneric(volatile uint16_t *data_ptr,
+uint16_t IRrecv::matchGeneric(const uint16_t *data_ptr,
                               uint8_t *result_ptr,
                               const uint16_t remaining,
                               const uint16_t nbits,
@@ -1763,7 +4451,7 @@ uint16_t IRrecv::matchGeneric(volatile uint16_t *data_ptr,
 /// @return If successful, how many buffer entries were used. Otherwise 0.
 /// @note Parameters one + zero add up to the total time for a bit.
 ///   e.g. mark(one) + space(zero) is a `1`, mark(zero) + space(one) is a `0`.
-uint16_t IRrecv::matchGenericConstBitTime(volatile uint16_t *data_ptr,
+uint16_t IRrecv::matchGenericConstBitTime(const uint16_t *data_ptr,
                                           uint64_t *result_ptr,
                                           const uint16_t remaining,
                                           const uint16_t nbits,
@@ -1850,7 +4538,7 @@ uint16_t IRrecv::matchGenericConstBitTime(volatile uint16_t *data_ptr,
 /// @return If successful, how many buffer entries were used. Otherwise 0.
 /// @see https://en.wikipedia.org/wiki/Manchester_code
 /// @see http://ww1.microchip.com/downloads/en/AppNotes/Atmel-9164-Manchester-Coding-Basics_Application-Note.pdf
-uint16_t IRrecv::matchManchester(volatile const uint16_t *data_ptr,
+uint16_t IRrecv::matchManchester(const uint16_t *data_ptr,
                                  uint64_t *result_ptr,
                                  const uint16_t remaining,
                                  const uint16_t nbits,
@@ -1957,7 +4645,7 @@ uint16_t IRrecv::matchManchester(volatile const uint16_t *data_ptr,
 /// @see https://en.wikipedia.org/wiki/Manchester_code
 /// @see http://ww1.microchip.com/downloads/en/AppNotes/Atmel-9164-Manchester-Coding-Basics_Application-Note.pdf
 /// @todo Clean up and optimise this. It is just "get it working code" atm.
-uint16_t IRrecv::matchManchesterData(volatile const uint16_t *data_ptr,
+uint16_t IRrecv::matchManchesterData(const uint16_t *data_ptr,
                                      uint64_t *result_ptr,
                                      const uint16_t remaining,
                                      const uint16_t nbits,
@@ -2081,5 +4769,84 @@ uint16_t IRrecv::matchManchesterData(volatile const uint16_t *data_ptr,
 volatile irparams_t *IRrecv::_getParamsPtr(void) {
   return &params;
 }
+
+/// Unit test helper to receive an edge as if the GPIO interrupt had.
+/// @param[in] ticks Time since the previous edge, in ticks. (kRawTick uSecs)
+///   Ignored for the first edge of a capture.
+void IRrecv::_injectEdge(const uint16_t ticks) {
+  _timer_armed = false;
+  if (params.rawlen >= params.bufsize) {
+    params.overflow = true;
+    params.rcvstate = kStopState;
+  }
+  if (params.rcvstate == kStopState) {
+    _timer_armed = _queue_size > 0;  // As per gpioIntr().
+    return;
+  }
+  _timer_armed = true;
+  uint16_t entry = ticks;
+  if (params.rcvstate == kIdleState) {
+    params.rcvstate = kMarkState;
+    entry = 1;
+  }
+  if (_compact) {
+    const uint8_t used = _IRrecv::storeCompact(
+        reinterpret_cast<uint8_t *>(params.rawbuf), params.bufsize,
+        params.rawlen, entry);
+    if (!used) {
+      params.overflow = true;
+      params.rcvstate = kStopState;
+    }
+    params.rawlen += used;
+  } else {
+    params.rawbuf[params.rawlen++] = entry;
+  }
+}
+
+/// Unit test helper to fire the timeout as if the timer interrupt had.
+void IRrecv::_injectTimeout(void) {
+  if (!_timer_armed) return;  // It was never started, or was disarmed.
+  _timer_armed = false;
+  if (params.rawlen) {
+    params.rcvstate = kStopState;
+    _queueCapture();
+  }
+}
+
+/// Unit test helper to capture a message as if the interrupts had.
+/// i.e. The edges arrive & then the timeout fires.
+/// @param[in] rawbuf The message's intervals, in ticks. (as per the ISR)
+/// @param[in] rawlen Nr. of entries in `rawbuf`.
+/// @param[in] timestamp When the message started. (micros())
+/// @return true, if it was captured. false, if it was dropped.
+bool IRrecv::_injectCapture(const uint16_t *rawbuf, const uint16_t rawlen,
+                            const uint32_t timestamp) {
+  if (!rawlen) return false;
+  if (params.rcvstate == kStopState) {
+    _drops++;
+    return false;
+  }
+  const uint16_t bufsize = params.bufsize;
+  if (_compact) {
+    uint8_t *compact = reinterpret_cast<uint8_t *>(params.rawbuf);
+    uint16_t i = 0;
+    params.rawlen = 0;
+    for (; i < rawlen; i++) {
+      const uint8_t used = _IRrecv::storeCompact(compact, bufsize,
+                                                 params.rawlen, rawbuf[i]);
+      if (!used) break;
+      params.rawlen += used;
+    }
+    params.overflow = i < rawlen;
+  } else {
+    params.overflow = rawlen > bufsize;
+    params.rawlen = std::min(rawlen, bufsize);
+    for (uint16_t i = 0; i < params.rawlen; i++) params.rawbuf[i] = rawbuf[i];
+  }
+  params.timestamp = timestamp;
+  params.rcvstate = kStopState;
+  _queueCapture();
+  return true;
+}
 #endif  // UNIT_TEST
 // End of IRrecv class -------------------
@@ -47,6 +47,20 @@ const uint16_t kRawTick = 2;     // Capture tick to uSec factor.
 const uint8_t kTimeoutMs = 15;  // In MilliSeconds.
 #define TIMEOUT_MS kTimeoutMs   // For legacy documentation.
 const uint16_t kMaxTimeoutMs = kRawTick * (UINT16_MAX / MS_TO_USEC(1));
+// Nr. of IRrecv objects that can be capturing (have interrupts) at once.
+const uint8_t kMaxReceivers = 4;
+// Max. nr. of captures decodeCombined() & decodeDiversity() will combine.
+const uint8_t kMaxDiversity = 8;
+// How close (ms) the starts of captures of the same message must be.
+const uint8_t kDiversityWindowMs = 10;
+// Shortest space (uSecs) that may be a gap between two messages in a capture.
+// Shorter than the gap after a message in any protocol. See decodeNext().
+const uint16_t kMinMessageGap = 3000;
+// Compact capture tick (uSecs). Compact entries are in multiples of this.
+const uint16_t kCompactTick = 8;
+// A compact entry of this is followed by the whole entry, in ticks
+// (kRawTick uSecs), LSB first. i.e. One that is too long for a byte.
+const uint8_t kCompactEscape = UINT8_MAX;
 
 // Use FNV hash algorithm: http://isthe.com/chongo/tech/comp/fnv/#FNV-param
 const uint32_t kFnvPrime32 = 16777619UL;
@@ -84,8 +98,17 @@ typedef struct {
   uint16_t rawlen;   // counter of entries in rawbuf.
   uint8_t overflow;  // Buffer overflow indicator.
   uint8_t timeout;   // Nr. of milliSeconds before we give up.
+  uint32_t timestamp;  // micros() at the first edge of the capture.
 } irparams_t;
 
+/// A completed capture waiting in the capture queue.
+typedef struct {
+  uint16_t *rawbuf;    // Swapped with the interrupt's buffer, never copied.
+  uint16_t rawlen;     // Nr. of entries used. Non-zero means it is unread.
+  uint8_t overflow;    // Buffer overflow indicator.
+  uint32_t timestamp;  // micros() at the first edge of the message.
+} capture_slot_t;
+
 /// Results from a data match
 typedef struct {
   bool success;   // Was the match successful?
@@ -93,6 +116,68 @@ typedef struct {
   uint16_t used;  // How many buffer positions were used.
 } match_result_t;
 
+/// A range of measured periods (in ticks) that match a desired period.
+typedef struct {
+  uint32_t low;   // The shortest matching nr. of ticks.
+  uint32_t high;  // The longest matching nr. of ticks.
+} tick_range_t;
+
+/// Pre-calculated tick ranges for matching the bits of a data section.
+typedef struct {
+  tick_range_t onemark;
+  tick_range_t onespace;
+  tick_range_t zeromark;
+  tick_range_t zerospace;
+} bit_ranges_t;
+
+/// Nr. of runs of classified bits kept during a decode() pass.
+const uint8_t kBitRunCacheSize = 4;
+
+/// The bits classified so far from a data section of a capture, using a set of
+/// bit timings. Decoders of protocols with the same timings (e.g. the NEC
+/// family) read them from here, rather than matching every pulse again.
+typedef struct {
+  const uint16_t *start;  // Where the data section starts in the capture.
+  bit_ranges_t ranges;    // The timings the bits were classified with.
+  uint64_t bits;          // The bits classified so far. MSB first order.
+  uint8_t nbits;          // Nr. of bits classified so far.
+  bool complete;          // Is the entry after them not a bit?
+} bit_run_t;
+
+#if ENABLE_DECODE_STATS
+/// Nr. of buckets in the decoder rejection position histogram.
+const uint8_t kDecodeStatsBuckets = 8;
+
+/// Statistics on the use of a protocol's decoder(s).
+typedef struct {
+  uint32_t attempts;   // Nr. of times its decoder(s) were tried.
+  uint32_t successes;  // Nr. of times they decoded a message.
+  uint32_t usecs;      // Total nr. of microseconds spent in them.
+  // Histogram of how far into the capture a failed attempt got before it was
+  // rejected. Bucket `n` counts rejections after matching 2^n to 2^(n+1) - 1
+  // entries. Bucket 0 also counts 0 entries. The last bucket counts the rest.
+  uint16_t rejects[kDecodeStatsBuckets];
+} decode_stats_t;
+#endif  // ENABLE_DECODE_STATS
+
+#if ENABLE_NOISE_FILTER_OPTION
+/// How the noise filter treats pulses shorter than decode()'s `noise_floor`.
+enum noise_filter_t {
+  kNoiseFilterMerge = 0,  ///< (0) Remove them & the next pulse, adding them to
+                          ///<     the previous pulse. (Default)
+  kNoiseFilterSpike,      ///< (1) Only remove isolated ones, the same way.
+                          ///<     Keeps the total duration of the capture.
+};
+#endif  // ENABLE_NOISE_FILTER_OPTION
+
+/// How decodeCombined() merges captures of the same message, if none of them
+/// can be decoded on their own.
+enum diversity_merge_t {
+  kDiversityMedian = 0,  ///< (0) Use the median of each entry. (Default)
+  kDiversityMajority,    ///< (1) Use the mean of the largest group of entries
+                         ///<     that match each other.
+};
+
 // Classes
 
 /// Results returned from the decoder
@@ -111,12 +196,75 @@ class decode_results {
     uint8_t state[kStateSizeMax];  // Multi-byte results.
   };
   uint16_t bits;              // Number of bits in decoded value
-  volatile uint16_t *rawbuf;  // Raw intervals in .5 us ticks
+  uint16_t *rawbuf;           // Raw intervals in .5 us ticks
   uint16_t rawlen;            // Number of records in rawbuf.
   bool overflow;
   bool repeat;  // Is the result a repeat code?
 };
 
+/// Best possible score for a decode candidate. See `IRrecv::setCandidates()`.
+const uint8_t kMaxCandidateScore = 100;
+
+/// A protocol that could decode a capture, & how well it matched.
+typedef struct {
+  decode_results result;  // What it was decoded as.
+  uint8_t score;  // 0 - kMaxCandidateScore. 100 less the mean timing error (%).
+} decode_candidate_t;
+
+/// A recent decode, & the capture it came from. See `IRrecv::setDecodeCache()`.
+typedef struct {
+  uint32_t fingerprint;  // Of the capture's entries.
+  uint16_t rawlen;  // The capture's length. 0 if the entry is unused.
+  decode_results result;  // What it was decoded as. Without the `rawbuf`.
+} decode_cache_t;
+
+class IRrecv;
+
+namespace _IRrecv {
+// The interrupt handlers. Each interrupt slot's trampoline calls them with the
+// receiver using that slot.
+void gpioIntr(IRrecv *irrecv);
+void readTimeout(IRrecv *irrecv);
+// The compact capture format. See IRrecv::setCompactCapture().
+uint8_t storeCompact(uint8_t *compact, const uint16_t size,
+                     const uint16_t pos, const uint32_t ticks);
+uint16_t expandCompact(const uint8_t *compact, const uint16_t size,
+                       uint16_t *rawbuf, const uint16_t max,
+                       uint16_t *used = NULL);
+
+/// Max. nr. of sections in a kSegmented entry.
+const uint8_t kMaxSections = 4;
+
+/// One section of a message that is sent as several, with gaps between them.
+typedef struct {
+  uint16_t hdrmark;   // Nominal header mark (usecs). 0 if there is none.
+  uint16_t hdrspace;  // Nominal header space (usecs). 0 if there is none.
+  uint16_t nbits;     // Nr. of data bits in it.
+  bool stored;        // Are they part of the state? If not, they must be 0.
+  uint32_t gap;       // Nominal gap (usecs) after it. 0 for the last section.
+} section_t;
+
+/// How a protocol that segmented decoding knows is split into sections.
+/// They all use the same bit timings, & end with a bit mark.
+typedef struct {
+  uint8_t protocol;   // The decode_type_t of the message.
+  uint16_t nbits;     // Nr. of state bits in the whole message.
+  uint8_t tolerance;  // Percentage tolerance to match with.
+  uint16_t excess;    // Extra mark length to allow for. (usecs)
+  uint16_t bitmark;   // Nominal bit & footer mark. (usecs)
+  uint16_t onespace;  // Nominal space of a 1 bit. (usecs)
+  uint16_t zerospace;  // Nominal space of a 0 bit. (usecs)
+  uint8_t sections;   // Nr. of entries used in `section`.
+  section_t section[kMaxSections];
+  bool (*valid)(uint8_t state[], const uint16_t length);  // Can be NULL.
+} segmented_t;
+
+/// The protocols segmented decoding can assemble from separate captures.
+/// See IRrecv::setSegmentedDecode(). Defined in ir_Daikin.cpp, as only Daikin
+/// protocols are supported so far.
+extern const segmented_t kSegmented[];
+}  // namespace _IRrecv
+
 /// Class for receiving IR messages.
 class IRrecv {
  public:
@@ -133,13 +281,67 @@ class IRrecv {
   ~IRrecv(void);                                                  // Destructor
   void setTolerance(const uint8_t percent = kTolerance);
   uint8_t getTolerance(void);
+  void setIncrementalDecode(const bool enable);
+  bool getIncrementalDecode(void);
+  void setProtocolEnabled(const decode_type_t protocol, const bool enable);
+  void setAllProtocolsEnabled(const bool enable);
+  bool isProtocolEnabled(const decode_type_t protocol);
+  void setCandidates(decode_candidate_t *candidates, const uint8_t size);
+  uint8_t getCandidateCount(void);
+#if ENABLE_NOISE_FILTER_OPTION
+  void setNoiseFilter(const noise_filter_t type);
+  noise_filter_t getNoiseFilter(void);
+#endif  // ENABLE_NOISE_FILTER_OPTION
+  bool setAdaptiveOrder(const bool enable);
+  bool getAdaptiveOrder(void);
+  bool setSegmentedDecode(const bool enable);
+  bool getSegmentedDecode(void);
+  bool setDecodeCache(const uint8_t size);
+  uint8_t getDecodeCacheSize(void);
+  uint32_t getDecodeCacheHits(void);
+  uint32_t getDecodeCacheMisses(void);
+  void resetDecodeOrder(void);
+  decode_type_t getDecodeOrder(const uint8_t position);
+  void setDecodeBudget(const uint32_t usecs, const uint16_t decoders = 0);
+  bool isDecodePending(void);
+  static bool mustDecodeBefore(const decode_type_t first,
+                               const decode_type_t second);
+#if ENABLE_DECODE_STATS
+  decode_stats_t getDecodeStats(const decode_type_t protocol);
+  void resetDecodeStats(void);
+  String decodeStatsToString(void);
+#endif  // ENABLE_DECODE_STATS
   bool decode(decode_results *results, irparams_t *save = NULL,
               uint8_t max_skip = 0, uint16_t noise_floor = 0);
+  bool decodeCapture(decode_results *results, const uint8_t max_skip = 0,
+                     const uint16_t noise_floor = 0);
+  bool decodeAs(decode_results *results, const decode_type_t protocol,
+                irparams_t *save = NULL, const uint8_t max_skip = 0,
+                const uint16_t noise_floor = 0);
+  bool decodeCombined(decode_results *results,
+                      const decode_results captures[], const uint8_t count,
+                      const diversity_merge_t merge = kDiversityMedian,
+                      const uint8_t max_skip = 0,
+                      const uint16_t noise_floor = 0);
+  bool decodeDiversity(decode_results *results, IRrecv *const others[],
+                       const uint8_t count,
+                       const uint8_t window = kDiversityWindowMs,
+                       const diversity_merge_t merge = kDiversityMedian,
+                       const uint8_t max_skip = 0,
+                       const uint16_t noise_floor = 0);
+  bool decodeNext(decode_results *results, const uint8_t max_skip = 0);
   void enableIRIn(const bool pullup = false);
   void disableIRIn(void);
   void pause(void);
   void resume(void);
   uint16_t getBufSize(void);
+  bool setCaptureQueueSize(const uint8_t size);
+  uint8_t getCaptureQueueSize(void);
+  bool setCompactCapture(const bool enable);
+  bool getCompactCapture(void);
+  uint8_t getCapturesPending(void);
+  uint32_t getCaptureDrops(void);
+  uint32_t getCaptureTimestamp(void);
 #if DECODE_HASH
   void setUnknownThreshold(const uint16_t length);
 #endif
@@ -162,7 +364,22 @@ class IRrecv {
 
  private:
 #endif
-  irparams_t *irparams_save;
+  friend void _IRrecv::gpioIntr(IRrecv *irrecv);
+  friend void _IRrecv::readTimeout(IRrecv *irrecv);
+  // The capture state. Shared with our interrupt handlers.
+  volatile irparams_t params;
+  irparams_t *params_save;  // A copy of the interrupt state while decoding.
+  // The optional single-producer/single-consumer queue of completed captures.
+  volatile capture_slot_t *_queue;
+  uint8_t _queue_size;  // Nr. of slots in the queue. 0 is disabled.
+  uint8_t _queue_head;  // The next slot the producer will fill.
+  uint8_t _queue_tail;  // The next slot the consumer will read.
+  bool _queue_held;     // Is the tail slot lent to a decode_results?
+  bool _compact;  // Are the capture & queue buffers in the compact format?
+  volatile uint32_t _drops;  // Nr. of messages we had nowhere to capture.
+  uint32_t _timestamp;  // micros() at the start of the last decode().
+  uint32_t _last_edge;  // micros() at the last edge the interrupt saw.
+  uint8_t _slot;  // Our interrupt slot. kMaxReceivers if we didn't get one.
   uint8_t _tolerance;
 #if defined(ESP32)
   uint8_t _timer_num;
@@ -170,12 +387,87 @@ class IRrecv {
 #if DECODE_HASH
   uint16_t _unknown_threshold;
 #endif
+  bool _incremental;
+  uint16_t _stream_start;  // Where the next message starts in the capture.
+  uint16_t _stream_tried;  // The capture length we last tried to decode.
+  uint16_t *_next_rawbuf;  // The capture decodeNext() is in. NULL if none.
+  uint16_t _next_rawlen;  // Its length.
+  bool _next_overflow;  // Did it overflow?
+  uint16_t _next_start;  // Where the last message decoded from it starts.
+  uint16_t _next_end;  // Where that message ends. 0 if not known yet.
+  decode_type_t _next_type;  // What it was. UNUSED if nothing.
+  uint16_t _next_bits;  // Its size.
+  // Which protocols decode() tries. One bit per decode_type_t. Bit 0 (UNUSED)
+  // is used for UNKNOWN. i.e. The hash decoder.
+  uint8_t _enabled[kLastDecodeType / 8 + 1];
+  decode_type_t _decode_as;  // What decodeAs() wants. UNUSED if anything.
+  uint8_t *_order;  // Adaptive order of the decoder table. NULL if fixed.
+  uint16_t *_hits;  // Nr. of successful decodes for each decoder table entry.
+#if ENABLE_NOISE_FILTER_OPTION
+  noise_filter_t _noise_filter;
+#endif  // ENABLE_NOISE_FILTER_OPTION
+  decode_candidate_t *_candidates;  // Where to rank decodes. NULL if not.
+  uint8_t _candidates_size;
+  uint8_t _candidate_count;
+  decode_cache_t *_cache;  // Recent decodes. NULL if not caching them.
+  uint8_t _cache_size;
+  uint8_t _cache_next;  // Which entry to replace next.
+  uint32_t _cache_fingerprint;  // Of the capture being decoded.
+  uint32_t _cache_hits;
+  uint32_t _cache_misses;
+  uint32_t _budget_usecs;  // Max time per decode() call. 0 is unlimited.
+  uint16_t _budget_decoders;  // Max decoders per decode() call. 0 is no max.
+  bool _pending;  // Is a decode of the pinned capture still in progress?
+  bool _pending_resume;  // Must we resume() if it finds nothing?
+  uint16_t _pending_offset;  // Where the pending decode is up to.
+  uint8_t _pending_index;  // Position in the decode order it's up to.
+  uint8_t _pending_best;  // Decoder of its best candidate so far.
+  uint32_t _residual;  // Sum of the % timing errors of the current decoder.
+  uint16_t _residual_count;  // Nr. of timings in _residual.
+  bit_run_t _bit_runs[kBitRunCacheSize];  // Shared by decoders in a pass.
+  uint8_t _bit_run_slots;  // How many of _bit_runs may be used.
+  uint8_t _bit_run_count;  // How many of _bit_runs are in use.
+  uint8_t _bit_run_next;  // Which run to replace next, once they are all used.
+  bool _bit_runs_active;  // Are we inside a decoder called by decode()?
+  uint8_t *_segment_state;  // The sections decoded so far. NULL if disabled.
+  uint16_t _segment_candidates;  // What they may be. Bit per kSegmented entry.
+  uint8_t _segment_next;  // The next section we expect.
+  uint16_t _segment_pos;  // Nr. of bytes of _segment_state used.
+  uint32_t _segment_end;  // micros() at the end of the last section.
+#if ENABLE_DECODE_STATS
+  decode_stats_t _stats[kLastDecodeType + 1];
+  uint16_t _stats_depth;  // Nr. of capture entries matched by this attempt.
+#endif  // ENABLE_DECODE_STATS
 #ifdef UNIT_TEST
   volatile irparams_t *_getParamsPtr(void);
+  bool _injectCapture(const uint16_t *rawbuf, const uint16_t rawlen,
+                      const uint32_t timestamp = 0);
+  void _injectEdge(const uint16_t ticks);
+  void _injectTimeout(void);
+  bool _timer_armed;  // Would the timeout timer be running?
 #endif  // UNIT_TEST
+  bool _queueCapture(void);
+  void _releaseCapture(void);
+  uint16_t *_newCaptureBuffer(void);
+  void _expandCapture(const uint16_t *rawbuf, const uint16_t rawlen,
+                      irparams_t *dst);
+  bool _dequeueCapture(decode_results *results, irparams_t *save,
+                       const bool swap);
+  void _freeCaptureQueue(void);
+  bool _peekCapture(decode_results *capture, uint32_t *timestamp);
+  bool _decodeSegments(decode_results *results, bool *claimed);
+  bool _matchSections(const decode_results *results, const uint8_t index,
+                      uint8_t *next, uint16_t *pos);
+  void _beginCapture(const decode_results *results);
+  bool _noteMessage(const decode_results *results);
+  uint16_t _messageEnd(const uint8_t max_skip);
+  uint16_t _findHeader(const uint16_t from);
+  bool _decodeCached(decode_results *results, const uint8_t max_skip);
+  void _cacheResult(const decode_results *results);
   // These are called by decode
   uint8_t _validTolerance(const uint8_t percentage);
   void copyIrParams(volatile irparams_t *src, irparams_t *dst);
+  void swapIrParams(volatile irparams_t *src, irparams_t *dst);
   uint16_t compare(const uint16_t oldval, const uint16_t newval);
   uint32_t ticksLow(const uint32_t usecs,
                     const uint8_t tolerance = kUseDefTol,
@@ -186,7 +478,24 @@ class IRrecv {
   bool matchAtLeast(const uint32_t measured, const uint32_t desired,
                     const uint8_t tolerance = kUseDefTol,
                     const uint16_t delta = 0);
-  uint16_t _matchGeneric(volatile uint16_t *data_ptr,
+  bool _canEndAfter(const decode_results *results, const uint16_t offset,
+                    const uint16_t nbits, const uint32_t gap,
+                    const uint8_t tolerance = kUseDefTol,
+                    const int16_t excess = kMarkExcess);
+  tick_range_t _tickRange(const uint32_t usecs,
+                          const uint8_t tolerance = kUseDefTol,
+                          const uint16_t delta = 0);
+  bit_ranges_t _bitRanges(const uint16_t onemark, const uint32_t onespace,
+                          const uint16_t zeromark, const uint32_t zerospace,
+                          const uint8_t tolerance = kUseDefTol,
+                          const int16_t excess = kMarkExcess);
+  bit_run_t *_bitRun(const uint16_t *data_ptr, const uint16_t nbits,
+                     const bit_ranges_t &ranges);
+  match_result_t _matchData(const uint16_t *data_ptr, const uint16_t nbits,
+                            const bit_ranges_t &ranges,
+                            const bool MSBfirst = true,
+                            const bool expectlastspace = true);
+  uint16_t _matchGeneric(const uint16_t *data_ptr,
                          uint64_t *result_bits_ptr,
                          uint8_t *result_ptr,
                          const bool use_bits,
@@ -204,14 +513,14 @@ class IRrecv {
                          const uint8_t tolerance = kUseDefTol,
                          const int16_t excess = kMarkExcess,
                          const bool MSBfirst = true);
-  match_result_t matchData(volatile uint16_t *data_ptr, const uint16_t nbits,
+  match_result_t matchData(const uint16_t *data_ptr, const uint16_t nbits,
                            const uint16_t onemark, const uint32_t onespace,
                            const uint16_t zeromark, const uint32_t zerospace,
                            const uint8_t tolerance = kUseDefTol,
                            const int16_t excess = kMarkExcess,
                            const bool MSBfirst = true,
                            const bool expectlastspace = true);
-  uint16_t matchBytes(volatile uint16_t *data_ptr, uint8_t *result_ptr,
+  uint16_t matchBytes(const uint16_t *data_ptr, uint8_t *result_ptr,
                       const uint16_t remaining, const uint16_t nbytes,
                       const uint16_t onemark, const uint32_t onespace,
                       const uint16_t zeromark, const uint32_t zerospace,
@@ -219,7 +528,7 @@ class IRrecv {
                       const int16_t excess = kMarkExcess,
                       const bool MSBfirst = true,
                       const bool expectlastspace = true);
-  uint16_t matchGeneric(volatile uint16_t *data_ptr,
+  uint16_t matchGeneric(const uint16_t *data_ptr,
                         uint64_t *result_ptr,
                         const uint16_t remaining, const uint16_t nbits,
                         const uint16_t hdrmark, const uint32_t hdrspace,
@@ -230,7 +539,7 @@ class IRrecv {
                         const uint8_t tolerance = kUseDefTol,
                         const int16_t excess = kMarkExcess,
                         const bool MSBfirst = true);
-  uint16_t matchGeneric(volatile uint16_t *data_ptr, uint8_t *result_ptr,
+  uint16_t matchGeneric(const uint16_t *data_ptr, uint8_t *result_ptr,
                         const uint16_t remaining, const uint16_t nbits,
                         const uint16_t hdrmark, const uint32_t hdrspace,
                         const uint16_t onemark, const uint32_t onespace,
@@ -241,7 +550,7 @@ class IRrecv {
                         const uint8_t tolerance = kUseDefTol,
                         const int16_t excess = kMarkExcess,
                         const bool MSBfirst = true);
-  uint16_t matchGenericConstBitTime(volatile uint16_t *data_ptr,
+  uint16_t matchGenericConstBitTime(const uint16_t *data_ptr,
                                     uint64_t *result_ptr,
                                     const uint16_t remaining,
                                     const uint16_t nbits,
@@ -255,7 +564,7 @@ class IRrecv {
                                     const uint8_t tolerance = kUseDefTol,
                                     const int16_t excess = kMarkExcess,
                                     const bool MSBfirst = true);
-  uint16_t matchManchesterData(volatile const uint16_t *data_ptr,
+  uint16_t matchManchesterData(const uint16_t *data_ptr,
                                uint64_t *result_ptr,
                                const uint16_t remaining,
                                const uint16_t nbits,
@@ -265,7 +574,7 @@ class IRrecv {
                                const int16_t excess = kMarkExcess,
                                const bool MSBfirst = true,
                                const bool GEThomas = true);
-  uint16_t matchManchester(volatile const uint16_t *data_ptr,
+  uint16_t matchManchester(const uint16_t *data_ptr,
                            uint64_t *result_ptr,
                            const uint16_t remaining,
                            const uint16_t nbits,
@@ -281,6 +590,23 @@ class IRrecv {
                            const bool GEThomas = true);
   void crudeNoiseFilter(decode_results *results, const uint16_t floor = 0);
   bool decodeHash(decode_results *results);
+  bool _decodeProtocol(decode_results *results, const decode_type_t protocol,
+                       const uint16_t offset);
+  bool _decodeKnown(decode_results *results, const uint8_t max_skip = 0,
+                    const bool early = false);
+  bool _decoderEnabled(const uint8_t protocol);
+  void _noteHit(const uint8_t index);
+  uint8_t _addCandidate(const decode_results *results);
+  void _addResidual(const uint32_t measured, const uint32_t nominal);
+  bool _tryDecoder(decode_results *results, const decode_type_t protocol,
+                   const uint16_t offset);
+#if ENABLE_DECODE_STATS
+  bool _decodeProtocolStats(decode_results *results,
+                            const decode_type_t protocol,
+                            const uint16_t offset);
+#endif  // ENABLE_DECODE_STATS
+  bool _decodeIncremental(decode_results *results, const uint8_t max_skip,
+                          const uint16_t noise_floor);
 #if DECODE_VOLTAS
   bool decodeVoltas(decode_results *results,
                          uint16_t offset = kStartOffset,
@@ -641,13 +967,13 @@ class IRrecv {
                         const uint16_t nbits = kHaierAC176Bits,
                         const bool strict = true);
 #endif  // DECODE_HAIER_AC176
-#if (DECODE_HITACHI_AC || DECODE_HITACHI_AC2 || DECODE_HITACHI_AC264 || \
-     DECODE_HITACHI_AC344)
+#if (DECODE_HITACHI_AC || DECODE_HITACHI_AC1 || DECODE_HITACHI_AC2 || \
+     DECODE_HITACHI_AC264 || DECODE_HITACHI_AC344)
   bool decodeHitachiAC(decode_results *results, uint16_t offset = kStartOffset,
                        const uint16_t nbits = kHitachiAcBits,
                        const bool strict = true, const bool MSBfirst = true);
-#endif  // (DECODE_HITACHI_AC || DECODE_HITACHI_AC2 || DECODE_HITACHI_AC264 ||
-        //  DECODE_HITACHI_AC344)
+#endif  // (DECODE_HITACHI_AC || DECODE_HITACHI_AC1 || DECODE_HITACHI_AC2 ||
+        //  DECODE_HITACHI_AC264 || DECODE_HITACHI_AC344)
 #if DECODE_HITACHI_AC1
   bool decodeHitachiAC1(decode_results *results, uint16_t offset = kStartOffset,
                         const uint16_t nbits = kHitachiAc1Bits,
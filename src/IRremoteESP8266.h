@@ -1011,6 +1011,30 @@
 #define ENABLE_NOISE_FILTER_OPTION true
 #endif  // ENABLE_NOISE_FILTER_OPTION
 
+// Collect per-protocol statistics (attempts, successes, time spent, and where
+// in the capture each decoder gave up) inside `IRrecv::decode()`.
+// Useful for tuning `max_skip`, the tolerance, and which protocols to enable,
+// from real traffic.
+// Note: This costs RAM & cpu time for every decode, so it is off by default.
+//       When disabled, none of it is compiled in.
+//
+// See: `IRrecv::getDecodeStats()` in IRrecv.cpp for more info.
+#ifndef ENABLE_DECODE_STATS
+#define ENABLE_DECODE_STATS false
+#endif  // ENABLE_DECODE_STATS
+
+// Collect timing statistics for what `IRsend` sends. i.e. How far the
+// marks & spaces were from what was asked for, carrier cycles generated vs.
+// expected, & the total airtime. Useful for spotting sends upset by
+// interrupts (e.g. WiFi), & for comparing transmit backends.
+// Note: This costs a little RAM & cpu time for every mark & space, so it is
+//       off by default. When disabled, none of it is compiled in.
+//
+// See: `IRsend::getSendStats()` in IRsend.cpp for more info.
+#ifndef ENABLE_SEND_STATS
+#define ENABLE_SEND_STATS false
+#endif  // ENABLE_SEND_STATS
+
 /// Enumerator for defining and numbering of supported IR protocol.
 /// @note Always add to the end of the list and should never remove entries
 ///  or change order. Projects may save the type number for later usage
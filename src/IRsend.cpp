@@ -5,6 +5,14 @@
 #include "IRsend.h"
 #ifndef UNIT_TEST
 #include <Arduino.h>
+#if defined(ESP8266)
+extern "C" {
+#include <user_interface.h>
+}
+#endif  // ESP8266
+#if defined(ESP32)
+#include <esp_timer.h>
+#endif  // ESP32
 #else
 #define __STDC_LIMIT_MACROS
 #include <stdint.h>
@@ -15,6 +23,11 @@
 #endif
 #include "IRtimer.h"
 
+#ifdef UNIT_TEST
+// The virtual clock. See IRtimer.
+extern uint32_t _IRtimer_unittest_now;
+#endif  // UNIT_TEST
+
 /// Constructor for an IRsend object.
 /// @param[in] IRsendPin Which GPIO pin to use when sending an IR command.
 /// @param[in] inverted Optional flag to invert the output. (default = false)
@@ -81,6 +94,14 @@ uint32_t IRsend::setPinMask(uint32_t ir_pin_mask) {
 }
 #endif
 
+/// Class destructor
+/// Abandons any asynchronous sends, & frees the memory used by them.
+IRsend::~IRsend(void) {
+  _job_count = 0;
+  setSendQueueSize(0);
+  if (_backend != NULL) _backend->_done = NULL;  // It may outlive us.
+}
+
 /// Enable the pin for output.
 void IRsend::begin() {
 #ifndef UNIT_TEST
@@ -94,6 +115,7 @@ void IRsend::begin() {
 
 /// Turn off the IR LED.
 void IRsend::ledOff() {
+  if (_backend != NULL) return;  // The pin is the backend's to look after.
 #ifndef UNIT_TEST
 #if defined(ESP32)
   if (_irPinIsMask)
@@ -154,11 +176,23 @@ void IRsend::enableIROut(uint32_t freq, uint8_t duty) {
 #ifdef UNIT_TEST
   _freq_unittest = freq;
 #endif  // UNIT_TEST
-  uint32_t period = calcUSecPeriod(freq);
+#if ENABLE_SEND_STATS
+  _stats_period = calcUSecPeriod(freq, false);
+#endif  // ENABLE_SEND_STATS
+  // Use the calibration for this carrier, if we have one.
+  const send_calibration_t *calibration = _findCalibration(freq, _dutycycle);
+  uint32_t period = calcUSecPeriod(freq, calibration == NULL);
+  if (calibration != NULL)
+    period = std::max((int32_t)1, (int32_t)period + calibration->offset);
   // Nr. of uSeconds the LED will be on per pulse.
   onTimePeriod = (period * _dutycycle) / kDutyMax;
   // Nr. of uSeconds the LED will be off per pulse.
   offTimePeriod = period - onTimePeriod;
+  if (_render != NULL)
+    _renderEntry(kRenderCarrier, std::min(freq, kRenderFreqMask) |
+                                 (uint32_t)_dutycycle << kRenderDutyShift);
+  else if (_backend != NULL)
+    _backend->carrier(freq, _dutycycle);
 }
 
 #if ALLOW_DELAY_CALLS
@@ -208,6 +242,34 @@ void IRsend::_delayMicroseconds(uint32_t usec) {
 /// Ref:
 ///   https://www.analysir.com/blog/2017/01/29/updated-esp8266-nodemcu-backdoor-upwm-hack-for-ir-signals/
 uint16_t IRsend::mark(uint16_t usec) {
+  if (_render != NULL) {  // Only record it.
+    _renderEntry(kRenderMark, usec);
+    if (!modulation || _dutycycle >= 100) return 1;
+    // The nr. of pulses it would have taken.
+    const uint32_t period = std::max(onTimePeriod + offTimePeriod, 1);
+    return (usec + period - 1) / period;
+  }
+#if ENABLE_SEND_STATS
+  IRtimer usecTimer = IRtimer();
+  const uint16_t pulses = _mark(usec);
+  _noteTiming(usec, usecTimer.elapsed());
+  _stats.cycles += pulses;
+  if (!modulation || _dutycycle >= 100)
+    _stats.expected_cycles++;
+  else
+    _stats.expected_cycles += (usec + _stats_period - 1) / _stats_period;
+  return pulses;
+#else  // ENABLE_SEND_STATS
+  return _mark(usec);
+#endif  // ENABLE_SEND_STATS
+}
+
+/// Send a mark, via the backend or by bit-banging the pin. See mark().
+/// @param[in] usec The period of time to modulate the IR LED for, in
+///  microseconds.
+/// @return Nr. of pulses actually sent.
+uint16_t IRsend::_mark(const uint16_t usec) {
+  if (_backend != NULL) return _backend->mark(usec);
   // Handle the simple case of no required frequency modulation.
   if (!modulation || _dutycycle >= 100) {
     ledOn();
@@ -217,27 +279,30 @@ uint16_t IRsend::mark(uint16_t usec) {
   }
 
   // Not simple, so do it assuming frequency modulation.
+  // Each edge is due at a fixed time from the start of the mark, rather than
+  // from the end of the previous cycle. That way the time spent in the loop
+  // itself doesn't build up over a long mark, or a long message.
   uint16_t counter = 0;
   IRtimer usecTimer = IRtimer();
-  // Cache the time taken so far. This saves us calling time, and we can be
-  // assured that we can't have odd math problems. i.e. unsigned under/overflow.
+  const uint32_t period = onTimePeriod + offTimePeriod;
   uint32_t elapsed = usecTimer.elapsed();
-
-  while (elapsed < usec) {  // Loop until we've met/exceeded our required time.
+  for (uint32_t start = 0; elapsed < usec; start += period) {
+    // Skip any whole cycles we've fallen behind on, rather than rush them.
+    if (elapsed >= start + period) start = elapsed - elapsed % period;
     ledOn();
-    // Calculate how long we should pulse on for.
-    // e.g. Are we to close to the end of our requested mark time (usec)?
-    _delayMicroseconds(std::min(static_cast<uint32_t>(onTimePeriod),
-                                usec - elapsed));
+    // Stay on until this cycle's on time is up, or the mark is.
+    uint32_t due = std::min(start + onTimePeriod, static_cast<uint32_t>(usec));
+    elapsed = usecTimer.elapsed();
+    if (due > elapsed) _delayMicroseconds(due - elapsed);
     ledOff();
     counter++;
-    if (elapsed + onTimePeriod >= usec)
+    if (start + onTimePeriod >= usec)
       return counter;  // LED is now off & we've passed our allotted time.
-    // Wait for the lesser of the rest of the duty cycle, or the time remaining.
-    _delayMicroseconds(
-        std::min(usec - elapsed - onTimePeriod,
-                 static_cast<uint32_t>(offTimePeriod)));
-    elapsed = usecTimer.elapsed();  // Update & recache the actual elapsed time.
+    // Stay off until the next cycle is due, or the mark is over.
+    due = std::min(start + period, static_cast<uint32_t>(usec));
+    elapsed = usecTimer.elapsed();
+    if (due > elapsed) _delayMicroseconds(due - elapsed);
+    elapsed = usecTimer.elapsed();
   }
   return counter;
 }
@@ -247,30 +312,517 @@ uint16_t IRsend::mark(uint16_t usec) {
 /// A space is no output, so the PWM output is disabled.
 /// @param[in] time Time in microseconds (us).
 void IRsend::space(uint32_t time) {
+  if (_render != NULL) {  // Only record it.
+    _renderEntry(kRenderSpace, time);
+    return;
+  }
+#if ENABLE_SEND_STATS
+  IRtimer usecTimer = IRtimer();
+  _space(time);
+  _noteTiming(time, usecTimer.elapsed());
+#else  // ENABLE_SEND_STATS
+  _space(time);
+#endif  // ENABLE_SEND_STATS
+}
+
+/// Send a space, via the backend or by bit-banging the pin. See space().
+/// @param[in] time Time in microseconds (us).
+void IRsend::_space(const uint32_t time) {
+  if (_backend != NULL) {
+    _backend->space(time);
+    return;
+  }
   ledOff();
   if (time == 0) return;
   _delayMicroseconds(time);
 }
 
+/// Render the IR messages into a buffer, rather than send them. i.e. Encode
+/// them now, & emit() them later. All of the send methods work this way once
+/// it is set, as they all go through mark(), space() & enableIROut().
+/// Repeats of a message by sendGeneric() & sendManchester() are copied from
+/// the first one, rather than encoded again.
+/// @param[out] buffer Where to render them to. NULL to send them again.
+///   Each entry is a mark, a space, or a change of carrier. See `kRenderMark`,
+///   `kRenderSpace`, & `kRenderCarrier`. Adjoining spaces are merged.
+/// @param[in] size The nr. of entries the buffer can hold.
+/// @note Setting it starts rendering at the start of the buffer again.
+void IRsend::setRenderBuffer(uint32_t *buffer, const uint16_t size) {
+  _render = buffer;
+  _render_size = (buffer != NULL) ? size : 0;
+  _render_length = 0;
+  _render_overflow = false;
+  _render_usecs = 0;
+}
+
+/// Get how much has been rendered. See setRenderBuffer().
+/// @return The nr. of entries used in the buffer.
+uint16_t IRsend::getRenderLength(void) { return _render_length; }
+
+/// Did we run out of room in the buffer? See setRenderBuffer().
+/// @return true, if some of it is missing. false, if not.
+bool IRsend::getRenderOverflow(void) { return _render_overflow; }
+
+/// Send a pulse train rendered by setRenderBuffer(), as it was rendered.
+/// @param[in] buffer The rendered entries.
+/// @param[in] length The nr. of entries to send.
+/// @note If we are rendering, they are added to what we are rendering.
+void IRsend::emit(const uint32_t buffer[], const uint16_t length) {
+  _emitTrain(buffer, length);
+  ledOff();  // We potentially have ended with a mark(), so turn of the LED.
+}
+
+/// Send part of a rendered pulse train. The backend, if any, gets it in one go.
+/// @param[in] buffer The rendered entries.
+/// @param[in] length The nr. of entries to send.
+void IRsend::_emitTrain(const uint32_t buffer[], const uint16_t length) {
+  if (_render == NULL && _backend != NULL) {
+#if ENABLE_SEND_STATS
+    // It's all handed over in one go, so it can only be timed as a whole.
+    uint32_t requested = 0;
+    for (uint16_t i = 0; i < length; i++)
+      if ((buffer[i] & kRenderTypeMask) != kRenderCarrier)
+        requested += buffer[i] & kRenderValueMask;
+    IRtimer usecTimer = IRtimer();
+    _backend->send(buffer, length);
+    _noteTiming(requested, usecTimer.elapsed());
+#else  // ENABLE_SEND_STATS
+    _backend->send(buffer, length);
+#endif  // ENABLE_SEND_STATS
+  } else {
+    for (uint16_t i = 0; i < length; i++) _emitEntry(buffer[i]);
+  }
+}
+
+/// Send one entry of a rendered pulse train.
+/// @param[in] entry The entry. See setRenderBuffer().
+void IRsend::_emitEntry(const uint32_t entry) {
+  const uint32_t value = entry & kRenderValueMask;
+  switch (entry & kRenderTypeMask) {
+    case kRenderMark:
+      mark(value);
+      break;
+    case kRenderCarrier:
+      enableIROut(value & kRenderFreqMask, value >> kRenderDutyShift);
+      break;
+    default:  // kRenderSpace
+      space(value);
+  }
+}
+
+/// Send a pulse train rendered by `IRsend::setRenderBuffer()`.
+/// By default, one mark(), space(), or carrier() at a time.
+/// @param[in] train The rendered entries.
+/// @param[in] length The nr. of entries to send.
+void IRsendBackend::send(const uint32_t train[], const uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    const uint32_t value = train[i] & kRenderValueMask;
+    switch (train[i] & kRenderTypeMask) {
+      case kRenderMark:
+        mark(value);
+        break;
+      case kRenderCarrier:
+        carrier(value & kRenderFreqMask, value >> kRenderDutyShift);
+        break;
+      default:  // kRenderSpace
+        space(value);
+    }
+  }
+}
+
+/// Start sending part of a pulse train, & return without waiting for it.
+/// sendAsync() uses it, so loop() isn't blocked while the marks go out.
+/// Call finished() once it has all been sent. e.g. From the generator's
+/// end-of-transmission interrupt.
+/// @param[in] train The rendered entries. They stay put until finished().
+/// @param[in] length The nr. of entries to send.
+/// @return true, if it has started. false, if it can't send in the
+///   background, in which case send() is used instead. Which is the default.
+bool IRsendBackend::start(const uint32_t train[], const uint16_t length) {
+  (void)train;
+  (void)length;
+  return false;
+}
+
+/// Tell IRsend that what start() was given has all been sent.
+/// It only sets a flag, so it is safe to call from an interrupt.
+void IRsendBackend::finished(void) {
+  if (_done != NULL) *_done = true;
+}
+
+/// Send everything via a transmit backend, rather than by bit-banging the pin
+/// in software. e.g. A hardware-offloaded generator.
+/// @param[in] backend What to send with. NULL to bit-bang the pin again.
+///   It is owned by the caller, & must outlive its use here.
+/// @note Rendering (see setRenderBuffer()) still takes precedence.
+void IRsend::setBackend(IRsendBackend *backend) {
+  if (_backend != NULL) _backend->_done = NULL;
+  _backend = backend;
+  if (backend == NULL)
+    ledOff();  // The pin is ours again.
+  else
+    backend->_done = &_send_due;  // Its finished() carries on a sendAsync().
+}
+
+/// Get the transmit backend in use. See setBackend().
+/// @return The backend, or NULL if we bit-bang the pin ourselves.
+IRsendBackend *IRsend::getBackend(void) { return _backend; }
+
+#if ENABLE_SEND_STATS
+/// Get the timing statistics for everything sent since resetSendStats().
+/// Call that before a send, to get them for just that message. e.g. Before
+/// sendDaikin312(), rather than per section of it. Compare `max_error` to what
+/// the protocol can tolerate, to flag a send that was upset by interrupts.
+/// e.g. WiFi.
+/// @return A copy of the statistics.
+/// @note A whole pulse train handed to a backend by emit() or sendAsync() is
+///   timed as one. Gaps that sendAsync() leaves to a timer, & what a backend
+///   sends in the background (see IRsendBackend::start()), aren't timed. Nor
+///   is anything while rendering.
+send_stats_t IRsend::getSendStats(void) {
+  send_stats_t stats = _stats;
+  if (stats.timings) stats.mean_error = _stats_error / stats.timings;
+  return stats;
+}
+
+/// Reset the timing statistics back to zero. See getSendStats().
+/// i.e. Start timing a new message.
+void IRsend::resetSendStats(void) {
+  _stats = {};
+  _stats_error = 0;
+}
+
+/// Add a mark or a space to the timing statistics.
+/// @param[in] requested How long it was meant to take. (uSecs)
+/// @param[in] actual How long it actually took. (uSecs)
+void IRsend::_noteTiming(const uint32_t requested, const uint32_t actual) {
+  const uint32_t error = (actual > requested) ? actual - requested
+                                              : requested - actual;
+  _stats.timings++;
+  _stats.max_error = std::max(_stats.max_error, error);
+  _stats_error += error;
+  _stats.requested += requested;
+  _stats.airtime += actual;
+}
+#endif  // ENABLE_SEND_STATS
+
+/// Set how many asynchronous sends can wait to be played back.
+/// See sendAsync().
+/// @param[in] size The nr. of sends. 0 turns asynchronous sending off.
+/// @return true, if it was set. false, if there are sends still waiting, or
+///   we ran out of memory.
+bool IRsend::setSendQueueSize(const uint8_t size) {
+  if (_job_count) return false;  // Don't lose any.
+#ifndef UNIT_TEST
+  if (_send_timer != NULL) {
+#if defined(ESP8266)
+    os_timer_disarm(static_cast<ETSTimer *>(_send_timer));
+    delete static_cast<ETSTimer *>(_send_timer);
+#endif  // ESP8266
+#if defined(ESP32)
+    esp_timer_stop(static_cast<esp_timer_handle_t>(_send_timer));
+    esp_timer_delete(static_cast<esp_timer_handle_t>(_send_timer));
+#endif  // ESP32
+  }
+#endif  // UNIT_TEST
+  _send_timer = NULL;
+  _send_running = false;
+  _send_started = false;
+  _send_due = false;
+  delete[] _jobs;
+  _jobs = NULL;
+  _jobs_size = 0;
+  if (!size) return true;
+  _jobs = new send_job_t[size];
+  if (_jobs == NULL) return false;
+  _jobs_size = size;
+#ifndef UNIT_TEST
+#if defined(ESP8266)
+  ETSTimer *timer = new ETSTimer;
+  if (timer != NULL) {
+    os_timer_disarm(timer);
+    os_timer_setfn(timer, _sendTimer, this);
+  }
+  _send_timer = timer;
+#endif  // ESP8266
+#if defined(ESP32)
+  esp_timer_create_args_t args = {};
+  args.callback = _sendTimer;
+  args.arg = this;
+  args.name = "IRsend";
+  esp_timer_handle_t timer;
+  if (esp_timer_create(&args, &timer) == ESP_OK) _send_timer = timer;
+#endif  // ESP32
+#endif  // UNIT_TEST
+  return true;
+}
+
+/// Get how many asynchronous sends can wait to be played back.
+/// @return The nr. of sends. 0 if asynchronous sending is off.
+uint8_t IRsend::getSendQueueSize(void) { return _jobs_size; }
+
+/// Send a rendered pulse train in the background. i.e. Without blocking.
+/// It is played back by handleSend(), which has to be called from loop(). The
+/// long spaces in it (kSendAsyncMinGap or more) are left to a timer, which is
+/// where the time goes in messages that are repeated, or sent in sections.
+/// Each burst between them (the marks, & the short spaces between those) is
+/// handed to the backend's IRsendBackend::start(), if it can send it in the
+/// background. Then nothing blocks loop().
+/// @warning Otherwise the CPU sends each burst itself. i.e. Bit-banging the
+///   pin with no backend set, or via a backend's blocking send(). Each burst
+///   then blocks the handleSend() call that sends it. e.g. For several hundred
+///   mSecs for a section of sendDaikin312(). Only the gaps between them don't.
+/// @note A gap can end up longer than asked for, if loop() doesn't get to
+///   handleSend() in time.
+/// @param[in] buffer The pulse train. See setRenderBuffer(). It must be left
+///   alone until it has been sent.
+/// @param[in] length The nr. of entries in it.
+/// @param[in] priority Sends with a higher value go first. Those with the
+///   same value go in the order they were queued. The one being sent is never
+///   interrupted.
+/// @param[in] done An optional function to call, with the job's id, once it
+///   has been sent. It is called from handleSend().
+/// @return The id of the job, for getSendStatus(). kNoSendJob if there was no
+///   room in the queue. See setSendQueueSize().
+/// @note Don't use the blocking send methods while it is sending.
+/// @note Only call it from where handleSend() is called. e.g. loop(). The
+///   queue isn't safe to change from an interrupt, or another task.
+uint16_t IRsend::sendAsync(const uint32_t buffer[], const uint16_t length,
+                           const uint8_t priority,
+                           SendDoneCallbackFunction done) {
+  if (_job_count >= _jobs_size) return kNoSendJob;  // It's full.
+  uint8_t pos = _job_count;
+  // Ahead of any with a lower priority, but not the one being sent.
+  while (pos > (_job_active ? 1 : 0) && _jobs[pos - 1].priority < priority) {
+    _jobs[pos] = _jobs[pos - 1];
+    pos--;
+  }
+  _jobs[pos].buffer = buffer;
+  _jobs[pos].length = length;
+  _jobs[pos].id = _job_next_id;
+  _jobs[pos].priority = priority;
+  _jobs[pos].done = done;
+  _job_count++;
+  if (++_job_next_id == kNoSendJob) _job_next_id++;
+  if (!_send_running) {
+    _send_running = true;
+    _send_due = true;  // Start it at the next handleSend().
+  }
+  return _jobs[pos].id;
+}
+
+/// Play back the asynchronous sends, if they are due. See sendAsync().
+/// Call it often from loop(). It only blocks while the CPU sends a burst.
+/// See sendAsync().
+/// @return true, if there are sends yet to finish.
+bool IRsend::handleSend(void) {
+  if (_send_due) {
+    _send_due = false;
+    _serviceSend();
+  }
+  return _job_count > 0;
+}
+
+/// Get how an asynchronous send is going. See sendAsync().
+/// @param[in] job The id of the send.
+/// @return Its status.
+send_status_t IRsend::getSendStatus(const uint16_t job) {
+  for (uint8_t i = 0; i < _job_count; i++)
+    if (_jobs[i].id == job)
+      return (i == 0 && _job_active) ? kSendActive : kSendQueued;
+  return kSendDone;
+}
+
+/// Get how many asynchronous sends have yet to finish.
+/// @return The nr. of sends waiting, including the one being sent.
+uint8_t IRsend::getSendsPending(void) { return _job_count; }
+
+/// Have handleSend() carry on after a while. Without blocking, if we can.
+/// @param[in] usecs How long to wait. (uSecs)
+/// @return true, if a timer will flag it when it is due. false, if the caller
+///   must wait itself.
+bool IRsend::_scheduleSend(const uint32_t usecs) {
+#ifdef UNIT_TEST
+  _send_wake = _IRtimer_unittest_now + usecs;
+  return true;
+#else  // UNIT_TEST
+  if (_send_timer == NULL) return false;
+#if defined(ESP8266)
+  // The timer is in milliSeconds. Never wait less than we were asked.
+  os_timer_arm(static_cast<ETSTimer *>(_send_timer), (usecs + 999) / 1000,
+               false);
+  return true;
+#elif defined(ESP32)
+  return esp_timer_start_once(static_cast<esp_timer_handle_t>(_send_timer),
+                              usecs) == ESP_OK;
+#else  // ESP32
+  return false;
+#endif  // ESP32
+#endif  // UNIT_TEST
+}
+
+/// The timer callback for asynchronous sends. It only flags that the send is
+/// due, so nothing is sent (or waited for) from the timer itself.
+/// @param[in] arg The IRsend object to carry on sending with.
+void IRsend::_sendTimer(void *arg) {
+  static_cast<IRsend *>(arg)->_send_due = true;
+}
+
+/// Is a rendered entry a space long enough to leave to a timer?
+/// @param[in] entry The entry. See setRenderBuffer().
+/// @return true, if it is. false, if not.
+static bool isAsyncGap(const uint32_t entry) {
+  return (entry & kRenderTypeMask) == kRenderSpace &&
+         (entry & kRenderValueMask) >= kSendAsyncMinGap;
+}
+
+/// Play back the asynchronous sends, until we get to a long space, hand a
+/// burst to the backend to send in the background, or run out.
+void IRsend::_serviceSend(void) {
+  _send_started = false;
+  while (_job_count) {
+    _job_active = true;
+    const uint32_t *buffer = _jobs[0].buffer;
+    while (_job_pos < _jobs[0].length) {
+      if (isAsyncGap(buffer[_job_pos])) {
+        const uint32_t gap = buffer[_job_pos++] & kRenderValueMask;
+        ledOff();
+        // Let everything else run until it is over.
+        if (_scheduleSend(gap)) return;
+        space(gap);
+        continue;
+      }
+      // Send everything up to the next long gap in one go.
+      const uint16_t start = _job_pos;
+      while (_job_pos < _jobs[0].length && !isAsyncGap(buffer[_job_pos]))
+        _job_pos++;
+      if (_render == NULL && _backend != NULL &&
+          _backend->start(buffer + start, _job_pos - start)) {
+        _send_started = true;
+        return;  // Its finished() will have handleSend() carry on.
+      }
+      _emitTrain(buffer + start, _job_pos - start);
+    }
+    ledOff();  // We potentially have ended with a mark().
+    // It's finished. Take it out of the queue before telling anyone.
+    const uint16_t id = _jobs[0].id;
+    SendDoneCallbackFunction done = _jobs[0].done;
+    for (uint8_t i = 1; i < _job_count; i++) _jobs[i - 1] = _jobs[i];
+    _jobs[--_job_count].done = nullptr;
+    _job_pos = 0;
+    _job_active = false;
+    if (done) done(id);
+  }
+  _send_running = false;
+}
+
+#ifdef UNIT_TEST
+/// Let time pass on the virtual clock, playing back any asynchronous sends
+/// that fall due. i.e. The host's stand-in for the timer, & a loop() that
+/// calls handleSend().
+/// The time spent waiting for the timer is recorded as a space, like
+/// the blocking send methods would have.
+/// @param[in] usecs How long to let pass. (uSecs)
+void IRsend::_advanceAsync(const uint32_t usecs) {
+  const uint32_t until = _IRtimer_unittest_now + usecs;
+  while (_send_running) {
+    if (!_send_due) {
+      if (_send_started) break;  // Waiting for the backend's finished().
+      // Waiting for the timer.
+      const uint32_t wake = std::min(_send_wake, until);
+      if (wake > _IRtimer_unittest_now) space(wake - _IRtimer_unittest_now);
+      if (_IRtimer_unittest_now < wake) _IRtimer_unittest_now = wake;
+      if (_send_wake > until) break;
+      _send_due = true;  // It fires.
+    }
+    handleSend();
+  }
+  if (_IRtimer_unittest_now < until) _IRtimer_unittest_now = until;
+}
+#endif  // UNIT_TEST
+
+/// Add an entry to the rendered pulse train.
+/// Adjoining marks or spaces are merged, & a change of carrier replaces one
+/// that nothing has been sent with yet.
+/// @param[in] type The kind of entry. e.g. kRenderMark
+/// @param[in] value Its duration (uSecs), or the carrier's settings.
+void IRsend::_renderEntry(const uint32_t type, uint32_t value) {
+  if (type != kRenderCarrier && !value) return;  // Nothing to add.
+  if (type != kRenderCarrier) _render_usecs += value;
+  if (_render_length) {
+    uint32_t *last = &_render[_render_length - 1];
+    if ((*last & kRenderTypeMask) == type) {
+      if (type == kRenderCarrier) {
+        *last = type | value;
+        return;
+      }
+      // A mark must still fit mark()'s argument.
+      const uint32_t max = (type == kRenderMark) ? UINT16_MAX
+                                                 : kRenderValueMask;
+      const uint32_t room = max - (*last & kRenderValueMask);
+      const uint32_t add = std::min(room, value);
+      *last += add;
+      value -= add;
+      if (!value) return;
+    }
+  }
+  while (true) {
+    if (_render_length >= _render_size) {
+      _render_overflow = true;
+      return;
+    }
+    const uint32_t max = (type == kRenderMark) ? UINT16_MAX : kRenderValueMask;
+    const uint32_t add = (type == kRenderCarrier) ? value
+                                                  : std::min(max, value);
+    _render[_render_length++] = type | add;
+    if (type == kRenderCarrier || add == value) return;
+    value -= add;
+  }
+}
+
+/// Render another copy of some of what has already been rendered.
+/// @param[in] start The first entry to copy.
+/// @param[in] length The nr. of entries to copy.
+/// @return true, if it was copied. false, if we aren't rendering, or it
+///   doesn't start with a mark. i.e. It might not copy exactly.
+bool IRsend::_renderCopy(const uint16_t start, const uint16_t length) {
+  if (_render == NULL || !length ||
+      (_render[start] & kRenderTypeMask) != kRenderMark)
+    return false;
+  for (uint16_t i = start; i < start + length; i++)
+    _renderEntry(_render[i] & kRenderTypeMask, _render[i] & kRenderValueMask);
+  return true;
+}
+
 /// Calculate & set any offsets to account for execution times during sending.
 ///
 /// @param[in] hz The frequency to calibrate at >= 1000Hz. Default is 38000Hz.
+/// @param[in] duty The duty cycle to calibrate at. (Percent)
 /// @return The calculated period offset (in uSeconds) which is now in use.
 ///  e.g. -5.
 /// @note This will generate an 65535us mark() IR LED signal.
-///  This only needs to be called once, if at all.
-int8_t IRsend::calibrate(uint16_t hz) {
+///  This only needs to be called once per carrier, if at all.
+///  The result is kept in the table given to setCalibrations(), if there is
+///  room in it, or else used for every carrier that isn't in it.
+int8_t IRsend::calibrate(uint16_t hz, uint8_t duty) {
   if (hz < 1000)  // Were we given kHz? Supports the old call usage.
     hz *= 1000;
-  periodOffset = 0;  // Turn off any existing offset while we calibrate.
-  enableIROut(hz);
+  duty = modulation ? std::min(duty, kDutyMax) : kDutyMax;
+  send_calibration_t *calibration = _findCalibration(hz, duty, true);
+  // Turn off any existing offset while we calibrate.
+  if (calibration != NULL)
+    calibration->offset = 0;
+  else
+    periodOffset = 0;
+  enableIROut(hz, duty);
   IRtimer usecTimer = IRtimer();  // Start a timer *just* before we do the call.
   uint16_t pulses = mark(UINT16_MAX);  // Generate a PWM of 65,535 us. (Max.)
   uint32_t timeTaken = usecTimer.elapsed();  // Record the time it took.
   // While it shouldn't be necessary, assume at least 1 pulse, to avoid a
   // divide by 0 situation.
   pulses = std::max(pulses, static_cast<uint16_t>(1U));
-  uint32_t calcPeriod = calcUSecPeriod(hz);  // e.g. @38kHz it should be 26us.
+  // e.g. @38kHz it should be 26us.
+  uint32_t calcPeriod = calcUSecPeriod(hz, false);
   // Assuming 38kHz for the example calculations:
   // In a 65535us pulse, we should have 2520.5769 pulses @ 26us periods.
   // e.g. 65535.0us / 26us = 2520.5769
@@ -283,8 +835,48 @@ int8_t IRsend::calibrate(uint16_t hz) {
   // generated.
   double_t actualPeriod = (double_t)timeTaken / (double_t)pulses;
   // Store the difference between the actual time per period vs. calculated.
-  periodOffset = (int8_t)((double_t)calcPeriod - actualPeriod);
-  return periodOffset;
+  const int8_t offset = (int8_t)((double_t)calcPeriod - actualPeriod);
+  if (calibration != NULL)
+    calibration->offset = offset;
+  else
+    periodOffset = offset;
+  return offset;
+}
+
+/// Use a table of per-carrier calibrations. e.g. One calibrate() filled in
+/// earlier & saved, so we don't need to generate its long marks again at boot.
+/// @param[in,out] table The calibrations. calibrate() adds to & updates it.
+///   It is owned by the caller, & must outlive its use here. NULL for none.
+/// @param[in] size The nr. of entries it can hold. Unused ones have a freq of
+///   0.
+/// @note Carriers that aren't in it use the offset from calibrate() when it
+///   had no table, or the default, as before.
+void IRsend::setCalibrations(send_calibration_t table[], const uint8_t size) {
+  _calibrations = table;
+  _calibrations_size = (table != NULL) ? size : 0;
+}
+
+/// Find the calibration for a carrier. See setCalibrations().
+/// @param[in] freq The carrier frequency. (Hz)
+/// @param[in] duty Its duty cycle. (Percent)
+/// @param[in] add Use an unused entry for it, if it isn't there already?
+/// @return The entry, or NULL if there isn't one.
+send_calibration_t *IRsend::_findCalibration(const uint32_t freq,
+                                             const uint8_t duty,
+                                             const bool add) {
+  if (freq == 0) return NULL;  // That's what an unused entry looks like.
+  send_calibration_t *unused = NULL;
+  for (uint8_t i = 0; i < _calibrations_size; i++) {
+    if (_calibrations[i].freq == freq && _calibrations[i].duty == duty)
+      return &_calibrations[i];
+    if (unused == NULL && _calibrations[i].freq == 0)
+      unused = &_calibrations[i];
+  }
+  if (!add || unused == NULL) return NULL;
+  unused->freq = freq;
+  unused->duty = duty;
+  unused->offset = 0;
+  return unused;
 }
 
 /// Generic method for sending data that is common to most protocols.
@@ -412,11 +1004,16 @@ void IRsend::sendGeneric(const uint16_t headermark, const uint32_t headerspace,
   // Setup
   enableIROut(frequency, dutycycle);
   IRtimer usecs = IRtimer();
+  const uint16_t first = _render_length;  // Where the message is rendered.
+  uint16_t rendered = 0;  // The nr. of entries it took.
 
   // We always send a message, even for repeat=0, hence '<= repeat'.
   for (uint16_t r = 0; r <= repeat
        || (repeat > 0 && _repeatCB && _repeatCB()); r++) {
+    // It renders the same every time. So copy it, rather than encode it.
+    if (_renderCopy(first, rendered)) continue;
     usecs.reset();
+    const uint32_t start = _render_usecs;
 
     // Header
     if (headermark) mark(headermark);
@@ -427,12 +1024,14 @@ void IRsend::sendGeneric(const uint16_t headermark, const uint32_t headerspace,
 
     // Footer
     if (footermark) mark(footermark);
-    uint32_t elapsed = usecs.elapsed();
+    uint32_t elapsed = (_render != NULL) ? _render_usecs - start
+                                         : usecs.elapsed();
     // Avoid potential unsigned integer underflow. e.g. when mesgtime is 0.
     if (elapsed >= mesgtime)
       space(gap);
     else
       space(std::max(gap, mesgtime - elapsed));
+    if (_render != NULL) rendered = _render_length - first;
   }
 }
 
@@ -471,9 +1070,13 @@ void IRsend::sendGeneric(const uint16_t headermark, const uint32_t headerspace,
                          const uint16_t repeat, const uint8_t dutycycle) {
   // Setup
   enableIROut(frequency, dutycycle);
+  const uint16_t first = _render_length;  // Where the message is rendered.
+  uint16_t rendered = 0;  // The nr. of entries it took.
   // We always send a message, even for repeat=0, hence '<= repeat'.
   for (uint16_t r = 0; r <= repeat
        || (repeat > 0 && _repeatCB && _repeatCB()); r++) {
+    // It renders the same every time. So copy it, rather than encode it.
+    if (_renderCopy(first, rendered)) continue;
     // Header
     if (headermark) mark(headermark);
     if (headerspace) space(headerspace);
@@ -486,6 +1089,7 @@ void IRsend::sendGeneric(const uint16_t headermark, const uint32_t headerspace,
     // Footer
     if (footermark) mark(footermark);
     space(gap);
+    if (_render != NULL) rendered = _render_length - first;
   }
 }
 
@@ -570,9 +1174,13 @@ void IRsend::sendManchester(const uint16_t headermark,
                             const bool GEThomas) {
   // Setup
   enableIROut(frequency, dutycycle);
+  const uint16_t first = _render_length;  // Where the message is rendered.
+  uint16_t rendered = 0;  // The nr. of entries it took.
 
   // We always send a message, even for repeat=0, hence '<= repeat'.
   for (uint16_t r = 0; r <= repeat; r++) {
+    // It renders the same every time. So copy it, rather than encode it.
+    if (_renderCopy(first, rendered)) continue;
     // Header
     if (headermark) mark(headermark);
     if (headerspace) space(headerspace);
@@ -581,6 +1189,7 @@ void IRsend::sendManchester(const uint16_t headermark,
     // Footer
     if (footermark) mark(footermark);
     if (gap) space(gap);
+    if (_render != NULL) rendered = _render_length - first;
   }
 }
 
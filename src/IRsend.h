@@ -22,17 +22,10 @@
 // Constants
 // Offset (in microseconds) to use in Period time calculations to account for
 // code excution time in producing the software PWM signal.
-#if defined(ESP32)
-// Calculated on a generic ESP-WROOM-32 board with v3.2-18 SDK @ 240MHz
-const int8_t kPeriodOffset = -2;
-#elif (defined(ESP8266) && F_CPU == 160000000L)  // NOLINT(whitespace/parens)
-// Calculated on an ESP8266 NodeMCU v2 board using:
-// v2.6.0 with v2.5.2 ESP core @ 160MHz
-const int8_t kPeriodOffset = -2;
-#else  // (defined(ESP8266) && F_CPU == 160000000L)
-// Calculated on ESP8266 Wemos D1 mini using v2.4.1 with v2.4.0 ESP core @ 40MHz
-const int8_t kPeriodOffset = -5;
-#endif  // (defined(ESP8266) && F_CPU == 160000000L)
+// mark() times each carrier cycle from the start of the mark, so the time the
+// code takes is absorbed within each cycle rather than added to it. Hence no
+// offset is needed by default. Use calibrate() if a board still needs one.
+const int8_t kPeriodOffset = 0;
 const uint8_t kDutyDefault = 50;  // Percentage
 const uint8_t kDutyMax = 100;     // Percentage
 // delayMicroseconds() is only accurate to 16383us.
@@ -40,12 +33,99 @@ const uint8_t kDutyMax = 100;     // Percentage
 const uint16_t kMaxAccurateUsecDelay = 16383;
 //  Usecs to wait between messages we don't know the proper gap time.
 const uint32_t kDefaultMessageGap = 100000;
+// Rendered pulse trains. See IRsend::setRenderBuffer().
+// Each entry is a uint32_t. The top two bits say what kind of entry it is.
+const uint32_t kRenderTypeMask = 0xC0000000;
+const uint32_t kRenderSpace = 0x00000000;  // Off for the rest (uSecs).
+const uint32_t kRenderMark = 0x40000000;  // Modulated for the rest (uSecs).
+// Carrier frequency (Hz) in the bits of kRenderFreqMask, & its duty cycle
+// (percent) in the bits above them.
+const uint32_t kRenderCarrier = 0x80000000;
+const uint32_t kRenderValueMask = ~kRenderTypeMask;
+const uint32_t kRenderFreqMask = 0x007FFFFF;
+const uint8_t kRenderDutyShift = 23;
+// Spaces (uSecs) at least this long are waited out with a timer while
+// playing back a sendAsync(), rather than by busy-waiting.
+const uint32_t kSendAsyncMinGap = 5000;
+// What sendAsync() returns when it can't queue a send.
+const uint16_t kNoSendJob = 0;
 /// Placeholder for missing sensor temp value
 /// @note Not using "-1" as it may be a valid external temp
 const float kNoTempValue = -100.0;
 
 // Callback function for adjusting IR repeats wile sending an IR code
 typedef std::function<bool()> RepeatCallbackFunction;
+// Callback function for when an asynchronous send has finished.
+typedef std::function<void(const uint16_t job)> SendDoneCallbackFunction;
+
+/// The state of an asynchronous send. See `IRsend::getSendStatus()`.
+enum send_status_t {
+  kSendQueued = 0,  ///< (0) Waiting for the sends before it.
+  kSendActive,      ///< (1) Being sent.
+  kSendDone,        ///< (2) Finished, or was never queued.
+};
+
+/// An asynchronous send, waiting to be played back. See `IRsend::sendAsync()`.
+typedef struct {
+  const uint32_t *buffer;  // The rendered pulse train. Owned by the caller.
+  uint16_t length;  // Nr. of entries in it.
+  uint16_t id;  // What sendAsync() returned for it.
+  uint8_t priority;  // Higher goes first.
+  SendDoneCallbackFunction done;  // Called once it has been sent, if set.
+} send_job_t;
+
+/// The transmit calibration for one carrier. See `IRsend::setCalibrations()`.
+/// It is plain data, so a table of them can be saved (e.g. to EEPROM) once
+/// calibrate() has filled it in, & handed back at boot.
+typedef struct {
+  uint32_t freq;  // The carrier frequency. (Hz) 0 if the entry is unused.
+  uint8_t duty;  // Its duty cycle. (Percent)
+  int8_t offset;  // How much to adjust its period by. (uSecs)
+} send_calibration_t;
+
+#if ENABLE_SEND_STATS
+/// Timing statistics for what has been sent since they were last reset.
+/// See `IRsend::getSendStats()`.
+typedef struct {
+  uint16_t timings;  // Nr. of marks & spaces (or whole trains) timed.
+  uint32_t max_error;  // Largest difference from the time asked for. (uSecs)
+  uint32_t mean_error;  // Average difference from the time asked for. (uSecs)
+  uint32_t cycles;  // Nr. of carrier cycles generated.
+  uint32_t expected_cycles;  // Nr. of carrier cycles there should have been.
+  uint32_t requested;  // Total time asked for. (uSecs)
+  uint32_t airtime;  // Total time actually taken. (uSecs)
+} send_stats_t;
+#endif  // ENABLE_SEND_STATS
+
+/// Where IRsend's pulse trains end up. i.e. What actually generates the IR
+/// signal. See `IRsend::setBackend()`. IRsend bit-bangs the pin in software
+/// itself when none is set.
+/// A hardware-offloaded generator (e.g. ESP32's RMT, or the ESP8266 UART-TX
+/// hack) can override `send()` to take a whole pulse train at once.
+class IRsendBackend {
+ public:
+  virtual ~IRsendBackend(void) {}
+  /// Change the carrier for the marks that follow.
+  /// @param[in] freq The frequency to modulate at. (Hz)
+  /// @param[in] duty The duty cycle. (Percent) 100 means no modulation.
+  virtual void carrier(const uint32_t freq, const uint8_t duty) = 0;
+  /// Send a mark. i.e. The modulated carrier.
+  /// @param[in] usecs How long for. (uSecs)
+  /// @return Nr. of carrier pulses sent.
+  virtual uint16_t mark(const uint16_t usecs) = 0;
+  /// Send a space. i.e. No output.
+  /// @param[in] usecs How long for. (uSecs)
+  virtual void space(const uint32_t usecs) = 0;
+  virtual void send(const uint32_t train[], const uint16_t length);
+  virtual bool start(const uint32_t train[], const uint16_t length);
+
+ protected:
+  void finished(void);
+
+ private:
+  friend class IRsend;
+  volatile bool *_done = NULL;  // Flagged by finished(). NULL if unused.
+};
 
 /// Enumerators and Structures for the Common A/C API.
 namespace stdAc {
@@ -253,12 +333,35 @@ class IRsend {
   explicit IRsend(bool use_modulation, uint32_t ir_pin_mask);
   uint32_t setPinMask(uint32_t ir_pin_mask);
 #endif
+  ~IRsend(void);
   void begin();
   void enableIROut(uint32_t freq, uint8_t duty = kDutyDefault);
   VIRTUAL void _delayMicroseconds(uint32_t usec);
   VIRTUAL uint16_t mark(uint16_t usec);
   VIRTUAL void space(uint32_t usec);
-  int8_t calibrate(uint16_t hz = 38000U);
+  int8_t calibrate(uint16_t hz = 38000U, uint8_t duty = kDutyDefault);
+  void setCalibrations(send_calibration_t table[], const uint8_t size);
+#if ENABLE_SEND_STATS
+  send_stats_t getSendStats(void);
+  void resetSendStats(void);
+#endif  // ENABLE_SEND_STATS
+  void setRenderBuffer(uint32_t *buffer, const uint16_t size);
+  uint16_t getRenderLength(void);
+  bool getRenderOverflow(void);
+  void emit(const uint32_t buffer[], const uint16_t length);
+  void setBackend(IRsendBackend *backend);
+  IRsendBackend *getBackend(void);
+  bool setSendQueueSize(const uint8_t size);
+  uint8_t getSendQueueSize(void);
+  uint16_t sendAsync(const uint32_t buffer[], const uint16_t length,
+                     const uint8_t priority = 0,
+                     SendDoneCallbackFunction done = nullptr);
+  bool handleSend(void);
+  send_status_t getSendStatus(const uint16_t job);
+  uint8_t getSendsPending(void);
+#ifdef UNIT_TEST
+  void _advanceAsync(const uint32_t usecs);
+#endif  // UNIT_TEST
   void sendRaw(const uint16_t buf[], const uint16_t len, const uint16_t hz);
   void sendData(uint16_t onemark, uint32_t onespace, uint16_t zeromark,
                 uint32_t zerospace, uint64_t data, uint16_t nbits,
@@ -938,7 +1041,7 @@ class IRsend {
 
  private:
 #else
-  uint32_t _freq_unittest;
+  uint32_t _freq_unittest = 0;  // No carrier set yet.
 #endif  // UNIT_TEST
   uint16_t onTimePeriod;
   uint16_t offTimePeriod;
@@ -947,6 +1050,44 @@ class IRsend {
   uint8_t _dutycycle;
   bool modulation;
   uint32_t calcUSecPeriod(uint32_t hz, bool use_offset = true);
+  send_calibration_t *_calibrations = NULL;  // Owned by the caller.
+  uint8_t _calibrations_size = 0;  // Nr. of entries in _calibrations.
+  send_calibration_t *_findCalibration(const uint32_t freq, const uint8_t duty,
+                                       const bool add = false);
+  uint16_t _mark(const uint16_t usec);
+  void _space(const uint32_t time);
+#if ENABLE_SEND_STATS
+  send_stats_t _stats = {};
+  uint64_t _stats_error = 0;  // Total difference from the time asked for.
+  uint32_t _stats_period = 1;  // The carrier's intended period. (uSecs)
+  void _noteTiming(const uint32_t requested, const uint32_t actual);
+#endif  // ENABLE_SEND_STATS
+  uint32_t *_render = NULL;  // Where to render to. NULL if sending.
+  uint16_t _render_size = 0;  // Nr. of entries _render can hold.
+  uint16_t _render_length = 0;  // Nr. of entries rendered so far.
+  bool _render_overflow = false;  // Did we run out of room?
+  uint32_t _render_usecs = 0;  // Total duration rendered so far.
+  void _renderEntry(const uint32_t type, uint32_t value);
+  bool _renderCopy(const uint16_t start, const uint16_t length);
+  void _emitEntry(const uint32_t entry);
+  void _emitTrain(const uint32_t buffer[], const uint16_t length);
+  IRsendBackend *_backend = NULL;  // What sends for us. NULL if we do.
+  send_job_t *_jobs = NULL;  // Sends to play back. The first one is next.
+  uint8_t _jobs_size = 0;  // Nr. of sends _jobs can hold.
+  uint8_t _job_count = 0;  // Nr. of sends in _jobs.
+  uint16_t _job_pos = 0;  // Nr. of entries of the first one played so far.
+  uint16_t _job_next_id = kNoSendJob + 1;
+  bool _job_active = false;  // Has the first one started?
+  bool _send_running = false;  // Is playback in progress, or scheduled?
+  bool _send_started = false;  // Is the backend sending part in the background?
+  volatile bool _send_due = false;  // Should handleSend() carry on with it?
+  void *_send_timer = NULL;  // The platform's timer for it. NULL if none.
+#ifdef UNIT_TEST
+  uint32_t _send_wake = 0;  // When the virtual clock is due to play it.
+#endif  // UNIT_TEST
+  bool _scheduleSend(const uint32_t usecs);
+  static void _sendTimer(void *arg);
+  void _serviceSend(void);
 #if SEND_SONY
   void _sendSony(const uint64_t data, const uint16_t nbits,
                  const uint16_t repeat, const uint16_t freq);
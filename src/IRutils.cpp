@@ -441,6 +441,117 @@ uint16_t* resultToRawArray(const decode_results * const decode) {
   return result;
 }
 
+/// Return the nr. of bytes a capture takes in the compact capture format.
+/// @param[in] results A ptr to a decode_results structure.
+/// @return The nr. of bytes.
+/// @see IRrecv::setCompactCapture()
+uint16_t getCompactLength(const decode_results * const results) {
+  uint16_t length = 0;
+  uint8_t entry[3];
+  for (uint16_t i = 0; i < results->rawlen; i++)
+    length += _IRrecv::storeCompact(entry, sizeof(entry), 0,
+                                    results->rawbuf[i]);
+  return length;
+}
+
+/// Convert a capture into the compact capture format.
+/// i.e. What IRrecv::setCompactCapture() would have captured it as.
+/// @param[in] results A ptr to a decode_results structure.
+/// @param[out] compact Where to store it.
+/// @param[in] size Nr. of bytes `compact` can hold. See getCompactLength().
+/// @return The nr. of bytes used. 0 if it didn't fit.
+uint16_t resultToCompact(const decode_results * const results,
+                         uint8_t * const compact, const uint16_t size) {
+  uint16_t pos = 0;
+  for (uint16_t i = 0; i < results->rawlen; i++) {
+    const uint8_t used = _IRrecv::storeCompact(compact, size, pos,
+                                               results->rawbuf[i]);
+    if (!used) return 0;
+    pos += used;
+  }
+  return pos;
+}
+
+/// Convert a capture in the compact capture format into a decode_results.
+/// @param[in] compact The compact capture.
+/// @param[in] size Nr. of bytes in `compact`.
+/// @param[out] results A ptr to a decode_results structure. Its `rawbuf` must
+///   already point to a buffer with room for `bufsize` entries.
+/// @param[in] bufsize Nr. of entries `results->rawbuf` can hold.
+/// @return The nr. of entries. i.e. `results->rawlen`.
+uint16_t compactToResult(const uint8_t * const compact, const uint16_t size,
+                         decode_results * const results,
+                         const uint16_t bufsize) {
+  uint16_t used;
+  results->rawlen = _IRrecv::expandCompact(compact, size, results->rawbuf,
+                                           bufsize, &used);
+  results->overflow = used < size;
+  return results->rawlen;
+}
+
+/// Return a String containing a capture in the compact capture format,
+/// in a C/C++ code style format. Typically about half the size of
+/// resultToSourceCode()'s `rawData[]`. Use compactToRawArray() to send it.
+/// @param[in] results A ptr to a decode_results structure.
+/// @return A String containing the code-ified result.
+String resultToCompactSourceCode(const decode_results * const results) {
+  String output = "";
+  const uint16_t length = getCompactLength(results);
+  // Reserve some space for the string to reduce heap fragmentation.
+  // "uint8_t compactData[9999] = {};  // LONGEST_PROTOCOL DEADBEEFDEADBEEF\n"
+  //   = ~75 chars.
+  // "0xNN, " = 6 chars per byte.
+  output.reserve(75 + length * 6);
+  output += F("uint8_t compactData[");
+  output += uint64ToString(length, 10);
+  output += F("] = {");
+  uint8_t entry[3];
+  for (uint16_t i = 0; i < results->rawlen; i++) {
+    const uint8_t used = _IRrecv::storeCompact(entry, sizeof(entry), 0,
+                                               results->rawbuf[i]);
+    for (uint8_t j = 0; j < used; j++) {
+      if (i || j) output += kCommaSpaceStr;
+      output += F("0x");
+      if (entry[j] < 0x10) output += '0';
+      output += uint64ToString(entry[j], 16);
+    }
+  }
+  output += F("};  // ");
+  output += typeToString(results->decode_type, results->repeat);
+  // Only display the value if the decode type doesn't have an A/C state.
+  if (!hasACState(results->decode_type))
+    output += ' ' + uint64ToString(results->value, 16);
+  output += '\n';
+  return output;
+}
+
+/// Convert a capture in the compact capture format into an array suitable
+/// for `sendRaw()`.
+/// @param[in] compact The compact capture.
+/// @param[in] size Nr. of bytes in `compact`.
+/// @param[out] length The nr. of entries in the returned array.
+/// @return A PTR to a dynamically allocated uint16_t sendRaw compatible array.
+///   NULL if it is empty, or we ran out of memory.
+/// @note The returned array needs to be delete[]'ed/free()'ed (deallocated)
+///  after use by caller.
+uint16_t *compactToRawArray(const uint8_t * const compact, const uint16_t size,
+                            uint16_t * const length) {
+  *length = 0;
+  decode_results capture;
+  // There can't be more entries than bytes.
+  capture.rawbuf = new uint16_t[size];
+  if (capture.rawbuf == NULL) return NULL;
+  compactToResult(compact, size, &capture, size);
+  uint16_t *result = NULL;
+  if (capture.rawlen > 1) {  // i.e. More than the gap before the message.
+    *length = getCorrectedRawLength(&capture);
+    result = resultToRawArray(&capture);
+    if (result == NULL) *length = 0;
+  }
+  delete[] capture.rawbuf;
+  return result;
+}
+
 /// Sum all the bytes of an array and return the least significant 8-bits of
 /// the result.
 /// @param[in] start A ptr to the start of the byte array to calculate over.
@@ -31,6 +31,15 @@ String resultToHexidecimal(const decode_results * const result);
 bool hasACState(const decode_type_t protocol);
 uint16_t getCorrectedRawLength(const decode_results * const results);
 uint16_t *resultToRawArray(const decode_results * const decode);
+uint16_t getCompactLength(const decode_results * const results);
+uint16_t resultToCompact(const decode_results * const results,
+                         uint8_t * const compact, const uint16_t size);
+uint16_t compactToResult(const uint8_t * const compact, const uint16_t size,
+                         decode_results * const results,
+                         const uint16_t bufsize);
+String resultToCompactSourceCode(const decode_results * const results);
+uint16_t *compactToRawArray(const uint8_t * const compact, const uint16_t size,
+                            uint16_t * const length);
 uint8_t sumBytes(const uint8_t * const start, const uint16_t length,
                  const uint8_t init = 0);
 uint8_t xorBytes(const uint8_t * const start, const uint16_t length,
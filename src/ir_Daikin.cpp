@@ -3927,3 +3927,61 @@ bool IRrecv::decodeDaikin312(decode_results *results, uint16_t offset,
   return true;
 }
 #endif  // DECODE_DAIKIN312
+
+namespace _IRrecv {  // Namespace extension
+/// The Daikin protocols segmented decoding can assemble from separate captures.
+/// Only those sent as sections with gaps between them can be split up.
+/// @see IRrecv::setSegmentedDecode()
+const segmented_t kSegmented[] = {
+#if DECODE_DAIKIN
+    {DAIKIN, kDaikinBits, kDaikinTolerance, kDaikinMarkExcess,
+     kDaikinBitMark, kDaikinOneSpace, kDaikinZeroSpace, 4,
+     {{0, 0, kDaikinHeaderLength, false, kDaikinZeroSpace + kDaikinGap},
+      {kDaikinHdrMark, kDaikinHdrSpace, kDaikinSection1Length * 8, true,
+       kDaikinZeroSpace + kDaikinGap},
+      {kDaikinHdrMark, kDaikinHdrSpace, kDaikinSection2Length * 8, true,
+       kDaikinZeroSpace + kDaikinGap},
+      {kDaikinHdrMark, kDaikinHdrSpace, kDaikinSection3Length * 8, true, 0}},
+     IRDaikinESP::validChecksum},
+#endif  // DECODE_DAIKIN
+#if DECODE_DAIKIN160
+    {DAIKIN160, kDaikin160Bits, kDaikinTolerance, kDaikinMarkExcess,
+     kDaikin160BitMark, kDaikin160OneSpace, kDaikin160ZeroSpace, 2,
+     {{kDaikin160HdrMark, kDaikin160HdrSpace, kDaikin160Section1Length * 8,
+       true, kDaikin160Gap},
+      {kDaikin160HdrMark, kDaikin160HdrSpace, kDaikin160Section2Length * 8,
+       true, 0}},
+     IRDaikin160::validChecksum},
+#endif  // DECODE_DAIKIN160
+#if DECODE_DAIKIN176
+    {DAIKIN176, kDaikin176Bits, kDaikinTolerance, kDaikinMarkExcess,
+     kDaikin176BitMark, kDaikin176OneSpace, kDaikin176ZeroSpace, 2,
+     {{kDaikin176HdrMark, kDaikin176HdrSpace, kDaikin176Section1Length * 8,
+       true, kDaikin176Gap},
+      {kDaikin176HdrMark, kDaikin176HdrSpace, kDaikin176Section2Length * 8,
+       true, 0}},
+     IRDaikin176::validChecksum},
+#endif  // DECODE_DAIKIN176
+#if DECODE_DAIKIN216
+    {DAIKIN216, kDaikin216Bits, kDaikinTolerance, kDaikinMarkExcess,
+     kDaikin216BitMark, kDaikin216OneSpace, kDaikin216ZeroSpace, 2,
+     {{kDaikin216HdrMark, kDaikin216HdrSpace, kDaikin216Section1Length * 8,
+       true, kDaikin216Gap},
+      {kDaikin216HdrMark, kDaikin216HdrSpace, kDaikin216Section2Length * 8,
+       true, 0}},
+     IRDaikin216::validChecksum},
+#endif  // DECODE_DAIKIN216
+#if DECODE_DAIKIN312
+    {DAIKIN312, kDaikin312Bits, kDaikinTolerance, 0,
+     kDaikin312BitMark, kDaikin312OneSpace, kDaikin312ZeroSpace, 3,
+     {{0, 0, kDaikinHeaderLength, false, kDaikin312HdrGap},
+      {kDaikin312HdrMark, kDaikin312HdrSpace, kDaikin312Section1Length * 8,
+       true, kDaikin312SectionGap},
+      {kDaikin312HdrMark, kDaikin312HdrSpace, kDaikin312Section2Length * 8,
+       true, 0}},
+     NULL},
+#endif  // DECODE_DAIKIN312
+    // End of list marker. Must be last.
+    {UNUSED, 0, 0, 0, 0, 0, 0, 0, {}, NULL}
+};
+}  // namespace _IRrecv
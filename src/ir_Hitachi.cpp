@@ -846,9 +846,11 @@ String IRHitachiAc1::toString(void) const {
 /// @param[in] nbits The number of data bits to expect.
 ///   Typically kHitachiAcBits, kHitachiAc1Bits, kHitachiAc2Bits,
 ///   kHitachiAc344Bits, kHitachiAc264Bits
+///   0 means any of them (that are enabled), longest first, but only those the
+///   capture has a gap (or ends) after.
 /// @param[in] strict Flag indicating if we should perform strict matching.
 /// @param[in] MSBfirst Is the data per byte stored in MSB First (true) or
-///   LSB First order(false)?
+///   LSB First order(false)? Ignored if `nbits` is 0, as each size has its own.
 /// @return True if it can decode it, false if it can't.
 /// @see https://github.com/crankyoldgit/IRremoteESP8266/issues/417
 /// @see https://github.com/crankyoldgit/IRremoteESP8266/issues/453
@@ -859,6 +861,40 @@ bool IRrecv::decodeHitachiAC(decode_results *results, uint16_t offset,
                              const bool MSBfirst) {
   const uint8_t k_tolerance = _tolerance + 5;
 
+  if (!nbits) {  // Any size. Only try the ones the capture could be.
+    const uint16_t start = offset + kHeader;
+#if DECODE_HITACHI_AC344
+    if (_canEndAfter(results, start, kHitachiAc344Bits, kHitachiAcMinGap,
+                     k_tolerance) &&
+        decodeHitachiAC(results, offset, kHitachiAc344Bits, strict, false))
+      return true;
+#endif  // DECODE_HITACHI_AC344
+#if DECODE_HITACHI_AC264
+    if (_canEndAfter(results, start, kHitachiAc264Bits, kHitachiAcMinGap,
+                     k_tolerance) &&
+        decodeHitachiAC(results, offset, kHitachiAc264Bits, strict, false))
+      return true;
+#endif  // DECODE_HITACHI_AC264
+#if DECODE_HITACHI_AC2
+    if (_canEndAfter(results, start, kHitachiAc2Bits, kHitachiAcMinGap,
+                     k_tolerance) &&
+        decodeHitachiAC(results, offset, kHitachiAc2Bits, strict, true))
+      return true;
+#endif  // DECODE_HITACHI_AC2
+#if DECODE_HITACHI_AC
+    if (_canEndAfter(results, start, kHitachiAcBits, kHitachiAcMinGap,
+                     k_tolerance) &&
+        decodeHitachiAC(results, offset, kHitachiAcBits, strict, true))
+      return true;
+#endif  // DECODE_HITACHI_AC
+#if DECODE_HITACHI_AC1
+    if (_canEndAfter(results, start, kHitachiAc1Bits, kHitachiAcMinGap,
+                     k_tolerance) &&
+        decodeHitachiAC(results, offset, kHitachiAc1Bits, strict, true))
+      return true;
+#endif  // DECODE_HITACHI_AC1
+    return false;
+  }
   if (strict) {
     switch (nbits) {
       case kHitachiAcBits:
@@ -142,7 +142,8 @@ uint32_t IRsend::encodeLG(uint16_t address, uint16_t command) {
 /// @param[in] offset The starting index to use when attempting to decode the
 ///   raw data. Typically/Defaults to kStartOffset.
 /// @param[in] nbits The number of data bits to expect.
-///   Typically kLgBits or kLg32Bits.
+///   Typically kLgBits or kLg32Bits. 0 means either, but only those the capture
+///   has a gap (or ends) after.
 /// @param[in] strict Flag indicating if we should perform strict matching.
 /// @return True if it can decode it, false if it can't.
 /// @note LG protocol has a repeat code which is 4 items long.
@@ -155,6 +156,13 @@ uint32_t IRsend::encodeLG(uint16_t address, uint16_t command) {
 /// @see https://funembedded.wordpress.com/2014/11/08/ir-remote-control-for-lg-conditioner-using-stm32f302-mcu-on-mbed-platform/
 bool IRrecv::decodeLG(decode_results *results, uint16_t offset,
                       const uint16_t nbits, const bool strict) {
+  if (!nbits) {  // Either size. Only try the ones the capture could be.
+    const uint16_t start = offset + kHeader;
+    if (_canEndAfter(results, start, kLgBits, kLgMinGap, kUseDefTol, 0) &&
+        decodeLG(results, offset, kLgBits, strict)) return true;
+    return _canEndAfter(results, start, kLg32Bits, kLgMinGap, kUseDefTol, 0) &&
+        decodeLG(results, offset, kLg32Bits, strict);
+  }
   if (nbits >= kLg32Bits) {
     if (results->rawlen <= 2 * nbits + 2 * (kHeader + kFooter) - 1 + offset)
       return false;  // Can't possibly be a valid LG32 message.
@@ -121,6 +121,9 @@ uint64_t IRsend::encodePanasonic(const uint16_t manufacturer,
 /// @param[in] offset The starting index to use when attempting to decode the
 ///   raw data. Typically/Defaults to kStartOffset.
 /// @param[in] nbits The number of data bits to expect.
+///   0 means kPanasonicBits or kPanasonic40Bits, but only those the capture has
+///   a gap (or ends) after. A 40-bit message is then always strictly matched,
+///   with kPanasonic40Manufacturer.
 /// @param[in] manufacturer A 16-bit manufacturer code. e.g. 0x4004 is Panasonic
 /// @param[in] strict Flag indicating if we should perform strict matching.
 /// @return True if it can decode it, false if it can't.
@@ -131,6 +134,15 @@ uint64_t IRsend::encodePanasonic(const uint16_t manufacturer,
 bool IRrecv::decodePanasonic(decode_results *results, uint16_t offset,
                              const uint16_t nbits, const bool strict,
                              const uint32_t manufacturer) {
+  if (!nbits) {  // Either size. Only try the ones the capture could be.
+    const uint16_t start = offset + kHeader;
+    if (_canEndAfter(results, start, kPanasonicBits, kPanasonicEndGap) &&
+        decodePanasonic(results, offset, kPanasonicBits, strict, manufacturer))
+      return true;
+    return _canEndAfter(results, start, kPanasonic40Bits, kPanasonicEndGap) &&
+        decodePanasonic(results, offset, kPanasonic40Bits, true,
+                        kPanasonic40Manufacturer);
+  }
   if (strict) {  // Compliance checks
     switch (nbits) {
       case kPanasonic40Bits:
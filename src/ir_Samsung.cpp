@@ -949,11 +949,25 @@ String IRSamsungAc::toString(void) const {
 /// @param[in] offset The starting index to use when attempting to decode the
 ///   raw data. Typically/Defaults to kStartOffset.
 /// @param[in] nbits The number of data bits to expect.
+///   0 means kSamsungAcExtendedBits, if the capture has a third section, then
+///   kSamsungAcBits.
 /// @param[in] strict Flag indicating if we should perform strict matching.
 /// @return True if it can decode it, false if it can't.
 /// @see https://github.com/crankyoldgit/IRremoteESP8266/issues/505
 bool IRrecv::decodeSamsungAC(decode_results *results, uint16_t offset,
                              const uint16_t nbits, const bool strict) {
+  if (!nbits) {  // Either size.
+    // Where the third section's mark would be. i.e. After the header, & two
+    // sections of a mark, a space, the data bits, a footer mark, & a gap.
+    const uint16_t third = offset + kHeader +
+        2 * (kHeader + kSamsungAcSectionLength * 8 * 2 + kFooter);
+    if (third < results->rawlen &&
+        matchMark(results->rawbuf[third], kSamsungAcSectionMark, _tolerance,
+                  0) &&
+        decodeSamsungAC(results, offset, kSamsungAcExtendedBits, strict))
+      return true;
+    return decodeSamsungAC(results, offset, kSamsungAcBits, strict);
+  }
   if (results->rawlen < 2 * nbits + kHeader * 3 + kFooter * 2 - 1 + offset)
     return false;  // Can't possibly be a valid Samsung A/C message.
   if (nbits != kSamsungAcBits && nbits != kSamsungAcExtendedBits) return false;
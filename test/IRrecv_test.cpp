@@ -1,6 +1,9 @@
 // Copyright 2017 David Conran
 
 #include "IRrecv_test.h"
+#include <memory>
+#include <vector>
+#include "IRac.h"
 #include "IRrecv.h"
 #include "IRremoteESP8266.h"
 #include "IRsend.h"
@@ -109,8 +112,9 @@ TEST(TestCopyIrParams, CopyEmpty) {
   ASSERT_EQ(src.rawlen, dst.rawlen);
   ASSERT_NE(src.rawbuf, dst.rawbuf);  // Pointers, not content.
   ASSERT_EQ(src.overflow, dst.overflow);
-  // Contents of the buffers needs to match.
-  EXPECT_EQ(0, memcmp(src.rawbuf, dst.rawbuf, src.bufsize * sizeof(uint16_t)));
+  // Contents of the used part of the buffers needs to match.
+  EXPECT_EQ(0, memcmp(src.rawbuf, dst.rawbuf,
+                      (src.rawlen + 1) * sizeof(uint16_t)));
 }
 
 TEST(TestCopyIrParams, CopyNonEmpty) {
@@ -132,6 +136,7 @@ TEST(TestCopyIrParams, CopyNonEmpty) {
   ASSERT_NE(src.rawbuf, dst.rawbuf);
   // and that they differ before we test.
   EXPECT_NE(0, memcmp(src.rawbuf, dst.rawbuf, src.bufsize * sizeof(uint16_t)));
+  dst.rawbuf[test_size - 1] = 0;
 
   IRrecv irrecv(4);
   irrecv.copyIrParams(&src, &dst);
@@ -143,12 +148,64 @@ TEST(TestCopyIrParams, CopyNonEmpty) {
   ASSERT_EQ(src.overflow, dst.overflow);
   EXPECT_TRUE(dst.overflow);
   ASSERT_NE(src.rawbuf, dst.rawbuf);  // Pointers, not content.
-  // Contents of the buffers needs to match.
-  EXPECT_EQ(0, memcmp(src.rawbuf, dst.rawbuf, src.bufsize * sizeof(uint16_t)));
+  // Contents of the used part of the buffers needs to match.
+  EXPECT_EQ(0, memcmp(src.rawbuf, dst.rawbuf,
+                      (src.rawlen + 1) * sizeof(uint16_t)));
   // Check the canary values.
   EXPECT_EQ(0xF00D, dst.rawbuf[0]);
   EXPECT_EQ(0xBEEF, dst.rawbuf[1]);
-  EXPECT_EQ(0xDEAD, dst.rawbuf[test_size - 1]);
+  // The unused part of the buffer isn't copied.
+  EXPECT_EQ(0, dst.rawbuf[test_size - 1]);
+}
+
+TEST(TestCopyIrParams, CopyFullBuffer) {
+  irparams_t src;
+  irparams_t dst;
+  const uint16_t test_size = 100;
+  uint16_t src_buf[test_size + 1];
+  uint16_t dst_buf[test_size + 1];
+  for (uint16_t i = 0; i <= test_size; i++) {
+    src_buf[i] = i;
+    dst_buf[i] = 0xFFFF;
+  }
+  src.bufsize = test_size;
+  src.rawlen = test_size;
+  src.rawbuf = src_buf;
+  src.overflow = true;
+  dst.rawbuf = dst_buf;
+
+  IRrecv irrecv(4);
+  irrecv.copyIrParams(&src, &dst);
+  EXPECT_EQ(test_size, dst.rawlen);
+  EXPECT_EQ(dst_buf, dst.rawbuf);
+  EXPECT_EQ(0, memcmp(src_buf, dst_buf, test_size * sizeof(uint16_t)));
+  // Never past the end of the buffer.
+  EXPECT_EQ(0xFFFF, dst_buf[test_size]);
+}
+
+TEST(TestCopyIrParams, SwapIrParams) {
+  irparams_t src;
+  irparams_t dst;
+  uint16_t src_buf[10] = {1, 2, 3};
+  uint16_t dst_buf[10] = {0};
+  src.bufsize = 10;
+  src.rawlen = 3;
+  src.rawbuf = src_buf;
+  src.overflow = false;
+  src.timestamp = 1234;
+  dst.bufsize = 0;
+  dst.rawlen = 0;
+  dst.rawbuf = dst_buf;
+
+  IRrecv irrecv(4);
+  irrecv.swapIrParams(&src, &dst);
+  EXPECT_EQ(10, dst.bufsize);
+  EXPECT_EQ(3, dst.rawlen);
+  EXPECT_EQ(1234, dst.timestamp);
+  // The buffers are traded, not copied.
+  EXPECT_EQ(src_buf, dst.rawbuf);
+  EXPECT_EQ(dst_buf, src.rawbuf);
+  EXPECT_EQ(0, dst_buf[0]);
 }
 
 // Tests for decode().
@@ -1357,6 +1414,37 @@ TEST(TestIRrecv, Tolerance) {
   ASSERT_FALSE(result.success);
 }
 
+TEST(TestIRrecv, TickBounds) {
+  IRrecv irrecv(1);
+
+  // Integer maths, with the same rounding as before.
+  EXPECT_EQ(750, irrecv.ticksLow(1000));
+  EXPECT_EQ(1251, irrecv.ticksHigh(1000));
+  EXPECT_EQ(699, irrecv.ticksLow(999, 30));
+  EXPECT_EQ(1299, irrecv.ticksHigh(999, 30));
+  EXPECT_EQ(650, irrecv.ticksLow(1000, 25, 100));
+  EXPECT_EQ(1351, irrecv.ticksHigh(1000, 25, 100));
+  EXPECT_EQ(0, irrecv.ticksLow(100, 25, 100));  // No underflow.
+  EXPECT_EQ(0, irrecv.ticksLow(1000, 100));
+  EXPECT_EQ(2001, irrecv.ticksHigh(1000, 100));
+  // Big values don't overflow.
+  EXPECT_EQ(3000000000UL, irrecv.ticksLow(4000000000UL));
+  EXPECT_EQ(2250000000UL, irrecv.ticksLow(3000000000UL, 25));
+
+  // Pre-calculated ranges must agree with match() for every raw value.
+  const uint16_t desired[] = {0, 1, 2, 3, 158, 500, 999, 1690, 8960, 29784};
+  const uint8_t tolerances[] = {0, 1, 25, 33, 40, 99, 100, kUseDefTol};
+  for (uint16_t usecs : desired)
+    for (uint8_t tolerance : tolerances) {
+      tick_range_t range = irrecv._tickRange(usecs, tolerance);
+      for (uint32_t ticks = 0; ticks <= usecs + 10U; ticks++)
+        EXPECT_EQ(irrecv.match(ticks, usecs, tolerance),
+                  ticks >= range.low && ticks <= range.high)
+            << "usecs: " << usecs << " tolerance: " << (int)tolerance
+            << " ticks: " << ticks;
+    }
+}
+
 TEST(TestDecode, SkippingInDecode) {
   IRsendTest irsend(0);
   IRrecv irrecv(1);
@@ -1469,6 +1557,1633 @@ TEST(TestDecode, SkippingInDecode) {
   EXPECT_EQ(0x4BB640BF, irsend.capture.value);
 }
 
+// Decoding doesn't need the IRsendTest shim. Any buffer will do.
+TEST(TestDecode, DecodeCaptureFromHostBuffer) {
+  IRrecv irrecv(1);
+  const uint64_t data = 0x4BB640BF;
+  // Build a NEC message by hand, in ticks.
+  uint16_t rawbuf[kStartOffset + 2 + kNECBits * 2 + 1];
+  uint16_t len = 0;
+  rawbuf[len++] = 0;  // The gap before the message.
+  rawbuf[len++] = 8960 / kRawTick;
+  rawbuf[len++] = 4480 / kRawTick;
+  for (int16_t bit = kNECBits - 1; bit >= 0; bit--) {
+    rawbuf[len++] = 560 / kRawTick;
+    rawbuf[len++] = ((data >> bit) & 1) ? 1690 / kRawTick : 560 / kRawTick;
+  }
+  rawbuf[len++] = 560 / kRawTick;
+
+  decode_results results;
+  results.rawbuf = rawbuf;
+  results.rawlen = len;
+  results.overflow = false;
+  ASSERT_TRUE(irrecv.decodeCapture(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(kNECBits, results.bits);
+  EXPECT_EQ(data, results.value);
+  EXPECT_FALSE(results.repeat);
+  // The capture itself is left alone.
+  EXPECT_EQ(rawbuf, results.rawbuf);
+  EXPECT_EQ(len, results.rawlen);
+
+  // Garbage still falls through to the hash decoder, or nothing at all.
+  rawbuf[1] = 100;
+  ASSERT_TRUE(irrecv.decodeCapture(&results));
+  EXPECT_EQ(UNKNOWN, results.decode_type);
+  results.rawlen = 3;
+  EXPECT_FALSE(irrecv.decodeCapture(&results));
+}
+
+// Build a NEC message by hand, in ticks, as the ISR would have captured it.
+static uint16_t necCapture(uint16_t *rawbuf, const uint32_t data) {
+  uint16_t len = 0;
+  rawbuf[len++] = 1;  // The ISR's first entry.
+  rawbuf[len++] = 8960 / kRawTick;
+  rawbuf[len++] = 4480 / kRawTick;
+  for (int16_t bit = kNECBits - 1; bit >= 0; bit--) {
+    rawbuf[len++] = 560 / kRawTick;
+    rawbuf[len++] = ((data >> bit) & 1) ? 1690 / kRawTick : 560 / kRawTick;
+  }
+  rawbuf[len++] = 560 / kRawTick;
+  return len;
+}
+
+TEST(TestIRrecv, CaptureQueue) {
+  IRrecv irrecv(1);
+  EXPECT_EQ(0, irrecv.getCaptureQueueSize());
+  ASSERT_TRUE(irrecv.setCaptureQueueSize(2));
+  EXPECT_EQ(2, irrecv.getCaptureQueueSize());
+  irrecv.enableIRIn();
+  decode_results results;
+  uint16_t rawbuf[kRawBuf];
+  EXPECT_FALSE(irrecv.decode(&results));  // Nothing captured yet.
+
+  // Two fit in the queue, and the ISR can hold a third itself.
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF10EF),
+                                    1000));
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF40BF),
+                                    2000));
+  EXPECT_EQ(2, irrecv.getCapturesPending());
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DFC03F),
+                                    3000));
+  EXPECT_EQ(2, irrecv.getCapturesPending());
+  // There is nowhere to put a fourth.
+  EXPECT_EQ(0, irrecv.getCaptureDrops());
+  EXPECT_FALSE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF906F),
+                                    4000));
+  EXPECT_EQ(1, irrecv.getCaptureDrops());
+
+  // They come out in the order they went in.
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF10EF, results.value);
+  EXPECT_EQ(1000, irrecv.getCaptureTimestamp());
+  EXPECT_FALSE(results.overflow);
+  EXPECT_EQ(1, irrecv.getCapturesPending());
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF40BF, results.value);
+  EXPECT_EQ(2000, irrecv.getCaptureTimestamp());
+  // Handing back the first slot made room for the one the ISR held.
+  EXPECT_EQ(1, irrecv.getCapturesPending());
+  irrecv.resume();
+  EXPECT_EQ(1, irrecv.getCapturesPending());
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DFC03F, results.value);
+  EXPECT_EQ(3000, irrecv.getCaptureTimestamp());
+  EXPECT_EQ(0, irrecv.getCapturesPending());
+  EXPECT_FALSE(irrecv.decode(&results));
+
+  // Capturing carries on as normal.
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF00FF),
+                                    5000));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF00FF, results.value);
+  EXPECT_EQ(1, irrecv.getCaptureDrops());
+
+  // An overflowed capture keeps its flag, and stays within its buffer.
+  for (uint16_t i = 0; i < kRawBuf; i++) rawbuf[i] = 100;
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, kRawBuf, 6000));
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, kRawBuf + 1, 7000));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_FALSE(results.overflow);
+  EXPECT_EQ(kRawBuf, results.rawlen);
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_TRUE(results.overflow);
+  EXPECT_EQ(kRawBuf, results.rawlen);
+  EXPECT_EQ(7000, irrecv.getCaptureTimestamp());
+
+  // Disabling the queue goes back to the single capture buffer.
+  ASSERT_TRUE(irrecv.setCaptureQueueSize(0));
+  EXPECT_EQ(0, irrecv.getCapturesPending());
+}
+
+// A message too long for the buffer, arriving edge by edge.
+TEST(TestIRrecv, CaptureQueueEdgeOverflow) {
+  IRrecv irrecv(1);
+  ASSERT_TRUE(irrecv.setCaptureQueueSize(1));
+  irrecv.enableIRIn();
+  decode_results results;
+  // The edges that don't fit are lost, but the timer still queues the rest
+  // once the message is over.
+  for (uint16_t i = 0; i < kRawBuf + 10; i++) irrecv._injectEdge(100);
+  irrecv._injectTimeout();
+  EXPECT_EQ(1, irrecv.getCapturesPending());
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_TRUE(results.overflow);
+  EXPECT_EQ(kRawBuf, results.rawlen);
+
+  // Capturing carries on as normal. This one has to wait for the slot the
+  // last decode() still holds, until the next one hands it back.
+  uint16_t rawbuf[kRawBuf];
+  const uint16_t len = necCapture(rawbuf, 0x20DF10EF);
+  for (uint16_t i = 0; i < len; i++) irrecv._injectEdge(rawbuf[i]);
+  irrecv._injectTimeout();
+  EXPECT_EQ(kStopState, irrecv._getParamsPtr()->rcvstate);
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF10EF, results.value);
+  EXPECT_FALSE(results.overflow);
+  EXPECT_EQ(kIdleState, irrecv._getParamsPtr()->rcvstate);
+  EXPECT_EQ(0, irrecv.getCaptureDrops());
+}
+
+TEST(TestIRrecv, SaveBufferIsSwapped) {
+  IRrecv irrecv(1, kRawBuf, kTimeoutMs, true);
+  irrecv.enableIRIn();
+  volatile irparams_t *params_ptr = irrecv._getParamsPtr();
+  uint16_t *first = params_ptr->rawbuf;
+  decode_results results;
+
+  params_ptr->rawlen = necCapture(params_ptr->rawbuf, 0x20DF10EF);
+  params_ptr->overflow = false;
+  params_ptr->rcvstate = kStopState;
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF10EF, results.value);
+  // We decoded from the interrupt's old buffer, & it got a fresh one.
+  EXPECT_EQ(first, results.rawbuf);
+  uint16_t *second = params_ptr->rawbuf;
+  EXPECT_NE(first, second);
+  EXPECT_EQ(kIdleState, params_ptr->rcvstate);
+
+  // ... and they ping-pong back and forth.
+  params_ptr->rawlen = necCapture(params_ptr->rawbuf, 0x20DF40BF);
+  params_ptr->rcvstate = kStopState;
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF40BF, results.value);
+  EXPECT_EQ(second, results.rawbuf);
+  EXPECT_EQ(first, params_ptr->rawbuf);
+
+  // A caller supplied save buffer still gets a copy.
+  irparams_t save;
+  uint16_t save_buf[kRawBuf];
+  save.rawbuf = save_buf;
+  params_ptr->rawlen = necCapture(params_ptr->rawbuf, 0x20DFC03F);
+  params_ptr->rcvstate = kStopState;
+  ASSERT_TRUE(irrecv.decode(&results, &save));
+  EXPECT_EQ(0x20DFC03F, results.value);
+  EXPECT_EQ(save_buf, results.rawbuf);
+  EXPECT_EQ(first, params_ptr->rawbuf);
+}
+
+TEST(TestIRrecv, CaptureQueueWithSaveBuffer) {
+  IRrecv irrecv(1, kRawBuf, kTimeoutMs, true);
+  ASSERT_TRUE(irrecv.setCaptureQueueSize(1));
+  irrecv.enableIRIn();
+  decode_results results;
+  uint16_t rawbuf[kRawBuf];
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF10EF),
+                                    1000));
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF40BF),
+                                    2000));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF10EF, results.value);
+  // The capture was swapped out, so its slot went straight back to the queue
+  // and the ISR's held capture took its place.
+  EXPECT_EQ(1, irrecv.getCapturesPending());
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DFC03F),
+                                    3000));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF40BF, results.value);
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DFC03F, results.value);
+  EXPECT_FALSE(irrecv.decode(&results));
+  EXPECT_EQ(0, irrecv.getCaptureDrops());
+}
+
+TEST(TestIRrecv, MultipleReceivers) {
+  IRrecv first(1);
+  IRrecv second(2, 1024);
+  ASSERT_TRUE(first.setCaptureQueueSize(1));
+  ASSERT_TRUE(second.setCaptureQueueSize(2));
+  first.enableIRIn();
+  second.enableIRIn();
+  // Each gets its own interrupt slot, & its own capture buffer.
+  EXPECT_NE(first._slot, second._slot);
+  EXPECT_GT(kMaxReceivers, first._slot);
+  EXPECT_GT(kMaxReceivers, second._slot);
+  EXPECT_NE(first._getParamsPtr()->rawbuf, second._getParamsPtr()->rawbuf);
+  EXPECT_EQ(kRawBuf, first.getBufSize());
+  EXPECT_EQ(1024, second.getBufSize());
+
+  // Two messages arrive at the same time, their edges interleaved.
+  uint16_t raw_first[kRawBuf];
+  uint16_t raw_second[kRawBuf];
+  const uint16_t len_first = necCapture(raw_first, 0x20DF10EF);
+  const uint16_t len_second = necCapture(raw_second, 0x20DF40BF);
+  ASSERT_EQ(len_first, len_second);
+  for (uint16_t i = 0; i < len_first; i++) {
+    first._injectEdge(raw_first[i]);
+    second._injectEdge(raw_second[i]);
+  }
+  EXPECT_EQ(len_first, first._getParamsPtr()->rawlen);
+  EXPECT_EQ(len_second, second._getParamsPtr()->rawlen);
+  decode_results results;
+  EXPECT_FALSE(first.decode(&results));
+  EXPECT_FALSE(second.decode(&results));
+
+  // One timing out doesn't stop the other capturing.
+  first._injectTimeout();
+  EXPECT_EQ(1, first.getCapturesPending());
+  EXPECT_EQ(kMarkState, second._getParamsPtr()->rcvstate);
+  EXPECT_FALSE(second.decode(&results));
+  ASSERT_TRUE(first.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF10EF, results.value);
+  second._injectTimeout();
+  EXPECT_EQ(1, second.getCapturesPending());
+  EXPECT_EQ(0, first.getCapturesPending());
+  ASSERT_TRUE(second.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF40BF, results.value);
+
+  // Drops are counted per receiver. `first` hasn't been resumed, so it has
+  // room for one more capture, but not two.
+  EXPECT_TRUE(first._injectCapture(raw_first, len_first));
+  EXPECT_FALSE(first._injectCapture(raw_first, len_first));
+  EXPECT_EQ(1, first.getCaptureDrops());
+  EXPECT_EQ(0, second.getCaptureDrops());
+
+  // Destroying a receiver leaves the others' buffers alone.
+  {
+    IRrecv third(3);
+    third.enableIRIn();
+    EXPECT_NE(first._slot, third._slot);
+    EXPECT_NE(second._slot, third._slot);
+  }
+  EXPECT_TRUE(second._injectCapture(raw_second, len_second, 1000));
+  ASSERT_TRUE(second.decode(&results));
+  EXPECT_EQ(0x20DF40BF, results.value);
+  EXPECT_EQ(1000, second.getCaptureTimestamp());
+
+  // Once all the interrupt slots are taken, there are none for any more.
+  IRrecv *others[kMaxReceivers];
+  for (uint8_t i = 0; i < kMaxReceivers; i++) others[i] = new IRrecv(i + 3);
+  // `first` & `second` have two of them.
+  EXPECT_GT(kMaxReceivers, others[kMaxReceivers - 3]->_slot);
+  EXPECT_EQ(kMaxReceivers, others[kMaxReceivers - 2]->_slot);
+  EXPECT_EQ(kMaxReceivers, others[kMaxReceivers - 1]->_slot);
+  // Which still capture, just not from a pin.
+  EXPECT_TRUE(others[kMaxReceivers - 1]->_injectCapture(raw_first,
+                                                        len_first));
+  const uint8_t freed = others[0]->_slot;
+  delete others[0];
+  IRrecv replacement(10);
+  EXPECT_EQ(freed, replacement._slot);
+  for (uint8_t i = 1; i < kMaxReceivers; i++) delete others[i];
+}
+
+// Make a copy of a capture, with each entry out by up to +/- `percent`%.
+// Like another sensor receiving the same message would.
+static uint16_t jitterCapture(const decode_results &capture, uint16_t *rawbuf,
+                              const uint8_t percent, uint32_t seed) {
+  for (uint16_t i = 0; i < capture.rawlen; i++) {
+    seed = seed * 1103515245 + 12345;
+    const int32_t range = capture.rawbuf[i] * percent / 100;
+    const int32_t offset = static_cast<int32_t>((seed >> 16) %
+                                                (2 * range + 1)) - range;
+    rawbuf[i] = capture.rawbuf[i] + offset;
+  }
+  return capture.rawlen;
+}
+
+TEST(TestIRrecv, DecodeCombined) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1, 1024, kTimeoutMs, true);
+  irsend.begin();
+  uint8_t daikin_code[kDaikinStateLength] = {
+      0x11, 0xDA, 0x27, 0x00, 0xC5, 0x00, 0x00, 0xD7,
+      0x11, 0xDA, 0x27, 0x00, 0x42, 0x3A, 0x05, 0x93, 0x11,
+      0xDA, 0x27, 0x00, 0x00, 0x3F, 0x3A, 0x00, 0xA0, 0x00,
+      0x0A, 0x25, 0x17, 0x01, 0x00, 0xC0, 0x00, 0x00, 0x32};
+  irsend.reset();
+  irsend.sendDaikin(daikin_code, kDaikinStateLength, 0);
+  irsend.makeDecodeResult();
+  const uint16_t rawlen = irsend.capture.rawlen;
+  ASSERT_GT(1000, rawlen);
+
+  // Three sensors each got a slightly different copy, with one space mangled.
+  uint16_t rawbufs[4][1024];
+  decode_results copies[4];
+  for (uint8_t i = 0; i < 4; i++) {
+    copies[i].rawbuf = rawbufs[i];
+    copies[i].rawlen = jitterCapture(irsend.capture, rawbufs[i], 10, i + 1);
+    copies[i].overflow = false;
+  }
+  for (uint8_t i = 0; i < 3; i++) rawbufs[i][100 + 150 * i] = 6000 / kRawTick;
+  decode_results results;
+  for (uint8_t i = 0; i < 3; i++) {
+    results = copies[i];
+    EXPECT_FALSE(irrecv.decodeCapture(&results) &&
+                 results.decode_type == DAIKIN);
+  }
+
+  // If one decodes on its own, that one is used.
+  EXPECT_TRUE(irrecv.decodeCombined(&results, copies, 4));
+  EXPECT_EQ(DAIKIN, results.decode_type);
+  EXPECT_STATE_EQ(daikin_code, results.state, kDaikinBits);
+  EXPECT_EQ(irrecv.params_save->rawbuf, results.rawbuf);
+  EXPECT_EQ(rawlen, results.rawlen);
+  // The copies are left as they were.
+  EXPECT_EQ(6000 / kRawTick, rawbufs[0][100]);
+
+  // Otherwise they are merged, entry by entry.
+  EXPECT_TRUE(irrecv.decodeCombined(&results, copies, 3));
+  EXPECT_EQ(DAIKIN, results.decode_type);
+  EXPECT_STATE_EQ(daikin_code, results.state, kDaikinBits);
+  EXPECT_TRUE(irrecv.decodeCombined(&results, copies, 3, kDiversityMajority));
+  EXPECT_EQ(DAIKIN, results.decode_type);
+  EXPECT_STATE_EQ(daikin_code, results.state, kDaikinBits);
+
+  // A copy that has a glitch in it doesn't line up with the others, so it is
+  // left out of the merge.
+  for (uint16_t i = 0; i < 400; i++) rawbufs[3][i] = rawbufs[0][i];
+  rawbufs[3][400] = 50 / kRawTick;
+  rawbufs[3][401] = 50 / kRawTick;
+  for (uint16_t i = 400; i < rawlen; i++) rawbufs[3][i + 2] = rawbufs[0][i];
+  copies[3].rawlen = rawlen + 2;
+  results = copies[3];
+  EXPECT_FALSE(irrecv.decodeCapture(&results) &&
+               results.decode_type == DAIKIN);
+  decode_results mixed[4] = {copies[3], copies[0], copies[1], copies[2]};
+  EXPECT_TRUE(irrecv.decodeCombined(&mixed[0], mixed, 4));
+  EXPECT_EQ(DAIKIN, mixed[0].decode_type);
+  EXPECT_EQ(rawlen, mixed[0].rawlen);
+
+  // Two of them can't outvote each other, but the normal decode chain still
+  // runs on the merge. i.e. It is reported as UNKNOWN.
+  EXPECT_TRUE(irrecv.decodeCombined(&results, copies, 2, kDiversityMajority));
+  EXPECT_EQ(UNKNOWN, results.decode_type);
+  EXPECT_FALSE(irrecv.decodeCombined(&results, copies, 0));
+
+  // There has to be a save buffer to decode into.
+  IRrecv unsaved(2, 1024);
+  EXPECT_FALSE(unsaved.decodeCombined(&results, copies, 3));
+}
+
+TEST(TestIRrecv, DecodeDiversity) {
+  IRsendTest irsend(0);
+  IRrecv first(1, 1024, kTimeoutMs, true);
+  IRrecv second(2, 1024);
+  IRrecv third(3, 1024);
+  ASSERT_TRUE(second.setCaptureQueueSize(1));
+  first.enableIRIn();
+  second.enableIRIn();
+  third.enableIRIn();
+  IRrecv *others[2] = {&second, &third};
+  irsend.begin();
+  uint8_t daikin_code[kDaikinStateLength] = {
+      0x11, 0xDA, 0x27, 0x00, 0xC5, 0x00, 0x00, 0xD7,
+      0x11, 0xDA, 0x27, 0x00, 0x42, 0x3A, 0x05, 0x93, 0x11,
+      0xDA, 0x27, 0x00, 0x00, 0x3F, 0x3A, 0x00, 0xA0, 0x00,
+      0x0A, 0x25, 0x17, 0x01, 0x00, 0xC0, 0x00, 0x00, 0x32};
+  irsend.reset();
+  irsend.sendDaikin(daikin_code, kDaikinStateLength, 0);
+  irsend.makeDecodeResult();
+  uint16_t rawbufs[3][1024];
+  uint16_t rawlen = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    rawlen = jitterCapture(irsend.capture, rawbufs[i], 10, i + 1);
+    rawbufs[i][100 + 150 * i] = 6000 / kRawTick;  // None decode on their own.
+  }
+  decode_results results;
+  EXPECT_FALSE(first.decodeDiversity(&results, others, 2));  // Nothing yet.
+
+  // Two have finished capturing, but the third is still receiving it.
+  EXPECT_TRUE(first._injectCapture(rawbufs[0], rawlen, 10000));
+  EXPECT_TRUE(second._injectCapture(rawbufs[1], rawlen, 10200));
+  for (uint16_t i = 0; i < rawlen; i++) third._injectEdge(rawbufs[2][i]);
+  third._getParamsPtr()->timestamp = 9900;
+  EXPECT_FALSE(first.decodeDiversity(&results, others, 2));
+  third._injectTimeout();
+  ASSERT_TRUE(first.decodeDiversity(&results, others, 2));
+  EXPECT_EQ(DAIKIN, results.decode_type);
+  EXPECT_STATE_EQ(daikin_code, results.state, kDaikinBits);
+  EXPECT_EQ(9900, first.getCaptureTimestamp());
+  // They were all handed back to their receivers.
+  EXPECT_EQ(kIdleState, first._getParamsPtr()->rcvstate);
+  EXPECT_EQ(0, second.getCapturesPending());
+  EXPECT_EQ(kIdleState, third._getParamsPtr()->rcvstate);
+
+  // Captures too far apart are different messages, decoded one at a time.
+  const uint16_t nec_len = necCapture(rawbufs[2], 0x20DF10EF);
+  EXPECT_TRUE(first._injectCapture(rawbufs[2], nec_len, 100000));
+  EXPECT_TRUE(second._injectCapture(rawbufs[2], nec_len, 200000));
+  ASSERT_TRUE(first.decodeDiversity(&results, others, 2));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(100000, first.getCaptureTimestamp());
+  EXPECT_EQ(1, second.getCapturesPending());
+  ASSERT_TRUE(first.decodeDiversity(&results, others, 2));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(200000, first.getCaptureTimestamp());
+  EXPECT_EQ(0, second.getCapturesPending());
+  EXPECT_FALSE(first.decodeDiversity(&results, others, 2));
+
+  // It needs a save buffer to decode into.
+  EXPECT_TRUE(second._injectCapture(rawbufs[2], nec_len, 300000));
+  EXPECT_FALSE(second.decodeDiversity(&results, others, 2));
+}
+
+// Split a capture at its gaps, into the captures a receiver with a shorter
+// timeout than them would make. i.e. One per section.
+// Returns the nr. of segments. Each starts with the ISR's first entry.
+static uint8_t splitCapture(const decode_results &capture,
+                            uint16_t segments[][400], uint16_t *lengths,
+                            uint32_t *starts, const uint8_t max_segments) {
+  const uint32_t gap = MS_TO_USEC(kTimeoutMs);
+  uint8_t count = 0;
+  uint32_t now = 1000;
+  for (uint16_t i = 1; i < capture.rawlen && count < max_segments; i++) {
+    const uint32_t usecs = capture.rawbuf[i] * kRawTick;
+    if (i % 2 == 0 && usecs >= gap) {  // A gap. The segment ends here.
+      count++;
+    } else {
+      if (lengths[count] == 0) {
+        starts[count] = now;
+        segments[count][lengths[count]++] = 1;
+      }
+      segments[count][lengths[count]++] = capture.rawbuf[i];
+    }
+    now += usecs;
+  }
+  if (count < max_segments && lengths[count]) count++;  // No trailing gap.
+  return count;
+}
+
+TEST(TestIRrecv, SegmentedDecode) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1, 400);
+  irsend.begin();
+  ASSERT_TRUE(irrecv.setCaptureQueueSize(4));
+  irrecv.enableIRIn();
+  EXPECT_FALSE(irrecv.getSegmentedDecode());
+  ASSERT_TRUE(irrecv.setSegmentedDecode(true));
+  EXPECT_TRUE(irrecv.getSegmentedDecode());
+  decode_results results;
+
+  // DAIKIN312 is a leader & two sections. Far too long for the buffer in one.
+  const uint8_t daikin312_code[kDaikin312StateLength] = {
+      0x11, 0xDA, 0x27, 0x00, 0x02, 0xD0, 0x02, 0x03, 0x80, 0x03, 0x82, 0x30,
+      0x41, 0x1F, 0x82, 0xF4, 0x00, 0x00, 0x00, 0x00, 0x11, 0xDA, 0x27, 0x00,
+      0x00, 0x49, 0x2C, 0x00, 0xA0, 0x00, 0x00, 0x06, 0x60, 0x00, 0x00, 0xC3,
+      0x00, 0x00, 0x08};
+  irsend.reset();
+  irsend.sendDaikin312(daikin312_code);
+  irsend.makeDecodeResult();
+  EXPECT_LT(irrecv.getBufSize(), irsend.capture.rawlen);
+  uint16_t segments[4][400];
+  uint16_t lengths[4] = {0};
+  uint32_t starts[4];
+  ASSERT_EQ(3, splitCapture(irsend.capture, segments, lengths, starts, 4));
+  for (uint8_t i = 0; i < 3; i++)
+    EXPECT_TRUE(irrecv._injectCapture(segments[i], lengths[i], starts[i]));
+  // Each section is decoded as it is taken from the queue.
+  EXPECT_FALSE(irrecv.decode(&results));
+  EXPECT_FALSE(irrecv.decode(&results));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(DAIKIN312, results.decode_type);
+  EXPECT_EQ(kDaikin312Bits, results.bits);
+  EXPECT_STATE_EQ(daikin312_code, results.state, kDaikin312Bits);
+  EXPECT_EQ(0, irrecv.getCapturesPending());
+
+  // DAIKIN is a leader & three sections.
+  uint8_t daikin_code[kDaikinStateLength] = {
+      0x11, 0xDA, 0x27, 0x00, 0xC5, 0x00, 0x00, 0xD7,
+      0x11, 0xDA, 0x27, 0x00, 0x42, 0x3A, 0x05, 0x93, 0x11,
+      0xDA, 0x27, 0x00, 0x00, 0x3F, 0x3A, 0x00, 0xA0, 0x00,
+      0x0A, 0x25, 0x17, 0x01, 0x00, 0xC0, 0x00, 0x00, 0x32};
+  irsend.reset();
+  irsend.sendDaikin(daikin_code, kDaikinStateLength, 0);
+  irsend.makeDecodeResult();
+  uint16_t daikin_lengths[4] = {0};
+  ASSERT_EQ(4, splitCapture(irsend.capture, segments, daikin_lengths, starts,
+                            4));
+  for (uint8_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(irrecv._injectCapture(segments[i], daikin_lengths[i],
+                                      starts[i]));
+    if (i < 3) {
+      EXPECT_FALSE(irrecv.decode(&results));
+    }
+  }
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(DAIKIN, results.decode_type);
+  EXPECT_STATE_EQ(daikin_code, results.state, kDaikinBits);
+
+  // The sections have to follow each other with the right gaps. A missing
+  // section means the rest isn't assembled.
+  EXPECT_TRUE(irrecv._injectCapture(segments[0], daikin_lengths[0],
+                                    starts[0]));
+  EXPECT_TRUE(irrecv._injectCapture(segments[2], daikin_lengths[2],
+                                    starts[2]));
+  EXPECT_FALSE(irrecv.decode(&results));
+  // It may start some other message, but it isn't the end of this one.
+  results.decode_type = UNUSED;
+  irrecv.decode(&results);
+  EXPECT_NE(DAIKIN, results.decode_type);
+  // As does one that comes too late.
+  for (uint8_t i = 0; i < 3; i++) {
+    EXPECT_TRUE(irrecv._injectCapture(segments[i], daikin_lengths[i],
+                                      starts[i]));
+    EXPECT_FALSE(irrecv.decode(&results));
+  }
+  EXPECT_TRUE(irrecv._injectCapture(segments[3], daikin_lengths[3],
+                                    starts[3] + 100000));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_NE(DAIKIN, results.decode_type);  // It's a DAIKIN152 on its own.
+
+  // Only enabled protocols are assembled.
+  irsend.reset();
+  irsend.sendDaikin312(daikin312_code);
+  irsend.makeDecodeResult();
+  uint16_t again[4] = {0};
+  ASSERT_EQ(3, splitCapture(irsend.capture, segments, again, starts, 4));
+  irrecv.setProtocolEnabled(DAIKIN312, false);
+  for (uint8_t i = 0; i < 3; i++) {
+    EXPECT_TRUE(irrecv._injectCapture(segments[i], again[i], starts[i]));
+    irrecv.decode(&results);
+    EXPECT_NE(DAIKIN312, results.decode_type);
+  }
+  irrecv.setProtocolEnabled(DAIKIN312, true);
+
+  // Without it, each section is a message of its own.
+  ASSERT_TRUE(irrecv.setSegmentedDecode(false));
+  for (uint8_t i = 0; i < 3; i++) {
+    EXPECT_TRUE(irrecv._injectCapture(segments[i], again[i], starts[i]));
+    ASSERT_TRUE(irrecv.decode(&results));
+    EXPECT_NE(DAIKIN312, results.decode_type);
+  }
+}
+
+TEST(TestIRrecv, SegmentedDecodeWholeCapture) {
+  // A capture with all the sections in it still decodes the same.
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  ASSERT_TRUE(irrecv.setSegmentedDecode(true));
+  const uint8_t daikin312_code[kDaikin312StateLength] = {
+      0x11, 0xDA, 0x27, 0x00, 0x02, 0xD0, 0x02, 0x03, 0x80, 0x03, 0x82, 0x30,
+      0x41, 0x1F, 0x82, 0xF4, 0x00, 0x00, 0x00, 0x00, 0x11, 0xDA, 0x27, 0x00,
+      0x00, 0x49, 0x2C, 0x00, 0xA0, 0x00, 0x00, 0x06, 0x60, 0x00, 0x00, 0xC3,
+      0x00, 0x00, 0x08};
+  irsend.reset();
+  irsend.sendDaikin312(daikin312_code);
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(DAIKIN312, irsend.capture.decode_type);
+  EXPECT_STATE_EQ(daikin312_code, irsend.capture.state, kDaikin312Bits);
+  // But only as what decodeAs() asks for.
+  irsend.makeDecodeResult();
+  EXPECT_FALSE(irrecv.decodeAs(&irsend.capture, DAIKIN));
+}
+
+TEST(TestIRrecv, CompactCapture) {
+  // It needs a save buffer to decode from.
+  IRrecv plain(1);
+  EXPECT_FALSE(plain.setCompactCapture(true));
+  EXPECT_FALSE(plain.getCompactCapture());
+
+  // A NEC capture is 68 entries, but only 72 bytes in the compact format.
+  // i.e. The two header entries take three bytes each.
+  uint16_t rawbuf[kRawBuf];
+  const uint16_t nec_len = necCapture(rawbuf, 0x20DF10EF);
+  IRrecv irrecv(1, 72, kTimeoutMs, true);
+  ASSERT_TRUE(irrecv.setCaptureQueueSize(2));
+  ASSERT_TRUE(irrecv.setCompactCapture(true));
+  EXPECT_TRUE(irrecv.getCompactCapture());
+  EXPECT_EQ(2, irrecv.getCaptureQueueSize());  // Kept, in the new format.
+  EXPECT_EQ(72, irrecv.getBufSize());
+  irrecv.enableIRIn();
+  decode_results results;
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, nec_len, 1000));
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF40BF),
+                                    2000));
+  EXPECT_EQ(72, irrecv._queue[0].rawlen);  // Bytes, not entries.
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF10EF, results.value);
+  EXPECT_EQ(nec_len, results.rawlen);
+  EXPECT_FALSE(results.overflow);
+  EXPECT_EQ(1000, irrecv.getCaptureTimestamp());
+  EXPECT_EQ(8960 / kRawTick, results.rawbuf[1]);  // Long entries are exact.
+  EXPECT_EQ(560 / kRawTick, results.rawbuf[3]);  // Multiples of kCompactTick.
+  EXPECT_EQ(1688 / kRawTick, results.rawbuf[8]);  // Others are rounded.
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF40BF, results.value);
+  EXPECT_EQ(2000, irrecv.getCaptureTimestamp());
+  EXPECT_FALSE(irrecv.decode(&results));
+
+  // Edge by edge, as the interrupts capture it.
+  for (uint16_t i = 0; i < nec_len; i++) irrecv._injectEdge(rawbuf[i]);
+  irrecv._injectTimeout();
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF40BF, results.value);
+  EXPECT_FALSE(results.overflow);
+  // It's full when there isn't room for the next entry.
+  for (uint16_t i = 0; i < nec_len; i++) irrecv._injectEdge(rawbuf[i]);
+  irrecv._injectEdge(40000 / kRawTick);  // The long gap before a repeat.
+  irrecv._injectTimeout();
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_TRUE(results.overflow);
+  EXPECT_EQ(nec_len, results.rawlen);
+
+  // Without a queue.
+  IRrecv single(1, 71, kTimeoutMs, true);
+  ASSERT_TRUE(single.setCompactCapture(true));
+  single.enableIRIn();
+  EXPECT_TRUE(single._injectCapture(rawbuf, nec_len, 3000));
+  ASSERT_TRUE(single.decode(&results));
+  EXPECT_TRUE(results.overflow);  // One byte short.
+  EXPECT_EQ(nec_len - 1, results.rawlen);
+  EXPECT_EQ(3000, single.getCaptureTimestamp());
+  // Back to the normal format.
+  ASSERT_TRUE(single.setCompactCapture(false));
+  EXPECT_FALSE(single.getCompactCapture());
+  single.enableIRIn();
+  EXPECT_TRUE(single._injectCapture(rawbuf, nec_len, 4000));
+  ASSERT_TRUE(single.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF40BF, results.value);
+}
+
+// Append a 12 bit Sony message to a capture, after a gap.
+static uint16_t appendSony(uint16_t *rawbuf, uint16_t len, const uint16_t data,
+                           const uint32_t gap) {
+  rawbuf[len++] = gap / kRawTick;
+  rawbuf[len++] = 2400 / kRawTick;
+  for (int16_t bit = kSony12Bits - 1; bit >= 0; bit--) {
+    rawbuf[len++] = 600 / kRawTick;
+    rawbuf[len++] = ((data >> bit) & 1) ? 1200 / kRawTick : 600 / kRawTick;
+  }
+  return len;
+}
+
+TEST(TestIRrecv, DecodeNext) {
+  IRrecv irrecv(1, 300, kTimeoutMs, true);
+  irrecv.enableIRIn();
+  decode_results results;
+  EXPECT_FALSE(irrecv.decodeNext(&results));  // Nothing decoded yet.
+
+  // Two remotes at once. A NEC message, then a Sony one 40ms later.
+  uint16_t rawbuf[300];
+  uint16_t len = necCapture(rawbuf, 0x20DF10EF);
+  const uint16_t nec_len = len;
+  len = appendSony(rawbuf, len, 0xA90, 40000);
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, len));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF10EF, results.value);
+  uint16_t *capture = results.rawbuf;
+  ASSERT_TRUE(irrecv.decodeNext(&results));
+  EXPECT_EQ(SONY, results.decode_type);
+  EXPECT_EQ(kSony12Bits, results.bits);
+  EXPECT_EQ(0xA90, results.value);
+  EXPECT_EQ(capture + nec_len, results.rawbuf);  // From the gap before it.
+  EXPECT_EQ(len - nec_len, results.rawlen);
+  EXPECT_FALSE(results.overflow);
+  EXPECT_FALSE(irrecv.decodeNext(&results));  // That's all of it.
+  EXPECT_FALSE(irrecv.decodeNext(&results));
+
+  // Noise between them is skipped, by looking for the next header.
+  len = necCapture(rawbuf, 0x20DF40BF);
+  rawbuf[len++] = 40000 / kRawTick;
+  rawbuf[len++] = 300 / kRawTick;
+  rawbuf[len++] = 5000 / kRawTick;
+  rawbuf[len++] = 200 / kRawTick;
+  const uint16_t sony_start = len;
+  len = appendSony(rawbuf, len, 0x490, 20000);
+  // Another NEC message straight after it.
+  const uint16_t nec2_start = len;
+  len += necCapture(rawbuf + len, 0x20DFC03F);
+  rawbuf[nec2_start] = 40000 / kRawTick;
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, len));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF40BF, results.value);
+  capture = results.rawbuf;
+  ASSERT_TRUE(irrecv.decodeNext(&results));
+  EXPECT_EQ(SONY, results.decode_type);
+  EXPECT_EQ(0x490, results.value);
+  EXPECT_EQ(capture + sony_start, results.rawbuf);
+  EXPECT_EQ(nec2_start - sony_start, results.rawlen);
+  ASSERT_TRUE(irrecv.decodeNext(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DFC03F, results.value);
+  EXPECT_EQ(capture + nec2_start, results.rawbuf);
+  EXPECT_EQ(len - nec2_start, results.rawlen);
+  EXPECT_FALSE(irrecv.decodeNext(&results));
+
+  // Noise we can't decode at the end is hashed.
+  len = necCapture(rawbuf, 0x20DF10EF);
+  for (uint8_t i = 0; i < 12; i++) {
+    rawbuf[len++] = ((i == 0) ? 40000 : 1300 + i * 50) / kRawTick;
+    rawbuf[len++] = (900 + i * 70) / kRawTick;
+  }
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, len));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  ASSERT_TRUE(irrecv.decodeNext(&results));
+  EXPECT_EQ(UNKNOWN, results.decode_type);
+  EXPECT_EQ(len - nec_len, results.rawlen);
+  EXPECT_FALSE(irrecv.decodeNext(&results));
+
+  // A capture that didn't decode has nothing to follow on from.
+  rawbuf[0] = 1;
+  rawbuf[1] = 100;
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, 2));
+  EXPECT_FALSE(irrecv.decode(&results));
+  EXPECT_FALSE(irrecv.decodeNext(&results));
+}
+
+TEST(TestIRrecv, DecodeNextNeedsTheCapture) {
+  // Without a save buffer, the capture is only there until resume().
+  IRrecv irrecv(1, 300);
+  irrecv.enableIRIn();
+  volatile irparams_t *params_ptr = irrecv._getParamsPtr();
+  decode_results results;
+  params_ptr->rawlen = necCapture(params_ptr->rawbuf, 0x20DF10EF);
+  params_ptr->rawlen = appendSony(params_ptr->rawbuf, params_ptr->rawlen,
+                                  0xA90, 40000);
+  results.rawbuf = params_ptr->rawbuf;
+  results.rawlen = params_ptr->rawlen;
+  results.overflow = false;
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  irrecv.resume();
+  EXPECT_FALSE(irrecv.decodeNext(&results));
+
+  // The same again, but carrying on before the resume().
+  params_ptr->rawlen = necCapture(params_ptr->rawbuf, 0x20DF10EF);
+  params_ptr->rawlen = appendSony(params_ptr->rawbuf, params_ptr->rawlen,
+                                  0xA90, 40000);
+  results.rawlen = params_ptr->rawlen;
+  ASSERT_TRUE(irrecv.decode(&results));
+  ASSERT_TRUE(irrecv.decodeNext(&results));
+  EXPECT_EQ(SONY, results.decode_type);
+  irrecv.resume();
+  EXPECT_FALSE(irrecv.decodeNext(&results));
+}
+
+TEST(TestIRrecv, DecodeCache) {
+  IRrecv irrecv(1, kRawBuf, kTimeoutMs, true);
+  EXPECT_EQ(0, irrecv.getDecodeCacheSize());
+  ASSERT_TRUE(irrecv.setDecodeCache(2));
+  EXPECT_EQ(2, irrecv.getDecodeCacheSize());
+  irrecv.enableIRIn();
+  decode_results results;
+  uint16_t rawbuf[kRawBuf];
+  const uint16_t nec_len = necCapture(rawbuf, 0x20DF10EF);
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, nec_len));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF10EF, results.value);
+  EXPECT_EQ(0, irrecv.getDecodeCacheHits());
+  EXPECT_EQ(1, irrecv.getDecodeCacheMisses());
+
+  // The button is held. Its timings wobble a little, but it's still a hit.
+  for (uint16_t i = 1; i < nec_len; i++) rawbuf[i] = rawbuf[i] * 98 / 100;
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, nec_len));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF10EF, results.value);
+  EXPECT_EQ(kNECBits, results.bits);
+  EXPECT_EQ(1, irrecv.getDecodeCacheHits());
+  EXPECT_EQ(1, irrecv.getDecodeCacheMisses());
+
+  // A different button isn't.
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF40BF)));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF40BF, results.value);
+  EXPECT_EQ(1, irrecv.getDecodeCacheHits());
+  EXPECT_EQ(2, irrecv.getDecodeCacheMisses());
+
+  // A hit must decode to the same thing again, or it doesn't count.
+  irrecv._cache[0].result.value = 0x20DF00FF;
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF10EF)));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DF10EF, results.value);
+  EXPECT_EQ(1, irrecv.getDecodeCacheHits());
+  EXPECT_EQ(3, irrecv.getDecodeCacheMisses());
+  EXPECT_EQ(0x20DF10EF, irrecv._cache[0].result.value);  // It was replaced.
+
+  // Only the last two are remembered.
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DFC03F)));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DF40BF)));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(1, irrecv.getDecodeCacheHits());
+  EXPECT_EQ(5, irrecv.getDecodeCacheMisses());
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DFC03F)));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0x20DFC03F, results.value);
+  EXPECT_EQ(2, irrecv.getDecodeCacheHits());
+
+  // decodeAs() doesn't use it.
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DFC03F)));
+  ASSERT_TRUE(irrecv.decodeAs(&results, NEC));
+  EXPECT_EQ(2, irrecv.getDecodeCacheHits());
+  EXPECT_EQ(5, irrecv.getDecodeCacheMisses());
+
+  // Setting it again empties it, & resets the counts.
+  ASSERT_TRUE(irrecv.setDecodeCache(2));
+  EXPECT_EQ(0, irrecv.getDecodeCacheHits());
+  EXPECT_EQ(0, irrecv.getDecodeCacheMisses());
+  EXPECT_TRUE(irrecv._injectCapture(rawbuf, necCapture(rawbuf, 0x20DFC03F)));
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(0, irrecv.getDecodeCacheHits());
+  EXPECT_EQ(1, irrecv.getDecodeCacheMisses());
+  ASSERT_TRUE(irrecv.setDecodeCache(0));
+  EXPECT_EQ(0, irrecv.getDecodeCacheSize());
+}
+
+// Feed a capture to the receiver an edge at a time, like the GPIO interrupt
+// would, calling decode() after each one. Returns the nr. of messages found,
+// and the capture length at which each was found (in `found_at`).
+static uint16_t feedEdges(IRrecv *irrecv, const decode_results &capture,
+                          decode_results *results, decode_results *found,
+                          uint16_t *found_at, const uint16_t max_found) {
+  uint16_t count = 0;
+  irrecv->_injectEdge(0);  // The start of the first mark.
+  for (uint16_t i = 1; i < capture.rawlen; i++) {
+    irrecv->_injectEdge(capture.rawbuf[i]);
+    if (irrecv->decode(results) && count < max_found) {
+      found[count] = *results;
+      found_at[count++] = i + 1;
+    }
+  }
+  return count;
+}
+
+TEST(TestIRrecv, IncrementalDecode) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1, 2048);
+  irsend.begin();
+  EXPECT_FALSE(irrecv.getIncrementalDecode());
+  irrecv.setIncrementalDecode(true);
+  EXPECT_TRUE(irrecv.getIncrementalDecode());
+  irrecv.enableIRIn();
+  volatile irparams_t *params_ptr = irrecv._getParamsPtr();
+  decode_results results;
+  decode_results found[4];
+  uint16_t found_at[4];
+
+  // A multi-section A/C message, sent twice. Each is ready as soon as its
+  // last mark ends, & isn't cut short at the gaps between its sections.
+  uint8_t daikin_code[kDaikinStateLength] = {
+      0x11, 0xDA, 0x27, 0x00, 0xC5, 0x00, 0x00, 0xD7,
+      0x11, 0xDA, 0x27, 0x00, 0x42, 0x3A, 0x05, 0x93, 0x11,
+      0xDA, 0x27, 0x00, 0x00, 0x3F, 0x3A, 0x00, 0xA0, 0x00,
+      0x0A, 0x25, 0x17, 0x01, 0x00, 0xC0, 0x00, 0x00, 0x32};
+  irsend.reset();
+  irsend.sendDaikin(daikin_code, kDaikinStateLength, 1);
+  irsend.makeDecodeResult();
+  ASSERT_EQ(2, feedEdges(&irrecv, irsend.capture, &results, found, found_at,
+                         4));
+  const uint16_t daikin_len = found_at[0];
+  EXPECT_EQ(DAIKIN, found[0].decode_type);
+  EXPECT_EQ(kDaikinBits, found[0].bits);
+  EXPECT_STATE_EQ(daikin_code, found[0].state, kDaikinBits);
+  EXPECT_EQ(DAIKIN, found[1].decode_type);
+  EXPECT_EQ(daikin_len * 2, found_at[1]);
+  // No timeout has happened, so we are still capturing.
+  EXPECT_NE(kStopState, params_ptr->rcvstate);
+  irrecv.resume();  // Must not interrupt the capture.
+  EXPECT_NE(kIdleState, params_ptr->rcvstate);
+  // When the timeout finally fires, there is nothing left to decode.
+  irrecv._injectTimeout();
+  EXPECT_FALSE(irrecv.decode(&results));
+  EXPECT_EQ(kIdleState, params_ptr->rcvstate);
+  EXPECT_EQ(0, params_ptr->rawlen);
+
+  // A NEC message could still be the start of a longer protocol with the
+  // same header (e.g. WHIRLPOOL_AC), so it has to wait for the timeout.
+  irsend.reset();
+  irsend.sendNEC(0x807F40BF);
+  irsend.makeDecodeResult();
+  EXPECT_EQ(0, feedEdges(&irrecv, irsend.capture, &results, found, found_at,
+                         4));
+  irrecv._injectTimeout();
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x807F40BF, results.value);
+  irrecv.resume();
+
+  // Unrecognised data is only hashed once the capture is complete.
+  const uint16_t junk[] = {0, 1000, 1000, 3000, 500, 200, 700, 1000, 300};
+  decode_results capture;
+  capture.rawbuf = const_cast<uint16_t *>(junk);
+  capture.rawlen = sizeof(junk) / sizeof(junk[0]);
+  EXPECT_EQ(0, feedEdges(&irrecv, capture, &results, found, found_at, 4));
+  irrecv._injectTimeout();
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(UNKNOWN, results.decode_type);
+  irrecv.resume();
+  EXPECT_EQ(kIdleState, params_ptr->rcvstate);
+
+  // Back to normal, nothing is decoded until the timeout.
+  irrecv.setIncrementalDecode(false);
+  irsend.reset();
+  irsend.sendNEC(0x807F40BF);
+  irsend.makeDecodeResult();
+  irrecv._injectEdge(0);
+  for (uint16_t i = 1; i < irsend.capture.rawlen; i++)
+    irrecv._injectEdge(irsend.capture.rawbuf[i]);
+  EXPECT_EQ(kMarkState, params_ptr->rcvstate);
+}
+
+// Messages made of several NEC-like sections mustn't be cut into NEC messages
+// by an early decode, even with the longer look-alikes (e.g. WHIRLPOOL_AC)
+// turned off.
+TEST(TestIRrecv, IncrementalDecodeMultiSection) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1, 2048);
+  irsend.begin();
+  irrecv.setIncrementalDecode(true);
+  irrecv.setProtocolEnabled(WHIRLPOOL_AC, false);
+  irrecv.setProtocolEnabled(KELON168, false);
+  irrecv.setProtocolEnabled(CARRIER_AC40, false);
+  irrecv.setProtocolEnabled(CARRIER_AC64, false);
+  irrecv.setProtocolEnabled(AMCOR, false);
+  irrecv.enableIRIn();
+  decode_results results;
+  decode_results found[4];
+  uint16_t found_at[4];
+
+  // Pioneer is two NEC-like sections.
+  irsend.reset();
+  irsend.sendPioneer(0x659A05FAF50AC53A, kPioneerBits, 0);
+  irsend.makeDecodeResult();
+  EXPECT_EQ(0, feedEdges(&irrecv, irsend.capture, &results, found, found_at,
+                         4));
+  irrecv._injectTimeout();
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(PIONEER, results.decode_type);
+  EXPECT_EQ(kPioneerBits, results.bits);
+  EXPECT_EQ(0x659A05FAF50AC53A, results.value);
+  irrecv.resume();
+
+  // A Carrier A/C message is three NEC-like sections.
+  irsend.reset();
+  irsend.sendCarrierAC(0xB28F2A5B, kCarrierAcBits, 0);
+  irsend.makeDecodeResult();
+  EXPECT_EQ(0, feedEdges(&irrecv, irsend.capture, &results, found, found_at,
+                         4));
+  irrecv._injectTimeout();
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(CARRIER_AC, results.decode_type);
+  EXPECT_EQ(kCarrierAcBits, results.bits);
+  EXPECT_EQ(0xB28F2A5B, results.value);
+  irrecv.resume();
+
+  // With nothing longer left that it could become, NEC is found early.
+  irrecv.setAllProtocolsEnabled(false);
+  irrecv.setProtocolEnabled(NEC, true);
+  irsend.reset();
+  irsend.sendNEC(0x807F40BF);
+  irsend.makeDecodeResult();
+  ASSERT_EQ(1, feedEdges(&irrecv, irsend.capture, &results, found, found_at,
+                         4));
+  EXPECT_EQ(NEC, found[0].decode_type);
+  EXPECT_EQ(0x807F40BF, found[0].value);
+}
+
+TEST(TestIRrecv, EnabledProtocols) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  // Everything is enabled by default.
+  EXPECT_TRUE(irrecv.isProtocolEnabled(NEC));
+  EXPECT_TRUE(irrecv.isProtocolEnabled(UNKNOWN));
+  EXPECT_TRUE(irrecv.isProtocolEnabled(kLastDecodeType));
+  EXPECT_FALSE(irrecv.isProtocolEnabled((decode_type_t)(kLastDecodeType + 1)));
+
+  irsend.reset();
+  irsend.sendNEC(0x20DF10EF);
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  // Without NEC, it falls through to the next thing that can decode it.
+  irrecv.setProtocolEnabled(NEC, false);
+  EXPECT_FALSE(irrecv.isProtocolEnabled(NEC));
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(NEC_LIKE, irsend.capture.decode_type);
+  irrecv.setProtocolEnabled(NEC_LIKE, false);
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(UNKNOWN, irsend.capture.decode_type);
+  // & without the hash decoder, nothing decodes it.
+  irrecv.setProtocolEnabled(UNKNOWN, false);
+  EXPECT_FALSE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(UNKNOWN, irsend.capture.decode_type);
+  EXPECT_EQ(0, irsend.capture.bits);
+
+  // Only the protocols asked for.
+  irrecv.setAllProtocolsEnabled(false);
+  EXPECT_FALSE(irrecv.isProtocolEnabled(SONY));
+  irrecv.setProtocolEnabled(NEC, true);
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  irsend.reset();
+  irsend.sendSony(0x240, kSony12Bits);
+  irsend.makeDecodeResult();
+  EXPECT_FALSE(irrecv.decode(&irsend.capture));
+
+  // A protocol decoded by another protocol's decoder.
+  uint8_t heavy88[kMitsubishiHeavy88StateLength] = {
+      0xAD, 0x51, 0x3C, 0xD9, 0x26, 0x48, 0xB7, 0x00, 0xFF, 0x8A, 0x75};
+  irsend.reset();
+  irsend.sendMitsubishiHeavy88(heavy88);
+  irsend.makeDecodeResult();
+  EXPECT_FALSE(irrecv.decode(&irsend.capture));
+  irrecv.setProtocolEnabled(MITSUBISHI_HEAVY_152, true);
+  EXPECT_FALSE(irrecv.decode(&irsend.capture));  // Decodes, but is unwanted.
+  EXPECT_EQ(UNKNOWN, irsend.capture.decode_type);
+  irrecv.setProtocolEnabled(MITSUBISHI_HEAVY_152, false);
+  irrecv.setProtocolEnabled(MITSUBISHI_HEAVY_88, true);
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(MITSUBISHI_HEAVY_88, irsend.capture.decode_type);
+  EXPECT_STATE_EQ(heavy88, irsend.capture.state, kMitsubishiHeavy88Bits);
+}
+
+TEST(TestIRrecv, DecodeAs) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  irsend.reset();
+  irsend.sendNEC(0x20DF10EF);
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decodeAs(&irsend.capture, NEC));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  EXPECT_EQ(0x20DF10EF, irsend.capture.value);
+  ASSERT_TRUE(irrecv.decodeAs(&irsend.capture, NEC_LIKE));
+  EXPECT_EQ(NEC_LIKE, irsend.capture.decode_type);
+  ASSERT_TRUE(irrecv.decodeAs(&irsend.capture, UNKNOWN));
+  EXPECT_EQ(UNKNOWN, irsend.capture.decode_type);
+  EXPECT_EQ(irsend.capture.rawlen / 2, irsend.capture.bits);
+  EXPECT_FALSE(irrecv.decodeAs(&irsend.capture, SONY));
+  EXPECT_EQ(UNKNOWN, irsend.capture.decode_type);
+  EXPECT_FALSE(irrecv.decodeAs(&irsend.capture, UNUSED));
+  // It ignores what is enabled, & doesn't change it.
+  irrecv.setAllProtocolsEnabled(false);
+  ASSERT_TRUE(irrecv.decodeAs(&irsend.capture, NEC));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  EXPECT_FALSE(irrecv.decode(&irsend.capture));
+  irrecv.setAllProtocolsEnabled(true);
+
+  // All of a protocol's bit length variants.
+  irsend.reset();
+  irsend.sendDenon(0x2278, kDenonBits);
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decodeAs(&irsend.capture, DENON));
+  EXPECT_EQ(DENON, irsend.capture.decode_type);
+  EXPECT_EQ(kDenonBits, irsend.capture.bits);
+  EXPECT_EQ(0x2278, irsend.capture.value);
+  irsend.reset();
+  irsend.sendDenon(0x2A4C028D6CE3, kDenon48Bits);
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decodeAs(&irsend.capture, DENON));
+  EXPECT_EQ(DENON, irsend.capture.decode_type);
+  EXPECT_EQ(kDenon48Bits, irsend.capture.bits);
+  EXPECT_EQ(0x2A4C028D6CE3, irsend.capture.value);
+
+  // A protocol decoded by another protocol's decoder.
+  uint8_t heavy88[kMitsubishiHeavy88StateLength] = {
+      0xAD, 0x51, 0x3C, 0xD9, 0x26, 0x48, 0xB7, 0x00, 0xFF, 0x8A, 0x75};
+  irsend.reset();
+  irsend.sendMitsubishiHeavy88(heavy88);
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decodeAs(&irsend.capture, MITSUBISHI_HEAVY_88));
+  EXPECT_EQ(MITSUBISHI_HEAVY_88, irsend.capture.decode_type);
+  EXPECT_FALSE(irrecv.decodeAs(&irsend.capture, MITSUBISHI_HEAVY_152));
+}
+
+TEST(TestIRrecv, IncrementalDecodeOnlyEnabled) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  irrecv.setIncrementalDecode(true);
+  // Nothing longer can share NEC's header now, so it's ready straight away.
+  irrecv.setAllProtocolsEnabled(false);
+  irrecv.setProtocolEnabled(NEC, true);
+  irrecv.enableIRIn();
+  decode_results results;
+  decode_results found[2];
+  uint16_t found_at[2];
+  irsend.reset();
+  irsend.sendNEC(0x20DF10EF);
+  irsend.makeDecodeResult();
+  ASSERT_EQ(1, feedEdges(&irrecv, irsend.capture, &results, found, found_at,
+                         2));
+  EXPECT_EQ(NEC, found[0].decode_type);
+  EXPECT_EQ(0x20DF10EF, found[0].value);
+}
+
+TEST(TestIRrecv, DecodeOrderPrecedence) {
+  IRrecv irrecv(1);
+  EXPECT_TRUE(IRrecv::mustDecodeBefore(NEC, NEC_LIKE));
+  EXPECT_TRUE(IRrecv::mustDecodeBefore(DENON, PANASONIC));
+  EXPECT_FALSE(IRrecv::mustDecodeBefore(PANASONIC, DENON));
+  EXPECT_FALSE(IRrecv::mustDecodeBefore(SONY, RC5));
+  // The fixed order has to obey every rule.
+  uint8_t count = 0;
+  while (irrecv.getDecodeOrder(count) != UNUSED) count++;
+  EXPECT_LT(100, count);
+  for (uint8_t i = 0; i < count; i++)
+    for (uint8_t j = i + 1; j < count; j++)
+      EXPECT_FALSE(IRrecv::mustDecodeBefore(irrecv.getDecodeOrder(j),
+                                            irrecv.getDecodeOrder(i))) <<
+          typeToString(irrecv.getDecodeOrder(j)) << " is after " <<
+          typeToString(irrecv.getDecodeOrder(i));
+}
+
+TEST(TestIRrecv, AdaptiveDecodeOrder) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  // Find a protocol's position in the decode order.
+  auto position = [&irrecv](const decode_type_t protocol) {
+    uint8_t pos = 0;
+    while (irrecv.getDecodeOrder(pos) != protocol) pos++;
+    return pos;
+  };
+  const uint8_t lg = position(LG);
+  const uint8_t samsung = position(SAMSUNG);
+  ASSERT_LT(lg + 1, samsung);
+  EXPECT_FALSE(irrecv.getAdaptiveOrder());
+  ASSERT_TRUE(irrecv.setAdaptiveOrder(true));
+  EXPECT_TRUE(irrecv.getAdaptiveOrder());
+  EXPECT_EQ(samsung, position(SAMSUNG));  // Nothing has been received yet.
+
+  irsend.reset();
+  irsend.sendSAMSUNG(0xE0E09966);
+  irsend.makeDecodeResult();
+  for (uint8_t i = 0; i < 3; i++) {
+    ASSERT_TRUE(irrecv.decode(&irsend.capture));
+    EXPECT_EQ(SAMSUNG, irsend.capture.decode_type);
+    EXPECT_EQ(0xE0E09966, irsend.capture.value);
+  }
+  // It moved up, but not before LG, which always has to be tried first.
+  EXPECT_EQ(lg + 1, position(SAMSUNG));
+  // Other protocols only pass it once they are more popular.
+  irsend.reset();
+  irsend.sendDISH(0x9C00);
+  irsend.makeDecodeResult();
+  for (uint8_t i = 0; i < 3; i++) {
+    ASSERT_TRUE(irrecv.decode(&irsend.capture));
+    EXPECT_EQ(DISH, irsend.capture.decode_type);
+  }
+  EXPECT_GT(position(DISH), position(SAMSUNG));
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_LT(position(DISH), position(SAMSUNG));
+  EXPECT_LT(position(LG), position(SAMSUNG));
+
+  irrecv.resetDecodeOrder();
+  EXPECT_EQ(samsung, position(SAMSUNG));
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  ASSERT_TRUE(irrecv.setAdaptiveOrder(false));
+  EXPECT_FALSE(irrecv.getAdaptiveOrder());
+  EXPECT_EQ(samsung, position(SAMSUNG));
+}
+
+// Captures of what our own senders produce, for (nearly) every protocol.
+static std::vector<std::vector<uint16_t>> senderCorpus(void) {
+  std::vector<std::vector<uint16_t>> corpus;
+  IRsendTest irsend(0);
+  irsend.begin();
+  auto add = [&corpus, &irsend]() {
+    irsend.makeDecodeResult();
+    corpus.push_back(std::vector<uint16_t>(
+        irsend.capture.rawbuf, irsend.capture.rawbuf + irsend.capture.rawlen));
+  };
+  const uint64_t patterns[] = {0x0, 0xA90, 0x20DF10EF, 0xE0E09966,
+                               0x123456789ABCDEF0};
+  IRac irac(kGpioUnused);
+  irac._utReceiver = std::make_shared<IRrecv>(0, 1024);
+  for (int16_t i = 1; i <= kLastDecodeType; i++) {
+    const decode_type_t protocol = static_cast<decode_type_t>(i);
+    const uint16_t nbits = IRsend::defaultBits(protocol);
+    if (!nbits) continue;
+    if (!hasACState(protocol)) {
+      for (const uint64_t data : patterns) {
+        irsend.reset();
+        if (!irsend.send(protocol, data & (UINT64_MAX >> (64 - nbits)), nbits))
+          break;
+        add();
+      }
+    }
+    if (!IRac::isProtocolSupported(protocol)) continue;
+    // Let the A/C classes make a valid message, & send what it decodes as.
+    stdAc::state_t state;
+    IRac::initState(&state);
+    state.protocol = protocol;
+    state.mode = stdAc::opmode_t::kCool;
+    irac._lastDecodeResults = nullptr;  // Not every protocol sets it.
+    irac.sendAc(state, NULL);
+    if (irac._lastDecodeResults == nullptr) continue;
+    const decode_results *result = irac._lastDecodeResults.get();
+    irsend.reset();
+    if (hasACState(result->decode_type))
+      irsend.send(result->decode_type, result->state, result->bits / 8);
+    else
+      irsend.send(result->decode_type, result->value, result->bits);
+    add();
+  }
+  return corpus;
+}
+
+// Decode every capture in a corpus, & describe what they decoded as.
+static std::vector<std::string> decodeCorpus(
+    IRrecv *irrecv, const std::vector<std::vector<uint16_t>> &corpus) {
+  std::vector<std::string> decoded;
+  for (const std::vector<uint16_t> &capture : corpus) {
+    decode_results results;
+    std::vector<uint16_t> rawbuf(capture);
+    results.rawbuf = rawbuf.data();
+    results.rawlen = rawbuf.size();
+    results.overflow = false;
+    if (irrecv->decode(&results))
+      decoded.push_back(resultToHumanReadableBasic(&results) +
+                        resultToSourceCode(&results));
+    else
+      decoded.push_back("");
+  }
+  return decoded;
+}
+
+TEST(TestIRrecv, AdaptiveOrderKeepsResults) {
+  const std::vector<std::vector<uint16_t>> corpus = senderCorpus();
+  ASSERT_LT(150, corpus.size());
+  IRrecv irrecv(1);
+  const std::vector<std::string> expected = decodeCorpus(&irrecv, corpus);
+  std::vector<decode_type_t> fixed;
+  while (irrecv.getDecodeOrder(fixed.size()) != UNUSED)
+    fixed.push_back(irrecv.getDecodeOrder(fixed.size()));
+
+  // Move each protocol in turn as early as it is allowed to go, & let the
+  // corpus itself shuffle the rest.
+  ASSERT_TRUE(irrecv.setAdaptiveOrder(true));
+  for (uint8_t index = 0; index < fixed.size(); index++) {
+    irrecv.resetDecodeOrder();
+    irrecv._hits[index] = 1000;
+    irrecv._noteHit(index);
+    const std::vector<std::string> decoded = decodeCorpus(&irrecv, corpus);
+    for (uint16_t i = 0; i < corpus.size(); i++)
+      ASSERT_EQ(expected[i], decoded[i]) << "Corpus entry #" << i <<
+          " with " << typeToString(fixed[index]) << " moved earlier.";
+  }
+  // Reverse the order as far as it is allowed to go.
+  irrecv.resetDecodeOrder();
+  for (uint8_t index = 0; index < fixed.size(); index++) {
+    irrecv._hits[index] = index;
+    irrecv._noteHit(index);
+  }
+  EXPECT_NE(fixed[0], irrecv.getDecodeOrder(0));
+  const std::vector<std::string> decoded = decodeCorpus(&irrecv, corpus);
+  for (uint16_t i = 0; i < corpus.size(); i++)
+    EXPECT_EQ(expected[i], decoded[i]) << "Corpus entry #" << i;
+  // & it never broke any of the precedence rules.
+  for (uint8_t i = 0; i < fixed.size(); i++)
+    for (uint8_t j = i + 1; j < fixed.size(); j++)
+      EXPECT_FALSE(IRrecv::mustDecodeBefore(irrecv.getDecodeOrder(j),
+                                            irrecv.getDecodeOrder(i)));
+}
+
+TEST(TestIRrecv, DecodeCandidates) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  decode_candidate_t candidates[4];
+  EXPECT_EQ(0, irrecv.getCandidateCount());
+  irrecv.setCandidates(candidates, 4);
+
+  // A NEC message also decodes as NEC_LIKE. They fit it equally well.
+  irsend.reset();
+  irsend.sendNEC(0x20DF10EF);
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  EXPECT_EQ(0x20DF10EF, irsend.capture.value);
+  ASSERT_EQ(2, irrecv.getCandidateCount());
+  EXPECT_EQ(NEC, candidates[0].result.decode_type);
+  EXPECT_EQ(0x20DF10EF, candidates[0].result.value);
+  EXPECT_EQ(NEC_LIKE, candidates[1].result.decode_type);
+  EXPECT_EQ(candidates[0].score, candidates[1].score);
+  EXPECT_LT(85, candidates[0].score);
+  EXPECT_GT(kMaxCandidateScore, candidates[0].score);
+  // The budget limits how many are looked for.
+  irrecv.setCandidates(candidates, 1);
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  EXPECT_EQ(1, irrecv.getCandidateCount());
+  irrecv.setCandidates(candidates, 4);
+
+  // A perfect match can't be beaten, so nothing else is tried.
+  uint16_t rawbuf[kRawBuf];
+  decode_results results;
+  results.rawbuf = rawbuf;
+  results.rawlen = necCapture(rawbuf, 0x20DF10EF);
+  results.overflow = false;
+  // Allow for the mark excess a real receiver has.
+  for (uint16_t i = 1; i < results.rawlen; i++)
+    rawbuf[i] += (i % 2) ? kMarkExcess / kRawTick : -kMarkExcess / kRawTick;
+  rawbuf[results.rawlen] = 0;
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  ASSERT_EQ(1, irrecv.getCandidateCount());
+  EXPECT_EQ(kMaxCandidateScore, candidates[0].score);
+  // A sloppier capture of the same message scores lower.
+  for (uint16_t i = 3; i < results.rawlen; i += 4) rawbuf[i] += 20;
+  ASSERT_TRUE(irrecv.decode(&results));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(2, irrecv.getCandidateCount());
+  EXPECT_GT(kMaxCandidateScore, candidates[0].score);
+
+  // A fast Epson message also looks like a Pioneer one. Pioneer is tried
+  // first, but Epson's decoder fits it better.
+  irsend.reset();
+  irsend.sendEpson(0x20DF10EF);
+  irsend.makeDecodeResult();
+  for (uint16_t i = 1; i < irsend.capture.rawlen; i++)
+    irsend.capture.rawbuf[i] = irsend.capture.rawbuf[i] * 95 / 100;
+  irrecv.setCandidates(NULL, 0);
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(PIONEER, irsend.capture.decode_type);
+  EXPECT_EQ(0, irrecv.getCandidateCount());
+  irrecv.setCandidates(candidates, 4);
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(EPSON, irsend.capture.decode_type);
+  EXPECT_EQ(0x20DF10EF, irsend.capture.value);
+  ASSERT_EQ(4, irrecv.getCandidateCount());
+  EXPECT_EQ(EPSON, candidates[0].result.decode_type);
+  EXPECT_EQ(PIONEER, candidates[1].result.decode_type);
+  EXPECT_GT(candidates[0].score, candidates[1].score);
+  // NEC fits it just as well, but Epson must be tried before NEC.
+  EXPECT_EQ(NEC, candidates[2].result.decode_type);
+  EXPECT_EQ(candidates[0].score, candidates[2].score);
+}
+
+TEST(TestIRrecv, DecodeCandidatesKeepPrecedence) {
+  // Where protocols have to be tried in a given order, the ranking keeps it.
+  const std::vector<std::vector<uint16_t>> corpus = senderCorpus();
+  IRrecv irrecv(1);
+  const std::vector<std::string> expected = decodeCorpus(&irrecv, corpus);
+  decode_candidate_t candidates[8];
+  irrecv.setCandidates(candidates, 8);
+  const std::vector<std::string> decoded = decodeCorpus(&irrecv, corpus);
+  for (uint16_t i = 0; i < corpus.size(); i++)
+    EXPECT_EQ(expected[i], decoded[i]) << "Corpus entry #" << i;
+}
+
+TEST(TestIRrecv, SharedBitRuns) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  irsend.reset();
+  irsend.sendNEC(0x20DF10EF);
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  EXPECT_EQ(0x20DF10EF, irsend.capture.value);
+  // The NEC family decoders tried before it read the bits it used.
+  bool found = false;
+  for (uint8_t i = 0; i < irrecv._bit_run_count; i++) {
+    const bit_run_t &run = irrecv._bit_runs[i];
+    if (run.start != irsend.capture.rawbuf + kStartOffset + 2 ||
+        run.nbits < kNECBits) continue;
+    EXPECT_EQ(0x20DF10EF, run.bits >> (run.nbits - kNECBits));
+    found = true;
+  }
+  EXPECT_TRUE(found);
+  EXPECT_FALSE(irrecv._bit_runs_active);
+
+  // Decoders called directly never use them, as the capture may have changed.
+  irsend.reset();
+  irsend.sendNEC(irsend.encodeNEC(0x4, 0x8));
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decodeNEC(&irsend.capture));
+  EXPECT_EQ(irsend.encodeNEC(0x4, 0x8), irsend.capture.value);
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  EXPECT_EQ(irsend.encodeNEC(0x4, 0x8), irsend.capture.value);
+}
+
+TEST(TestIRrecv, SharedBitRunsKeepResults) {
+  const std::vector<std::vector<uint16_t>> corpus = senderCorpus();
+  IRrecv irrecv(1);
+  irrecv._bit_run_slots = 0;  // Every decoder classifies the bits itself.
+  const std::vector<std::string> expected = decodeCorpus(&irrecv, corpus);
+  for (uint8_t slots = 1; slots <= kBitRunCacheSize; slots++) {
+    irrecv._bit_run_slots = slots;
+    irrecv._bit_run_next = 0;
+    const std::vector<std::string> decoded = decodeCorpus(&irrecv, corpus);
+    for (uint16_t i = 0; i < corpus.size(); i++)
+      ASSERT_EQ(expected[i], decoded[i]) << "Corpus entry #" << i <<
+          " using " << static_cast<int>(slots) << " slot(s).";
+  }
+}
+
+TEST(TestIRrecv, DecodeBudget) {
+  const std::vector<std::vector<uint16_t>> corpus = senderCorpus();
+  IRrecv irrecv(1);
+  const uint16_t noise_floor = 100;  // So we know it's only filtered once.
+  std::vector<std::string> expected;
+  for (const std::vector<uint16_t> &capture : corpus) {
+    std::vector<uint16_t> rawbuf(capture);
+    decode_results results;
+    results.rawbuf = rawbuf.data();
+    results.rawlen = rawbuf.size();
+    results.overflow = false;
+    expected.push_back(irrecv.decode(&results, NULL, 1, noise_floor) ?
+                       resultToSourceCode(&results) : "");
+  }
+  EXPECT_FALSE(irrecv.isDecodePending());
+  irrecv.setDecodeBudget(0, 3);
+  uint32_t calls = 0;
+  for (uint16_t i = 0; i < corpus.size(); i++) {
+    std::vector<uint16_t> rawbuf(corpus[i]);
+    decode_results results;
+    results.rawbuf = rawbuf.data();
+    results.rawlen = rawbuf.size();
+    results.overflow = false;
+    bool decoded;
+    do {
+      calls++;
+      decoded = irrecv.decode(&results, NULL, 1, noise_floor);
+    } while (!decoded && irrecv.isDecodePending());
+    EXPECT_EQ(expected[i], decoded ? resultToSourceCode(&results) : "") <<
+        "Corpus entry #" << i;
+  }
+  EXPECT_LT(corpus.size() * 5, calls);  // It was done in many small slices.
+
+  // resume() abandons what is pending.
+  IRsendTest irsend(0);
+  irsend.begin();
+  irsend.reset();
+  irsend.sendSAMSUNG(0xE0E09966);
+  irsend.makeDecodeResult();
+  irrecv.setDecodeBudget(0, 1);
+  EXPECT_FALSE(irrecv.decode(&irsend.capture));
+  EXPECT_TRUE(irrecv.isDecodePending());
+  irrecv.resume();
+  EXPECT_FALSE(irrecv.isDecodePending());
+  // No limit, or a time budget that the (simulated) clock never reaches.
+  irrecv.setDecodeBudget(1000000);
+  EXPECT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_FALSE(irrecv.isDecodePending());
+  EXPECT_EQ(SAMSUNG, irsend.capture.decode_type);
+  // decodeAs() is never cut short.
+  irrecv.setDecodeBudget(0, 1);
+  EXPECT_TRUE(irrecv.decodeAs(&irsend.capture, SAMSUNG));
+  EXPECT_FALSE(irrecv.isDecodePending());
+}
+
+TEST(TestDecode, DecodeProtocol) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+
+  irsend.reset();
+  irsend.sendNEC(0x4BB640BF);
+  irsend.makeDecodeResult();
+  // The right protocol.
+  EXPECT_TRUE(irrecv._decodeProtocol(&irsend.capture, NEC, kStartOffset));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  EXPECT_EQ(kNECBits, irsend.capture.bits);
+  EXPECT_EQ(0x4BB640BF, irsend.capture.value);
+  // The wrong protocols.
+  EXPECT_FALSE(irrecv._decodeProtocol(&irsend.capture, SONY, kStartOffset));
+  EXPECT_FALSE(irrecv._decodeProtocol(&irsend.capture, RC5, kStartOffset));
+  // Things that aren't decoders.
+  EXPECT_FALSE(irrecv._decodeProtocol(&irsend.capture, UNKNOWN, kStartOffset));
+  EXPECT_FALSE(irrecv._decodeProtocol(&irsend.capture, RAW, kStartOffset));
+  // A NEC-like entry relabels the result.
+  EXPECT_TRUE(irrecv._decodeProtocol(&irsend.capture, NEC_LIKE, kStartOffset));
+  EXPECT_EQ(NEC_LIKE, irsend.capture.decode_type);
+  EXPECT_EQ(0x4BB640BF, irsend.capture.value);
+}
+
+// The cheap header pre-checks in decode() must follow the user's tolerance.
+TEST(TestDecode, CanEndAfter) {
+  IRrecv irrecv(1);
+  uint16_t rawbuf[10] = {0, 100, 100, 50, 50, 50, 150, 50, 5000, 50};
+  decode_results results;
+  results.rawbuf = rawbuf;
+  results.rawlen = 10;
+  const uint16_t start = kStartOffset + kHeader;
+  EXPECT_FALSE(irrecv._canEndAfter(&results, start, 1, 8000));  // 300us.
+  EXPECT_TRUE(irrecv._canEndAfter(&results, start, 2, 8000));  // 10000us.
+  EXPECT_FALSE(irrecv._canEndAfter(&results, start, 2, 20000));
+  EXPECT_TRUE(irrecv._canEndAfter(&results, start, 3, 8000));  // The end.
+  EXPECT_FALSE(irrecv._canEndAfter(&results, start, 4, 8000));  // Too short.
+  rawbuf[8] = 0;  // Treated as infinite, like matchAtLeast() does.
+  EXPECT_TRUE(irrecv._canEndAfter(&results, start, 2, 20000));
+}
+
+TEST(TestDecode, MultiLengthFamilies) {
+  // Each size is decoded by a single pass of its family's decoder table entry.
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  std::vector<std::vector<uint16_t>> captures;
+  auto add = [&captures, &irsend]() {
+    irsend.makeDecodeResult();
+    captures.push_back(std::vector<uint16_t>(
+        irsend.capture.rawbuf, irsend.capture.rawbuf + irsend.capture.rawlen));
+    irsend.reset();
+  };
+  irsend.reset();
+  IRHitachiAc344 ac344(kGpioUnused);
+  irsend.sendHitachiAc344(ac344.getRaw());
+  add();
+  IRHitachiAc264 ac264(kGpioUnused);
+  irsend.sendHitachiAc264(ac264.getRaw());
+  add();
+  const uint8_t ac2[kHitachiAc2StateLength] = {0x80, 0x08, 0x0C};
+  irsend.sendHitachiAC2(ac2);
+  add();
+  IRHitachiAc ac(kGpioUnused);
+  irsend.sendHitachiAC(ac.getRaw());
+  add();
+  IRHitachiAc1 ac1(kGpioUnused);
+  irsend.sendHitachiAC1(ac1.getRaw());
+  add();
+  const uint8_t samsung[kSamsungAcExtendedStateLength] = {
+      0x02, 0xB2, 0x0F, 0x00, 0x00, 0x00, 0xC0,
+      0x01, 0xD2, 0x0F, 0x00, 0x00, 0x00, 0x00,
+      0x01, 0x02, 0xFF, 0x71, 0x80, 0x11, 0xC0};
+  irsend.sendSamsungAC(samsung, kSamsungAcExtendedStateLength);
+  add();
+  IRSamsungAc samsung_ac(kGpioUnused);
+  irsend.sendSamsungAC(samsung_ac.getRaw(), kSamsungAcStateLength);
+  add();
+  irsend.sendPanasonic64(0x40040190ED7C);
+  add();
+  irsend.sendPanasonic64(0x344A90FC6C, kPanasonic40Bits);
+  add();
+  irsend.sendLG(0x4B4AE51, kLgBits);
+  add();
+  irsend.sendLG(0xB4B4AE51, kLg32Bits);
+  add();
+  const decode_type_t expected[] = {
+      HITACHI_AC344, HITACHI_AC264, HITACHI_AC2, HITACHI_AC, HITACHI_AC1,
+      SAMSUNG_AC, SAMSUNG_AC, PANASONIC, PANASONIC, LG, LG};
+  const uint16_t bits[] = {
+      kHitachiAc344Bits, kHitachiAc264Bits, kHitachiAc2Bits, kHitachiAcBits,
+      kHitachiAc1Bits, kSamsungAcExtendedBits, kSamsungAcBits, kPanasonicBits,
+      kPanasonic40Bits, kLgBits, kLg32Bits};
+  ASSERT_EQ(sizeof(bits) / sizeof(bits[0]), captures.size());
+  for (uint8_t i = 0; i < captures.size(); i++) {
+    decode_results results;
+    results.rawbuf = captures[i].data();
+    results.rawlen = captures[i].size();
+    results.overflow = false;
+    ASSERT_TRUE(irrecv.decode(&results)) << "Capture #" << +i;
+    EXPECT_EQ(expected[i], results.decode_type) << "Capture #" << +i;
+    EXPECT_EQ(bits[i], results.bits) << "Capture #" << +i;
+    // decodeAs() finds it through the family's entry too.
+    const std::string source = resultToSourceCode(&results);
+    ASSERT_TRUE(irrecv.decodeAs(&results, expected[i])) << "Capture #" << +i;
+    EXPECT_EQ(source, resultToSourceCode(&results)) << "Capture #" << +i;
+  }
+}
+
+TEST(TestDecode, HeaderEnvelopeFollowsTolerance) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+
+  irsend.reset();
+  // A NEC message with a header mark 50% longer than it should be.
+  irsend.sendGeneric(8960 * 1.5, 4480, 560, 1690, 560, 560, 560, 40000,
+                     0x4BB640BF, kNECBits, 38, true, 0, 33);
+  irsend.makeDecodeResult();
+  // Way out of the default tolerance.
+  EXPECT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_NE(NEC, irsend.capture.decode_type);
+  // But not of a very lax one.
+  irrecv.setTolerance(60);
+  EXPECT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(NEC, irsend.capture.decode_type);
+  EXPECT_EQ(kNECBits, irsend.capture.bits);
+  EXPECT_EQ(0x4BB640BF, irsend.capture.value);
+}
+
 TEST(TestCrudeNoiseFilter, General) {
   IRsendTest irsend(0);
   IRrecv irrecv(1);
@@ -1701,6 +3416,136 @@ TEST(TestCrudeNoiseFilter, NoiseAtEndOfSample) {
       resultToSourceCode(&irsend.capture));
 }
 
+// The original quadratic version of IRrecv::crudeNoiseFilter(), as a reference.
+static void quadraticNoiseFilter(decode_results *results, const uint16_t floor,
+                                 const uint16_t bufsize) {
+  const uint16_t kTickFloor = floor / kRawTick;
+  uint16_t offset = kStartOffset;
+  while (offset < results->rawlen && offset + 2 < bufsize) {
+    uint16_t curr = results->rawbuf[offset];
+    uint16_t next = results->rawbuf[offset + 1];
+    uint16_t addition = curr + next;
+    if (curr < kTickFloor) {
+      for (uint16_t i = offset + 2; i <= results->rawlen && i < bufsize; i++)
+        results->rawbuf[i - 2] = results->rawbuf[i];
+      if (offset > 1) results->rawbuf[offset - 1] += addition;
+      results->rawlen -= 2;
+    } else {
+      offset++;
+    }
+  }
+}
+
+// Make a noisy capture. Roughly 1 in `odds` pulses is a glitch.
+static uint16_t noisyCapture(uint16_t *rawbuf, const uint16_t rawlen,
+                             const uint8_t odds, uint32_t *seed) {
+  rawbuf[0] = 0;
+  for (uint16_t i = 1; i < rawlen; i++) {
+    *seed = *seed * 1103515245 + 12345;
+    const uint16_t rand = *seed >> 16;
+    rawbuf[i] = (rand % odds) ? 200 + rand % 800 : 1 + rand % 40;
+  }
+  rawbuf[rawlen] = 0;
+  return rawlen;
+}
+
+TEST(TestCrudeNoiseFilter, LargeNoisyCaptures) {
+  const uint16_t kSize = 2000;
+  IRrecv irrecv(1, kSize + 1);
+  uint16_t expected[kSize + 1];
+  uint16_t actual[kSize + 1];
+  uint32_t seed = 42;
+  for (uint8_t odds = 2; odds <= 10; odds++) {
+    for (uint16_t rawlen : {kSize, (uint16_t)1001, (uint16_t)1500}) {
+      decode_results reference;
+      reference.rawbuf = expected;
+      reference.rawlen = noisyCapture(expected, rawlen, odds, &seed);
+      decode_results results;
+      results.rawbuf = actual;
+      results.rawlen = rawlen;
+      for (uint16_t i = 0; i <= rawlen; i++) actual[i] = expected[i];
+      quadraticNoiseFilter(&reference, 100, irrecv.getBufSize());
+      irrecv.crudeNoiseFilter(&results, 100);
+      ASSERT_EQ(reference.rawlen, results.rawlen);
+      EXPECT_LT(results.rawlen, rawlen);
+      for (uint16_t i = 0; i <= results.rawlen; i++)
+        ASSERT_EQ(expected[i], actual[i]) << "Entry #" << i;
+    }
+  }
+  // Up against the end of the buffer.
+  decode_results reference;
+  reference.rawbuf = expected;
+  reference.rawlen = noisyCapture(expected, kSize + 1, 3, &seed);
+  decode_results results;
+  results.rawbuf = actual;
+  results.rawlen = reference.rawlen;
+  for (uint16_t i = 0; i <= kSize; i++) actual[i] = expected[i];
+  quadraticNoiseFilter(&reference, 100, irrecv.getBufSize());
+  irrecv.crudeNoiseFilter(&results, 100);
+  ASSERT_EQ(reference.rawlen, results.rawlen);
+  for (uint16_t i = 0; i < results.rawlen; i++)
+    ASSERT_EQ(expected[i], actual[i]) << "Entry #" << i;
+}
+
+TEST(TestCrudeNoiseFilter, SpikeFilter) {
+  IRrecv irrecv(1);
+  EXPECT_EQ(kNoiseFilterMerge, irrecv.getNoiseFilter());
+  irrecv.setNoiseFilter(kNoiseFilterSpike);
+  EXPECT_EQ(kNoiseFilterSpike, irrecv.getNoiseFilter());
+  uint16_t clean[kRawBuf];
+  uint16_t rawbuf[kRawBuf];
+  const uint16_t len = necCapture(clean, 0x20DF10EF);
+  // Split a space (#4) & a mark (#9) with a spike each.
+  uint16_t rawlen = 0;
+  for (uint16_t i = 0; i < len; i++) {
+    if (i == 4 || i == 9) {
+      rawbuf[rawlen++] = clean[i] - 40;
+      rawbuf[rawlen++] = 30 / kRawTick;
+      rawbuf[rawlen++] = 40 - 30 / kRawTick;
+    } else {
+      rawbuf[rawlen++] = clean[i];
+    }
+  }
+  rawbuf[rawlen] = 0;
+  decode_results results;
+  results.rawbuf = rawbuf;
+  results.rawlen = rawlen;
+  results.overflow = false;
+  ASSERT_TRUE(irrecv.decodeCapture(&results, 0, 0));
+  EXPECT_NE(NEC, results.decode_type);
+  // The spikes are removed, & the pulses are exactly what they were.
+  ASSERT_TRUE(irrecv.decodeCapture(&results, 0, 50));
+  EXPECT_EQ(NEC, results.decode_type);
+  EXPECT_EQ(0x20DF10EF, results.value);
+  ASSERT_EQ(len, results.rawlen);
+  for (uint16_t i = 0; i < len; i++) EXPECT_EQ(clean[i], rawbuf[i]);
+
+  // A burst of short pulses isn't a spike, so it is left alone.
+  const uint16_t burst[] = {0, 300, 300, 10, 10, 10, 300, 300};
+  const uint16_t burst_len = sizeof(burst) / sizeof(burst[0]);
+  for (uint16_t i = 0; i < burst_len; i++) rawbuf[i] = burst[i];
+  rawbuf[burst_len] = 0;
+  results.rawlen = burst_len;
+  irrecv.crudeNoiseFilter(&results, 100);
+  ASSERT_EQ(burst_len, results.rawlen);
+  for (uint16_t i = 0; i < burst_len; i++) EXPECT_EQ(burst[i], rawbuf[i]);
+  // Short pulses at either end aren't either.
+  const uint16_t ends[] = {0, 10, 300, 300, 300, 10};
+  const uint16_t ends_len = sizeof(ends) / sizeof(ends[0]);
+  for (uint16_t i = 0; i < ends_len; i++) rawbuf[i] = ends[i];
+  rawbuf[ends_len] = 0;
+  results.rawlen = ends_len;
+  irrecv.crudeNoiseFilter(&results, 100);
+  ASSERT_EQ(ends_len, results.rawlen);
+  // Whereas the default filter removes all of them.
+  irrecv.setNoiseFilter(kNoiseFilterMerge);
+  for (uint16_t i = 0; i < burst_len; i++) rawbuf[i] = burst[i];
+  rawbuf[burst_len] = 0;
+  results.rawlen = burst_len;
+  irrecv.crudeNoiseFilter(&results, 100);
+  EXPECT_EQ(burst_len - 4, results.rawlen);
+}
+
 TEST(TestManchesterCode, matchManchester) {
   IRsendTest irsend(0);
   IRrecv irrecv(0);
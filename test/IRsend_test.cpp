@@ -239,18 +239,18 @@ TEST(TestLowLevelSend, MarkFrequencyModulationAt38kHz) {
 
   irsend.reset();
   irsend.enableIROut(38000, 50);
-  EXPECT_EQ(5, irsend.mark(100));
+  EXPECT_EQ(4, irsend.mark(100));
   EXPECT_EQ(
-      "[On]10usecs[Off]11usecs[On]10usecs[Off]11usecs[On]10usecs[Off]11usecs"
-      "[On]10usecs[Off]11usecs[On]10usecs[Off]6usecs",
+      "[On]13usecs[Off]13usecs[On]13usecs[Off]13usecs[On]13usecs[Off]13usecs"
+      "[On]13usecs[Off]9usecs",
       irsend.low_level_sequence);
 
   irsend.reset();
   irsend.enableIROut(38000, 33);
-  EXPECT_EQ(5, irsend.mark(100));
+  EXPECT_EQ(4, irsend.mark(100));
   EXPECT_EQ(
-      "[On]6usecs[Off]15usecs[On]6usecs[Off]15usecs[On]6usecs[Off]15usecs"
-      "[On]6usecs[Off]15usecs[On]6usecs[Off]10usecs",
+      "[On]8usecs[Off]18usecs[On]8usecs[Off]18usecs[On]8usecs[Off]18usecs"
+      "[On]8usecs[Off]14usecs",
       irsend.low_level_sequence);
 
   irsend.reset();
@@ -266,18 +266,18 @@ TEST(TestLowLevelSend, MarkFrequencyModulationAt36_7kHz) {
 
   irsend.reset();
   irsend.enableIROut(36700, 50);
-  EXPECT_EQ(5, irsend.mark(100));
+  EXPECT_EQ(4, irsend.mark(100));
   EXPECT_EQ(
-      "[On]11usecs[Off]11usecs[On]11usecs[Off]11usecs[On]11usecs[Off]11usecs"
-      "[On]11usecs[Off]11usecs[On]11usecs[Off]1usecs",
+      "[On]13usecs[Off]14usecs[On]13usecs[Off]14usecs[On]13usecs[Off]14usecs"
+      "[On]13usecs[Off]6usecs",
       irsend.low_level_sequence);
 
   irsend.reset();
   irsend.enableIROut(36700, 33);
-  EXPECT_EQ(5, irsend.mark(100));
+  EXPECT_EQ(4, irsend.mark(100));
   EXPECT_EQ(
-      "[On]7usecs[Off]15usecs[On]7usecs[Off]15usecs[On]7usecs[Off]15usecs"
-      "[On]7usecs[Off]15usecs[On]7usecs[Off]5usecs",
+      "[On]8usecs[Off]19usecs[On]8usecs[Off]19usecs[On]8usecs[Off]19usecs"
+      "[On]8usecs[Off]11usecs",
       irsend.low_level_sequence);
 
   irsend.reset();
@@ -293,18 +293,18 @@ TEST(TestLowLevelSend, MarkFrequencyModulationAt40kHz) {
 
   irsend.reset();
   irsend.enableIROut(40000, 50);
-  EXPECT_EQ(5, irsend.mark(100));
+  EXPECT_EQ(4, irsend.mark(100));
   EXPECT_EQ(
-      "[On]10usecs[Off]10usecs[On]10usecs[Off]10usecs[On]10usecs[Off]10usecs"
-      "[On]10usecs[Off]10usecs[On]10usecs[Off]10usecs",
+      "[On]12usecs[Off]13usecs[On]12usecs[Off]13usecs[On]12usecs[Off]13usecs"
+      "[On]12usecs[Off]13usecs",
       irsend.low_level_sequence);
 
   irsend.reset();
   irsend.enableIROut(40000, 33);
-  EXPECT_EQ(5, irsend.mark(100));
+  EXPECT_EQ(4, irsend.mark(100));
   EXPECT_EQ(
-      "[On]6usecs[Off]14usecs[On]6usecs[Off]14usecs[On]6usecs[Off]14usecs"
-      "[On]6usecs[Off]14usecs[On]6usecs[Off]14usecs",
+      "[On]8usecs[Off]17usecs[On]8usecs[Off]17usecs[On]8usecs[Off]17usecs"
+      "[On]8usecs[Off]17usecs",
       irsend.low_level_sequence);
 
   irsend.reset();
@@ -379,6 +379,84 @@ TEST(TestLowLevelSend, SpaceNoModulation) {
   EXPECT_EQ("[Off]1000usecs", irsend.low_level_sequence);
 }
 
+TEST(TestLowLevelSend, MarkDoesNotDrift) {
+  IRsendSlowLed irsend(0);
+  irsend.begin();
+
+  irsend.reset();
+  irsend.enableIROut(38000, 50);
+  // The time lost is made up within each cycle, so they stay 26us apart.
+  EXPECT_EQ(4, irsend.mark(100));
+  EXPECT_EQ(
+      "[On]10usecs[Off]13usecs[On]10usecs[Off]13usecs[On]10usecs[Off]13usecs"
+      "[On]10usecs[Off]9usecs",
+      irsend.low_level_sequence);
+
+  // Even over the longest mark.
+  irsend.reset();
+  const uint32_t start = _IRtimer_unittest_now;
+  EXPECT_EQ(2521, irsend.mark(UINT16_MAX));
+  EXPECT_EQ(UINT16_MAX, _IRtimer_unittest_now - start);
+}
+
+TEST(TestLowLevelSend, Calibrations) {
+  IRsendLowLevelTest irsend(0);
+  irsend.begin();
+  // As if restored at boot.
+  send_calibration_t table[3] = {{38000, 50, -3}, {36000, 25, 2}, {0, 0, 0}};
+  irsend.setCalibrations(table, 3);
+
+  irsend.reset();
+  irsend.enableIROut(38000, 50);  // 26 - 3 = 23us periods.
+  EXPECT_EQ(5, irsend.mark(100));
+  EXPECT_EQ(
+      "[On]11usecs[Off]12usecs[On]11usecs[Off]12usecs[On]11usecs[Off]12usecs"
+      "[On]11usecs[Off]12usecs[On]8usecs[Off]",
+      irsend.low_level_sequence);
+  irsend.reset();
+  irsend.enableIROut(36, 25);  // 28 + 2 = 30us periods.
+  EXPECT_EQ(4, irsend.mark(100));
+  EXPECT_EQ(
+      "[On]7usecs[Off]23usecs[On]7usecs[Off]23usecs[On]7usecs[Off]23usecs"
+      "[On]7usecs[Off]3usecs",
+      irsend.low_level_sequence);
+  // Anything else uses the default offset. i.e. None.
+  irsend.reset();
+  irsend.enableIROut(38000, 33);
+  EXPECT_EQ(4, irsend.mark(100));
+  EXPECT_EQ(
+      "[On]8usecs[Off]18usecs[On]8usecs[Off]18usecs[On]8usecs[Off]18usecs"
+      "[On]8usecs[Off]14usecs",
+      irsend.low_level_sequence);
+
+  // Calibrating a new carrier adds it to the table.
+  EXPECT_EQ(0, irsend.calibrate(40));
+  EXPECT_EQ(40000, table[2].freq);
+  EXPECT_EQ(50, table[2].duty);
+  EXPECT_EQ(0, table[2].offset);
+  // Once it is full, it becomes the default offset instead.
+  EXPECT_EQ(0, irsend.calibrate(36700));
+  EXPECT_EQ(38000, table[0].freq);
+  EXPECT_EQ(-3, table[0].offset);
+  irsend.reset();
+  irsend.enableIROut(36700, 50);  // 27us periods.
+  EXPECT_EQ(4, irsend.mark(100));
+  EXPECT_EQ(
+      "[On]13usecs[Off]14usecs[On]13usecs[Off]14usecs[On]13usecs[Off]14usecs"
+      "[On]13usecs[Off]6usecs",
+      irsend.low_level_sequence);
+
+  // Without the table.
+  irsend.setCalibrations(NULL, 3);
+  irsend.reset();
+  irsend.enableIROut(38000, 50);
+  EXPECT_EQ(4, irsend.mark(100));
+  EXPECT_EQ(
+      "[On]13usecs[Off]13usecs[On]13usecs[Off]13usecs[On]13usecs[Off]13usecs"
+      "[On]13usecs[Off]9usecs",
+      irsend.low_level_sequence);
+}
+
 // Test expected to work/produce a message for simple irsend:send()
 TEST(TestSend, GenericSimpleSendMethod) {
   IRsendTest irsend(0);
@@ -863,3 +941,392 @@ TEST(TestSendManchester, SendOverLargeData) {
       "m300",
       irsend.outputStr());
 }
+
+// Tests for setRenderBuffer() & emit().
+
+// Render a message, emit() it, & check it is the same as sending it directly.
+static void checkRender(const std::function<void(IRsend *)> &send) {
+  IRsend render(0);
+  IRsendTest irsend(0);
+  render.begin();
+  irsend.begin();
+  uint32_t buffer[1000];
+  render.setRenderBuffer(buffer, 1000);
+  send(&render);
+  EXPECT_FALSE(render.getRenderOverflow());
+  send(&irsend);
+  const std::string expected = irsend.outputStr();
+  ASSERT_NE("", expected);
+  irsend.emit(buffer, render.getRenderLength());
+  EXPECT_EQ(expected, irsend.outputStr());
+}
+
+TEST(TestRender, SameAsSending) {
+  checkRender([](IRsend *irsend) {
+    irsend->sendData(1, 2, 3, 4, 0b1011, 4, true); });
+  checkRender([](IRsend *irsend) {
+    irsend->sendManchester(100, 200, 1, 300, 1000, 0x1234567890ABCDEF, 64, 38,
+                           true, 2); });
+  // Uses sendGeneric() with a minimum message time.
+  checkRender([](IRsend *irsend) { irsend->sendNEC(0x20DF10EF, 32, 2); });
+  checkRender([](IRsend *irsend) { irsend->sendSony(0xA90, 12, 2); });
+  // Uses sendGeneric() with an array of bytes.
+  checkRender([](IRsend *irsend) {
+    const uint8_t state[4] = {0x12, 0x34, 0x56, 0x78};
+    irsend->sendGeneric(3000, 1500, 400, 1200, 400, 400, 400, 20000, state, 4,
+                        38000, false, 1, 33); });
+  checkRender([](IRsend *irsend) {
+    const uint16_t raw[5] = {8950, 4500, 550, 1650, 600};
+    irsend->sendRaw(raw, 5, 38); });
+  checkRender([](IRsend *irsend) {
+    uint16_t gc[13] = {38000, 2, 5, 342, 171, 21, 64, 21, 875, 342, 171, 21,
+                       3565};
+    irsend->sendGC(gc, 13); });
+  checkRender([](IRsend *irsend) {
+    uint16_t pronto[10] = {0x0000, 0x0067, 0x0001, 0x0001, 0x0001,
+                           0x0002, 0x0003, 0x0004, 0x5, 0x6};
+    irsend->sendPronto(pronto, 10, 1); });
+}
+
+TEST(TestRender, Format) {
+  IRsend irsend(0);
+  irsend.begin();
+  uint32_t buffer[100];
+  irsend.setRenderBuffer(buffer, 100);
+  EXPECT_EQ(0, irsend.getRenderLength());
+  irsend.sendGeneric(9000, 4500, 560, 1690, 560, 560, 560, 40000, 0xA, 4,
+                     38, true, 2, 50);
+  // The carrier, then three copies of the message.
+  ASSERT_EQ(1 + 3 * 12, irsend.getRenderLength());
+  EXPECT_FALSE(irsend.getRenderOverflow());
+  EXPECT_EQ(kRenderCarrier | 38000 | (50 << kRenderDutyShift), buffer[0]);
+  EXPECT_EQ(kRenderMark | 9000, buffer[1]);
+  EXPECT_EQ(kRenderSpace | 4500, buffer[2]);
+  EXPECT_EQ(kRenderMark | 560, buffer[3]);
+  EXPECT_EQ(kRenderSpace | 1690, buffer[4]);
+  EXPECT_EQ(kRenderSpace | 40000, buffer[12]);
+  for (uint16_t i = 1; i <= 12; i++) {
+    EXPECT_EQ(buffer[i], buffer[i + 12]);
+    EXPECT_EQ(buffer[i], buffer[i + 24]);
+  }
+
+  // Adjoining spaces are merged, & so are carrier changes.
+  irsend.setRenderBuffer(buffer, 100);
+  irsend.enableIROut(36);
+  irsend.enableIROut(40, 33);
+  irsend.space(100);
+  irsend.space(0);
+  irsend.space(200);
+  irsend.mark(0);
+  ASSERT_EQ(2, irsend.getRenderLength());
+  EXPECT_EQ(kRenderCarrier | 40000 | (33 << kRenderDutyShift), buffer[0]);
+  EXPECT_EQ(kRenderSpace | 300, buffer[1]);
+
+  // Running out of room.
+  irsend.setRenderBuffer(buffer, 10);
+  irsend.sendNEC(0x20DF10EF);
+  EXPECT_EQ(10, irsend.getRenderLength());
+  EXPECT_TRUE(irsend.getRenderOverflow());
+  irsend.setRenderBuffer(buffer, 10);
+  EXPECT_FALSE(irsend.getRenderOverflow());
+
+  // Back to sending.
+  irsend.setRenderBuffer(NULL, 0);
+  irsend.space(100);
+  EXPECT_EQ(0, irsend.getRenderLength());
+}
+
+// Tests for sendAsync().
+
+TEST(TestSendAsync, PlaysBackOnTheVirtualClock) {
+  IRsend render(0);
+  uint32_t buffer[300];
+  render.setRenderBuffer(buffer, 300);
+  render.sendNEC(0x20DF10EF, kNECBits, 1);  // A message & a repeat code.
+  const uint16_t length = render.getRenderLength();
+
+  IRsendTest irsend(0);
+  irsend.begin();
+  EXPECT_EQ(0, irsend.getSendQueueSize());
+  EXPECT_EQ(kNoSendJob, irsend.sendAsync(buffer, length));  // It's off.
+  ASSERT_TRUE(irsend.setSendQueueSize(2));
+  EXPECT_EQ(2, irsend.getSendQueueSize());
+  uint16_t finished = kNoSendJob;
+  const uint16_t job = irsend.sendAsync(
+      buffer, length, 0, [&finished](const uint16_t id) { finished = id; });
+  ASSERT_NE(kNoSendJob, job);
+  // Nothing is sent until handleSend() is called.
+  EXPECT_EQ(kSendQueued, irsend.getSendStatus(job));
+  EXPECT_EQ(1, irsend.getSendsPending());
+  EXPECT_EQ("", irsend.outputStr());
+  EXPECT_FALSE(irsend.setSendQueueSize(4));  // Not while it has sends.
+
+  // The message is sent. The gap after it is left to the timer.
+  irsend._advanceAsync(0);
+  EXPECT_EQ(kSendActive, irsend.getSendStatus(job));
+  EXPECT_EQ(
+      "f38000d33"
+      "m8960s4480"
+      "m560s560m560s560m560s1680m560s560m560s560m560s560m560s560m560s560"
+      "m560s1680m560s1680m560s560m560s1680m560s1680m560s1680m560s1680m560s1680"
+      "m560s560m560s560m560s560m560s1680m560s560m560s560m560s560m560s560"
+      "m560s1680m560s1680m560s1680m560s560m560s1680m560s1680m560s1680m560s1680"
+      "m560", irsend.outputStr());
+  irsend._advanceAsync(20000);  // Part way through the gap.
+  EXPECT_EQ(kSendActive, irsend.getSendStatus(job));
+  EXPECT_EQ(kNoSendJob, finished);
+  irsend._advanceAsync(200000);  // The repeat code, & the gap after it.
+  EXPECT_EQ(job, finished);
+  EXPECT_EQ(kSendDone, irsend.getSendStatus(job));
+  EXPECT_EQ(0, irsend.getSendsPending());
+  // The whole gap, with nothing sent during it.
+  EXPECT_EQ("f38000d33m0s40320m8960s2240m560s96320", irsend.outputStr());
+
+  // The whole thing, as it would have been sent by sendNEC().
+  irsend.sendAsync(buffer, length);
+  irsend._advanceAsync(1000000);
+  const std::string async = irsend.outputStr();
+  irsend.sendNEC(0x20DF10EF, kNECBits, 1);
+  EXPECT_EQ(irsend.outputStr(), async);
+}
+
+TEST(TestSendAsync, HandleSend) {
+  IRsend render(0);
+  uint32_t buffer[10];
+  render.setRenderBuffer(buffer, 10);
+  render.enableIROut(38);
+  render.mark(100);
+  render.space(10000);
+  render.mark(200);
+
+  IRsendTest irsend(0);
+  irsend.begin();
+  EXPECT_FALSE(irsend.handleSend());  // Nothing to do.
+  ASSERT_TRUE(irsend.setSendQueueSize(1));
+  const uint16_t job = irsend.sendAsync(buffer, 5);
+  EXPECT_EQ("", irsend.outputStr());  // sendAsync() never sends anything.
+  // It sends up to the long gap, & leaves that to the timer.
+  EXPECT_TRUE(irsend.handleSend());
+  EXPECT_EQ("f38000d50m100", irsend.outputStr());
+  EXPECT_EQ(kSendActive, irsend.getSendStatus(job));
+  // Until the timer has fired, there is nothing more to send.
+  EXPECT_TRUE(irsend.handleSend());
+  EXPECT_EQ("", irsend.outputStr());
+  irsend._advanceAsync(10000);
+  EXPECT_FALSE(irsend.handleSend());
+  EXPECT_EQ(kSendDone, irsend.getSendStatus(job));
+  EXPECT_EQ("f38000d50m0s10000m200s0", irsend.outputStr());
+}
+
+// A backend that sends each burst in the background, until it's told the
+// hardware has finished.
+class IRsendBackground : public IRsendRecorder {
+ public:
+  uint16_t starts = 0;  // Nr. of bursts handed over via start().
+
+  bool start(const uint32_t train[], const uint16_t length) {
+    starts++;
+    IRsendBackend::send(train, length);  // Record it, as it will be sent.
+    return true;
+  }
+
+  void complete(void) { finished(); }  // i.e. The end-of-transmit interrupt.
+};
+
+TEST(TestSendAsync, BackendSendsInTheBackground) {
+  IRsend render(0);
+  uint32_t buffer[10];
+  render.setRenderBuffer(buffer, 10);
+  render.enableIROut(38);
+  render.mark(100);
+  render.space(10000);
+  render.mark(200);
+
+  IRsend irsend(0);
+  IRsendBackground backend;
+  irsend.begin();
+  irsend.setBackend(&backend);
+  ASSERT_TRUE(irsend.setSendQueueSize(1));
+  const uint16_t job = irsend.sendAsync(buffer, 5);
+  // The first burst is started, & handleSend() returns straight away.
+  EXPECT_TRUE(irsend.handleSend());
+  EXPECT_EQ(1, backend.starts);
+  EXPECT_EQ(0, backend.sends);
+  EXPECT_EQ(kSendActive, irsend.getSendStatus(job));
+  // Nothing else happens until the backend has finished with it.
+  irsend._advanceAsync(100000);
+  EXPECT_EQ(1, backend.starts);
+  EXPECT_EQ(kSendActive, irsend.getSendStatus(job));
+  backend.complete();
+  // Then the gap is left to the timer, & the last burst is started after it.
+  irsend._advanceAsync(10000);
+  EXPECT_EQ(2, backend.starts);
+  EXPECT_EQ(kSendActive, irsend.getSendStatus(job));
+  backend.complete();
+  EXPECT_FALSE(irsend.handleSend());
+  EXPECT_EQ(kSendDone, irsend.getSendStatus(job));
+  EXPECT_EQ("f38000d50m100s10000m200s0", backend.str());
+
+  // Without a backend, or with one that can't send in the background, the
+  // same bursts are sent by handleSend() itself.
+  IRsendRecorder blocking;
+  irsend.setBackend(&blocking);
+  irsend.sendAsync(buffer, 5);
+  EXPECT_TRUE(irsend.handleSend());
+  EXPECT_EQ(1, blocking.sends);
+  irsend._advanceAsync(10000);
+  EXPECT_EQ(2, blocking.sends);
+  EXPECT_EQ(0, irsend.getSendsPending());
+  EXPECT_EQ("f38000d50m100s10000m200s0", blocking.str());
+  backend.complete();  // A stray one changes nothing.
+  EXPECT_FALSE(irsend.handleSend());
+}
+
+TEST(TestSendAsync, QueueAndPriority) {
+  IRsend render(0);
+  uint32_t low[10];
+  uint32_t high[10];
+  uint32_t other[10];
+  render.setRenderBuffer(low, 10);
+  render.enableIROut(38);
+  render.mark(100);
+  render.space(10000);
+  render.setRenderBuffer(high, 10);
+  render.enableIROut(38);
+  render.mark(200);
+  render.space(10000);
+  render.setRenderBuffer(other, 10);
+  render.enableIROut(38);
+  render.mark(300);
+  render.space(10000);
+
+  IRsendTest irsend(0);
+  irsend.begin();
+  ASSERT_TRUE(irsend.setSendQueueSize(3));
+  std::string order;
+  SendDoneCallbackFunction note = [&order](const uint16_t id) {
+    order += std::to_string(id);
+  };
+  const uint16_t first = irsend.sendAsync(other, 3, 0, note);
+  irsend._advanceAsync(0);  // It has started, so it stays first.
+  EXPECT_EQ(kSendActive, irsend.getSendStatus(first));
+  const uint16_t second = irsend.sendAsync(low, 3, 0, note);
+  const uint16_t third = irsend.sendAsync(high, 3, 5, note);
+  EXPECT_EQ(kNoSendJob, irsend.sendAsync(high, 3, 9));  // It's full.
+  EXPECT_EQ(3, irsend.getSendsPending());
+  EXPECT_EQ(kSendQueued, irsend.getSendStatus(second));
+  EXPECT_EQ(kSendQueued, irsend.getSendStatus(third));
+  irsend._advanceAsync(100000);
+  EXPECT_EQ(std::to_string(first) + std::to_string(third) +
+            std::to_string(second), order);
+  EXPECT_EQ("f38000d50m300s10000m200s10000m100s10000", irsend.outputStr());
+
+  // A send can queue another when it's done.
+  order = "";
+  irsend.sendAsync(low, 3, 0, [&](const uint16_t id) {
+    order += std::to_string(id);
+    irsend.sendAsync(high, 3, 0, note);
+  });
+  irsend._advanceAsync(100000);
+  EXPECT_EQ(0, irsend.getSendsPending());
+  EXPECT_EQ("f38000d50m100s10000m200s10000", irsend.outputStr());
+  ASSERT_TRUE(irsend.setSendQueueSize(0));
+  EXPECT_EQ(kNoSendJob, irsend.sendAsync(low, 3));
+}
+
+// Tests for setBackend().
+
+// Send a message via a backend, & check it is the same as sending it directly.
+static void checkBackend(const std::function<void(IRsend *)> &send) {
+  IRsend irsend(0);
+  IRsendTest expected(0);
+  IRsendRecorder backend;
+  irsend.begin();
+  expected.begin();
+  irsend.setBackend(&backend);
+  send(&irsend);
+  send(&expected);
+  EXPECT_EQ(0, backend.sends);
+  EXPECT_EQ(expected.outputStr(), backend.str());
+}
+
+TEST(TestSendBackend, SameAsSending) {
+  checkBackend([](IRsend *irsend) {
+    irsend->enableIROut(38);
+    irsend->sendData(1, 2, 3, 4, 0b1011, 4, true); });
+  checkBackend([](IRsend *irsend) {
+    irsend->sendManchester(100, 200, 1, 300, 1000, 0x1234567890ABCDEF, 64, 38,
+                           true, 2); });
+  checkBackend([](IRsend *irsend) { irsend->sendNEC(0x20DF10EF, 32, 2); });
+  checkBackend([](IRsend *irsend) { irsend->sendSony(0xA90, 12, 2); });
+  checkBackend([](IRsend *irsend) {
+    const uint16_t raw[5] = {8950, 4500, 550, 1650, 600};
+    irsend->sendRaw(raw, 5, 38); });
+}
+
+TEST(TestSendBackend, RecordsExactly) {
+  IRsend irsend(0);
+  IRsendRecorder backend;
+  irsend.begin();
+  EXPECT_EQ(NULL, irsend.getBackend());
+  irsend.setBackend(&backend);
+  EXPECT_EQ(&backend, irsend.getBackend());
+
+  irsend.enableIROut(38000, 50);
+  EXPECT_EQ(39, irsend.mark(1000));  // 26us periods.
+  irsend.space(500);
+  irsend.enableIROut(40000, 100);
+  EXPECT_EQ(1, irsend.mark(1000));  // Not modulated.
+  ASSERT_EQ(5, backend.train.size());
+  EXPECT_EQ(kRenderCarrier | 38000 | (50 << kRenderDutyShift),
+            backend.train[0]);
+  EXPECT_EQ(kRenderMark | 1000, backend.train[1]);
+  EXPECT_EQ(kRenderSpace | 500, backend.train[2]);
+  EXPECT_EQ(2500, backend.airtime());
+  EXPECT_EQ("f38000d50m1000s500f40000d100m1000", backend.str());
+
+  // Not limited in size like IRsendTest is.
+  const std::vector<uint16_t> raw(12001, 100);
+  irsend.sendRaw(raw.data(), raw.size(), 38);
+  EXPECT_EQ(1 + 12001, backend.train.size());
+  EXPECT_EQ(1200100, backend.airtime());
+  backend.reset();
+
+  // Rendering still takes precedence.
+  uint32_t buffer[10];
+  irsend.setRenderBuffer(buffer, 10);
+  irsend.mark(100);
+  EXPECT_EQ(1, irsend.getRenderLength());
+  irsend.setRenderBuffer(NULL, 0);
+  EXPECT_TRUE(backend.train.empty());
+
+  irsend.setBackend(NULL);
+  irsend.space(100);
+  EXPECT_TRUE(backend.train.empty());
+}
+
+TEST(TestSendBackend, TakesWholeTrains) {
+  IRsend render(0);
+  uint32_t buffer[300];
+  render.setRenderBuffer(buffer, 300);
+  render.sendNEC(0x20DF10EF, kNECBits, 1);  // A message & a repeat code.
+  const uint16_t length = render.getRenderLength();
+  IRsendTest expected(0);
+  expected.sendNEC(0x20DF10EF, kNECBits, 1);
+  const std::string message = expected.outputStr();
+
+  IRsend irsend(0);
+  IRsendRecorder backend;
+  irsend.begin();
+  irsend.setBackend(&backend);
+  irsend.emit(buffer, length);
+  EXPECT_EQ(1, backend.sends);
+  EXPECT_EQ(message, backend.str());
+
+  // Played back asynchronously, it is split at the gaps the timer waits out.
+  ASSERT_TRUE(irsend.setSendQueueSize(1));
+  irsend.sendAsync(buffer, length);
+  irsend._advanceAsync(1000000);
+  EXPECT_EQ(2, backend.sends);
+  EXPECT_EQ(message, backend.str());
+}
@@ -8,6 +8,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 #include "IRrecv.h"
 #include "IRsend.h"
 #include "IRtimer.h"
@@ -126,6 +127,94 @@ class IRsendTest : public IRsend {
   }
 };
 
+// A transmit backend that records exactly what it was asked to send.
+// i.e. The successor to IRsendTest, without its fixed size limits.
+class IRsendRecorder : public IRsendBackend {
+ public:
+  std::vector<uint32_t> train;  // What was sent. See IRsend::setRenderBuffer()
+  uint16_t sends;  // Nr. of pulse trains handed over in one go via send().
+
+  IRsendRecorder(void) { reset(); }
+
+  void reset(void) {
+    train.clear();
+    sends = 0;
+    period = 0;
+  }
+
+  // Total time sent. (uSecs)
+  uint32_t airtime(void) {
+    uint32_t total = 0;
+    for (uint32_t entry : train)
+      if ((entry & kRenderTypeMask) != kRenderCarrier)
+        total += entry & kRenderValueMask;
+    return total;
+  }
+
+  // In the same format as IRsendTest::outputStr().
+  std::string str(void) {
+    std::stringstream result;
+    uint32_t carrier = 0;  // An impossible carrier.
+    uint32_t freq = 0;
+    uint8_t duty = UINT8_MAX;
+    for (uint32_t entry : train) {
+      const uint32_t value = entry & kRenderValueMask;
+      switch (entry & kRenderTypeMask) {
+        case kRenderCarrier:
+          carrier = value;
+          continue;
+        case kRenderMark:
+        case kRenderSpace:
+          if ((carrier & kRenderFreqMask) != freq) {
+            freq = carrier & kRenderFreqMask;
+            result << "f" << freq;
+          }
+          if ((carrier >> kRenderDutyShift) != duty) {
+            duty = carrier >> kRenderDutyShift;
+            result << "d" << static_cast<uint16_t>(duty);
+          }
+          result << (((entry & kRenderTypeMask) == kRenderMark) ? "m" : "s");
+          result << value;
+      }
+    }
+    reset();
+    return result.str();
+  }
+
+  void carrier(const uint32_t freq, const uint8_t duty) {
+    add(kRenderCarrier, freq | (uint32_t)duty << kRenderDutyShift);
+    period = (duty < 100) ? (1000000UL + freq / 2) / freq : 0;
+  }
+
+  uint16_t mark(const uint16_t usecs) {
+    IRtimer::add(usecs);
+    add(kRenderMark, usecs);
+    return period ? (usecs + period - 1) / period : 1;
+  }
+
+  void space(const uint32_t usecs) {
+    IRtimer::add(usecs);
+    add(kRenderSpace, usecs);
+  }
+
+  void send(const uint32_t buffer[], const uint16_t length) {
+    sends++;
+    IRsendBackend::send(buffer, length);
+  }
+
+ private:
+  uint32_t period;  // Of the carrier. (uSecs) 0 if not modulated.
+
+  // Adjoining marks, or spaces, are merged, like IRsendTest does.
+  void add(const uint32_t type, const uint32_t value) {
+    if (!train.empty() && type != kRenderCarrier &&
+        (train.back() & kRenderTypeMask) == type)
+      train.back() += value;
+    else
+      train.push_back(type | value);
+  }
+};
+
 #ifdef UNIT_TEST
 class IRsendLowLevelTest : public IRsend {
  public:
@@ -150,6 +239,18 @@ class IRsendLowLevelTest : public IRsend {
 
   void ledOn() { low_level_sequence += "[On]"; }
 };
+
+// Turning the LED on takes a while, as it does on real hardware.
+class IRsendSlowLed : public IRsendLowLevelTest {
+ public:
+  explicit IRsendSlowLed(uint16_t x) : IRsendLowLevelTest(x) {}
+
+ protected:
+  void ledOn() {
+    IRsendLowLevelTest::ledOn();
+    _IRtimer_unittest_now += 3;
+  }
+};
 #endif  // UNIT_TEST
 
 #endif  // TEST_IRSEND_TEST_H_
@@ -0,0 +1,166 @@
+// Copyright 2026 David Conran
+// Tests for the optional decoder & transmit statistics.
+// This file (& the library it is linked with) is built with them enabled, so
+// the rest of the tests run against the shipped defaults. See the Makefile.
+
+#include "IRrecv.h"
+#include "IRremoteESP8266.h"
+#include "IRsend.h"
+#include "IRsend_test.h"
+#include "gtest/gtest.h"
+
+#if ENABLE_DECODE_STATS
+// Tests for getDecodeStats().
+
+TEST(TestDecodeStats, Decode) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  EXPECT_EQ(0, irrecv.getDecodeStats(NEC).attempts);
+
+  irsend.reset();
+  irsend.sendNEC(0x807F40BF);
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  ASSERT_EQ(NEC, irsend.capture.decode_type);
+  decode_stats_t stats = irrecv.getDecodeStats(NEC);
+  EXPECT_EQ(1, stats.attempts);
+  EXPECT_EQ(1, stats.successes);
+  for (uint8_t b = 0; b < kDecodeStatsBuckets; b++)
+    EXPECT_EQ(0, stats.rejects[b]);
+  // Protocols with a very different header aren't even tried.
+  EXPECT_EQ(0, irrecv.getDecodeStats(SONY).attempts);
+
+  // Break the mark of the 20th bit, at rawbuf[41].
+  irsend.makeDecodeResult();
+  irsend.capture.rawbuf[41] = 5000 / kRawTick;
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(UNKNOWN, irsend.capture.decode_type);
+  stats = irrecv.getDecodeStats(NEC);
+  EXPECT_EQ(2, stats.attempts);
+  EXPECT_EQ(1, stats.successes);
+  // The header & 19 bits matched, so it was rejected at position 41.
+  EXPECT_EQ(1, stats.rejects[5]);  // i.e. In the 32 to 63 bucket.
+  // NEC_LIKE is only tried when NEC fails.
+  EXPECT_EQ(1, irrecv.getDecodeStats(NEC_LIKE).attempts);
+  EXPECT_EQ(0, irrecv.getDecodeStats(NEC_LIKE).successes);
+  EXPECT_EQ(1, irrecv.getDecodeStats(NEC_LIKE).rejects[5]);
+
+  const String dump = irrecv.decodeStatsToString();
+  EXPECT_EQ(0, dump.find(
+      "protocol,attempts,successes,usecs,rejects@0,rejects@2,rejects@4,"
+      "rejects@8,rejects@16,rejects@32,rejects@64,rejects@128+\n"));
+  EXPECT_NE(std::string::npos, dump.find("\nNEC,2,1,0,0,0,0,0,0,1,0,0\n"));
+  EXPECT_EQ(std::string::npos, dump.find("\nSONY,"));
+
+  // Nonsense protocols have no statistics.
+  EXPECT_EQ(0, irrecv.getDecodeStats(UNKNOWN).attempts);
+  irrecv.resetDecodeStats();
+  EXPECT_EQ(0, irrecv.getDecodeStats(NEC).attempts);
+  EXPECT_EQ(0, irrecv.getDecodeStats(NEC).rejects[5]);
+}
+#endif  // ENABLE_DECODE_STATS
+
+#if ENABLE_SEND_STATS
+// Tests for getSendStats().
+
+TEST(TestSendStats, Bitbanged) {
+  IRsendSlowLed irsend(0);
+  irsend.begin();
+  irsend.enableIROut(38000, 50);
+  EXPECT_EQ(0, irsend.getSendStats().timings);
+  // The time it takes to turn the LED on is made up within each cycle.
+  irsend.mark(100);
+  irsend.space(500);
+  irsend.mark(200);
+  send_stats_t stats = irsend.getSendStats();
+  EXPECT_EQ(3, stats.timings);
+  EXPECT_EQ(0, stats.max_error);
+  EXPECT_EQ(0, stats.mean_error);
+  // 26us periods, i.e. 38kHz.
+  EXPECT_EQ(4 + 8, stats.cycles);
+  EXPECT_EQ(4 + 8, stats.expected_cycles);
+  EXPECT_EQ(800, stats.requested);
+  EXPECT_EQ(800, stats.airtime);
+
+  // A new message. Without modulation, it is made up by nothing.
+  irsend.resetSendStats();
+  irsend.enableIROut(38000, 100);
+  irsend.mark(1000);
+  irsend.space(1000);
+  stats = irsend.getSendStats();
+  EXPECT_EQ(2, stats.timings);
+  EXPECT_EQ(3, stats.max_error);
+  EXPECT_EQ(1, stats.mean_error);
+  EXPECT_EQ(1, stats.cycles);
+  EXPECT_EQ(1, stats.expected_cycles);
+  EXPECT_EQ(2000, stats.requested);
+  EXPECT_EQ(2003, stats.airtime);
+
+  irsend.resetSendStats();
+  stats = irsend.getSendStats();
+  EXPECT_EQ(0, stats.timings);
+  EXPECT_EQ(0, stats.max_error);
+  EXPECT_EQ(0, stats.airtime);
+}
+
+TEST(TestSendStats, Backends) {
+  IRsend irsend(0);
+  IRsendRecorder backend;
+  irsend.begin();
+  irsend.setBackend(&backend);
+  irsend.sendNEC(0x20DF10EF);
+  send_stats_t stats = irsend.getSendStats();
+  EXPECT_EQ(2 + 2 * kNECBits + 2, stats.timings);
+  EXPECT_EQ(0, stats.max_error);
+  EXPECT_EQ(stats.expected_cycles, stats.cycles);
+  EXPECT_EQ(backend.airtime(), stats.requested);
+  EXPECT_EQ(backend.airtime(), stats.airtime);
+
+  // A whole rendered message is timed as one.
+  IRsend render(0);
+  uint32_t buffer[100];
+  render.setRenderBuffer(buffer, 100);
+  render.sendNEC(0x20DF10EF);
+  EXPECT_EQ(0, render.getSendStats().timings);  // Nothing was sent.
+  backend.reset();
+  irsend.resetSendStats();
+  irsend.emit(buffer, render.getRenderLength());
+  stats = irsend.getSendStats();
+  EXPECT_EQ(1, stats.timings);
+  EXPECT_EQ(0, stats.max_error);
+  EXPECT_EQ(0, stats.cycles);
+  EXPECT_EQ(backend.airtime(), stats.requested);
+  EXPECT_EQ(backend.airtime(), stats.airtime);
+}
+
+// A message sent in sections is timed as a whole, not just its last section.
+TEST(TestSendStats, WholeFrame) {
+  IRsend irsend(0);
+  IRsendRecorder backend;
+  irsend.begin();
+  irsend.setBackend(&backend);
+  const uint8_t state[kDaikin312StateLength] = {
+      0x11, 0xDA, 0x27, 0x00, 0x02, 0xD2, 0x11, 0xDA, 0x27, 0x00, 0x00,
+      0x18, 0x2A, 0x00, 0xA0, 0x00, 0x00, 0x06, 0x60, 0x00, 0x00, 0xC0,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x6B};
+  irsend.sendDaikin312(state);
+  send_stats_t stats = irsend.getSendStats();
+  EXPECT_EQ(backend.airtime(), stats.requested);
+  EXPECT_EQ(backend.airtime(), stats.airtime);
+
+  // The same, as one rendered train with a carrier entry per section.
+  IRsend render(0);
+  uint32_t buffer[1000];
+  render.setRenderBuffer(buffer, 1000);
+  render.sendDaikin312(state);
+  ASSERT_FALSE(render.getRenderOverflow());
+  backend.reset();
+  irsend.resetSendStats();
+  irsend.emit(buffer, render.getRenderLength());
+  stats = irsend.getSendStats();
+  EXPECT_EQ(1, stats.timings);
+  EXPECT_EQ(backend.airtime(), stats.requested);
+}
+#endif  // ENABLE_SEND_STATS
@@ -492,6 +492,95 @@ TEST(TestResultToRawArray, LargeValues) {
   if (result != NULL) delete[] result;
 }
 
+TEST(TestCompactCapture, RoundTrip) {
+  IRsendTest irsend(0);
+  uint16_t test_data[7] = {16, 480, 9000, 4504, 560, 1688, 560};
+  irsend.begin();
+  irsend.reset();
+  irsend.sendRaw(test_data, 7, 38000);
+  irsend.makeDecodeResult();
+  irsend.capture.rawbuf[0] = 1;  // As the ISR would.
+  // Short entries take a byte. Long ones take three.
+  ASSERT_EQ(12, getCompactLength(&irsend.capture));
+  uint8_t compact[12];
+  EXPECT_EQ(0, resultToCompact(&irsend.capture, compact, 11));  // Too small.
+  ASSERT_EQ(12, resultToCompact(&irsend.capture, compact, 12));
+  const uint8_t expected[12] = {
+      0x00, 0x02, 0x3C, kCompactEscape, 0x94, 0x11, kCompactEscape, 0xCC, 0x08,
+      0x46, 0xD3, 0x46};
+  EXPECT_STATE_EQ(expected, compact, 12 * 8);
+
+  // And back again. Multiples of kCompactTick, & long entries, are exact.
+  uint16_t rawbuf[8];
+  decode_results results;
+  results.rawbuf = rawbuf;
+  ASSERT_EQ(8, compactToResult(compact, 12, &results, 8));
+  EXPECT_EQ(8, results.rawlen);
+  EXPECT_FALSE(results.overflow);
+  for (uint16_t i = 1; i < 8; i++)
+    EXPECT_EQ(test_data[i - 1], rawbuf[i] * kRawTick) << "Entry #" << i;
+  EXPECT_EQ(0, rawbuf[0]);  // Shorter than half a kCompactTick.
+  // Not enough room for it all.
+  ASSERT_EQ(5, compactToResult(compact, 12, &results, 5));
+  EXPECT_TRUE(results.overflow);
+  // A long entry that has been cut short is dropped.
+  ASSERT_EQ(3, compactToResult(compact, 5, &results, 8));
+  EXPECT_TRUE(results.overflow);
+
+  // Others are rounded to the nearest kCompactTick.
+  irsend.capture.rawbuf[1] = 510 / kRawTick;
+  irsend.capture.rawbuf[2] = 1694 / kRawTick;
+  ASSERT_EQ(12, resultToCompact(&irsend.capture, compact, 12));
+  compactToResult(compact, 12, &results, 8);
+  EXPECT_EQ(512, rawbuf[1] * kRawTick);
+  EXPECT_EQ(1696, rawbuf[2] * kRawTick);
+}
+
+TEST(TestCompactCapture, Output) {
+  IRsendTest irsend(0);
+  IRrecv irrecv(1);
+  irsend.begin();
+  irsend.reset();
+  irsend.sendNikai(0xD0F2F);
+  irsend.makeDecodeResult();
+  irsend.capture.rawbuf[0] = 1;
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  ASSERT_EQ(NIKAI, irsend.capture.decode_type);
+  // 59 bytes, rather than the 104 of TestResultToRawArray.TypicalCase.
+  EXPECT_EQ(
+      "uint8_t compactData[59] = {0x00, 0xFF, 0xD0, 0x07, 0xFF, 0xD0, 0x07, "
+      "0x3F, 0xFA, 0x3F, 0xFA, 0x3F, 0xFA, 0x3F, 0xFA, 0x3F, 0x7D, 0x3F, 0x7D, "
+      "0x3F, 0xFA, 0x3F, 0x7D, 0x3F, 0xFA, 0x3F, 0xFA, 0x3F, 0xFA, 0x3F, 0xFA, "
+      "0x3F, 0x7D, 0x3F, 0x7D, 0x3F, 0x7D, 0x3F, 0x7D, 0x3F, 0xFA, 0x3F, 0xFA, "
+      "0x3F, 0x7D, 0x3F, 0xFA, 0x3F, 0x7D, 0x3F, 0x7D, 0x3F, 0x7D, 0x3F, 0x7D, "
+      "0x3F, 0xFF, 0x9A, 0x10};  // NIKAI D0F2F\n",
+      resultToCompactSourceCode(&irsend.capture));
+  const uint8_t compactData[59] = {
+      0x00, 0xFF, 0xD0, 0x07, 0xFF, 0xD0, 0x07, 0x3F, 0xFA, 0x3F, 0xFA, 0x3F,
+      0xFA, 0x3F, 0xFA, 0x3F, 0x7D, 0x3F, 0x7D, 0x3F, 0xFA, 0x3F, 0x7D, 0x3F,
+      0xFA, 0x3F, 0xFA, 0x3F, 0xFA, 0x3F, 0xFA, 0x3F, 0x7D, 0x3F, 0x7D, 0x3F,
+      0x7D, 0x3F, 0x7D, 0x3F, 0xFA, 0x3F, 0xFA, 0x3F, 0x7D, 0x3F, 0xFA, 0x3F,
+      0x7D, 0x3F, 0x7D, 0x3F, 0x7D, 0x3F, 0x7D, 0x3F, 0xFF, 0x9A, 0x10};
+  // It can be sent with sendRaw(), & decodes as the original did.
+  uint16_t length;
+  uint16_t *raw = compactToRawArray(compactData, 59, &length);
+  ASSERT_NE(nullptr, raw);
+  ASSERT_EQ(52, length);
+  EXPECT_EQ(4000, raw[0]);
+  EXPECT_EQ(504, raw[2]);  // Rounded to a multiple of kCompactTick.
+  EXPECT_EQ(2000, raw[3]);
+  EXPECT_EQ(8500, raw[51]);
+  irsend.reset();
+  irsend.sendRaw(raw, length, 38000);
+  delete[] raw;
+  irsend.makeDecodeResult();
+  ASSERT_TRUE(irrecv.decode(&irsend.capture));
+  EXPECT_EQ(NIKAI, irsend.capture.decode_type);
+  EXPECT_EQ(0xD0F2F, irsend.capture.value);
+  EXPECT_EQ(nullptr, compactToRawArray(compactData, 1, &length));
+  EXPECT_EQ(0, length);
+}
+
 TEST(TestUtils, TypeStringConversionRangeTests) {
   ASSERT_EQ("UNKNOWN", typeToString((decode_type_t)(kLastDecodeType + 1)));
   ASSERT_EQ("UNKNOWN", typeToString(decode_type_t::UNKNOWN));